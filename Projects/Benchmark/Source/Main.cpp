@@ -0,0 +1,536 @@
+/*
+The Jinx library is distributed under the MIT License (MIT)
+https://opensource.org/licenses/MIT
+See LICENSE.TXT or Jinx.h for license details.
+Copyright (c) 2016 James Boer
+*/
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "../../../Source/Jinx.h"
+
+using namespace Jinx;
+
+struct Benchmark
+{
+	const char * name;
+	const char * scriptText;
+};
+
+static const Benchmark s_interpreterBenchmarks[] =
+{
+	{
+		"Integer arithmetic",
+		u8R"(
+		set a to 0
+		loop i from 1 to 100000
+			set a to a + i * 2 - 1
+		end
+		)"
+	},
+	{
+		"Number arithmetic",
+		u8R"(
+		set a to 0.0
+		loop i from 1 to 100000
+			set a to a + i / 3.0 - 0.5
+		end
+		)"
+	},
+	{
+		"Conditional loop",
+		u8R"(
+		set i to 0
+		set n to 100000
+		set a to 0
+		loop while i < n
+			increment i
+			if i < 50000
+				increment a by 2
+			end
+		end
+		)"
+	},
+	{
+		"String literals",
+		u8R"(
+		set n to 0
+		loop from 1 to 50000
+			set s to "a string literal too long for small string storage"
+			if s = "a string literal too long for small string storage"
+				increment n
+			end
+		end
+		)"
+	},
+	{
+		"Function calls",
+		u8R"(
+		function return {a} plus {b}
+			return a + b
+		end
+		set a to 0
+		loop i from 1 to 50000
+			set a to a plus i
+		end
+		)"
+	},
+	{
+		"Recursive function calls",
+		u8R"(
+		function return {integer n} fib
+			if n < 2
+				return n
+			end
+			return (n - 1) fib + (n - 2) fib
+		end
+		set a to 18 fib
+		)"
+	},
+	{
+		"Tail calls",
+		u8R"(
+		function return {integer n} count down {integer total}
+			if n = 0
+				return total
+			end
+			return (n - 1) count down (total + 1)
+		end
+		loop from 1 to 20
+			set a to 5000 count down 0
+		end
+		)"
+	},
+	{
+		"Native function calls",
+		u8R"(
+		import core
+		set c to 1, 2, 3, 4, 5
+		set n to 0
+		loop from 1 to 50000
+			set n to n + c size
+		end
+		)"
+	},
+	{
+		"Collection iteration",
+		u8R"(
+		import core
+		set c to 1, 2, 3, 4, 5, 6, 7, 8, 9, 10
+		set n to 0
+		loop from 1 to 5000
+			loop i over c
+				increment n by i value
+			end
+		end
+		)"
+	},
+	{
+		"Property access",
+		u8R"(
+		set private p to 0
+		loop from 1 to 50000
+			increment p
+		end
+		)"
+	},
+};
+
+struct AllocationBenchmark
+{
+	const char * name;
+	const char * scriptText;
+	uint32_t operations;
+};
+
+// Each script performs the named operation once per loop iteration
+static const AllocationBenchmark s_allocationBenchmarks[] =
+{
+	{
+		"String add",
+		u8R"(
+		set a to "a string too long for small string storage"
+		set b to "another string too long for small string storage"
+		loop from 1 to 10000
+			set s to a + b
+		end
+		)",
+		10000
+	},
+	{
+		"String add literal",
+		u8R"(
+		set a to "a string too long for small string storage"
+		loop from 1 to 10000
+			set s to a + " with a literal suffix"
+		end
+		)",
+		10000
+	},
+	{
+		"Collection add element",
+		u8R"(
+		set a to "a string too long for small string storage"
+		set c to []
+		loop i from 1 to 10000
+			set c[i] to a
+		end
+		)",
+		10000
+	},
+	{
+		"Collection add list",
+		u8R"(
+		set a to "a string too long for small string storage"
+		loop from 1 to 10000
+			set c to a, a, a
+		end
+		)",
+		10000
+	},
+};
+
+struct LookupBenchmark
+{
+	const char * name;
+	const char * scriptFormat;
+};
+
+// Each thread runs a script formatted with its thread index, accessing runtime properties in a loop
+static const LookupBenchmark s_lookupBenchmarks[] =
+{
+	{
+		"Shared property reads",
+		u8R"(
+		import bench
+		set a to 0
+		loop from 1 to 10000
+			set a to a + gametime
+		end
+		)"
+	},
+	{
+		"Separate property writes",
+		u8R"(
+		import bench
+		loop from 1 to 10000
+			set counter%u to counter%u + 1
+		end
+		)"
+	},
+};
+
+// Small scripts executed once per tick, as with per-object game scripts.  Scripts from each bytecode are
+// interleaved, so batches must group them to execute scripts sharing bytecode together.
+static const char * s_batchScripts[] =
+{
+	u8R"(
+	set a to 0
+	loop while true
+		increment a
+		wait
+	end
+	)",
+	u8R"(
+	set b to 10
+	loop while true
+		decrement b
+		wait
+	end
+	)",
+	u8R"(
+	set c to 1.5
+	loop while true
+		set c to c * 1.0
+		wait
+	end
+	)",
+	u8R"(
+	set d to "ready"
+	loop while true
+		set e to d
+		wait
+	end
+	)",
+};
+
+static bool RunScript(RuntimePtr runtime, BufferPtr bytecode)
+{
+	auto script = runtime->CreateScript(bytecode);
+	do
+	{
+		if (!script->Execute())
+			return false;
+	}
+	while (!script->IsFinished());
+	return true;
+}
+
+static void RunInterpreterBenchmarks(uint32_t iterations)
+{
+	printf("\nInterpreter throughput (%u iterations each)\n", iterations);
+	printf("%-24s %14s %12s %14s\n", "Benchmark", "Instructions", "Time (ms)", "MInst/sec");
+	uint64_t totalInstructions = 0;
+	uint64_t totalTimeNs = 0;
+	for (const auto & benchmark : s_interpreterBenchmarks)
+	{
+		auto runtime = CreateRuntime();
+		auto bytecode = runtime->Compile(benchmark.scriptText, benchmark.name, {});
+		if (!bytecode)
+		{
+			printf("%-24s compilation failed\n", benchmark.name);
+			continue;
+		}
+
+		// Discard compilation stats, then execute the script to completion multiple times
+		runtime->GetScriptPerformanceStats(true);
+		bool success = true;
+		for (uint32_t i = 0; i < iterations && success; ++i)
+			success = RunScript(runtime, bytecode);
+		if (!success)
+		{
+			printf("%-24s execution failed\n", benchmark.name);
+			continue;
+		}
+
+		auto stats = runtime->GetScriptPerformanceStats(true);
+		double timeMs = static_cast<double>(stats.executionTimeNs) / 1000000.0;
+		double instPerSec = static_cast<double>(stats.instructionCount) / (static_cast<double>(stats.executionTimeNs) / 1000000000.0);
+		printf("%-24s %14" PRIu64 " %12.2f %14.2f\n", benchmark.name, stats.instructionCount, timeMs, instPerSec / 1000000.0);
+		totalInstructions += stats.instructionCount;
+		totalTimeNs += stats.executionTimeNs;
+	}
+	if (totalTimeNs)
+	{
+		double instPerSec = static_cast<double>(totalInstructions) / (static_cast<double>(totalTimeNs) / 1000000000.0);
+		printf("%-24s %14" PRIu64 " %12.2f %14.2f\n", "Total", totalInstructions, static_cast<double>(totalTimeNs) / 1000000.0, instPerSec / 1000000.0);
+	}
+}
+
+static void RunLookupBenchmarks(uint32_t iterations)
+{
+	static const uint32_t threadCounts[] = { 1, 2, 4, 8 };
+	printf("\nMulti-threaded property lookups (%u iterations per thread)\n", iterations);
+	printf("%-28s %8s %12s %14s\n", "Benchmark", "Threads", "Time (ms)", "MInst/sec");
+	for (const auto & benchmark : s_lookupBenchmarks)
+	{
+		for (uint32_t threadCount : threadCounts)
+		{
+			// Each thread's script accesses the shared property and its own property
+			auto runtime = CreateRuntime();
+			auto library = runtime->GetLibrary("bench");
+			library->RegisterProperty(Visibility::Public, Access::ReadOnly, "gametime", 1);
+			std::vector<BufferPtr> bytecodes;
+			for (uint32_t t = 0; t < threadCount; ++t)
+			{
+				char text[512];
+				snprintf(text, sizeof(text), "counter%u", t);
+				library->RegisterProperty(Visibility::Public, Access::ReadWrite, text, 0);
+				snprintf(text, sizeof(text), benchmark.scriptFormat, t, t);
+				auto bytecode = runtime->Compile(text, benchmark.name, {});
+				if (!bytecode)
+					break;
+				bytecodes.push_back(bytecode);
+			}
+			if (bytecodes.size() != threadCount)
+			{
+				printf("%-28s compilation failed\n", benchmark.name);
+				break;
+			}
+
+			// Discard compilation stats, then execute each thread's script to completion multiple times
+			runtime->GetScriptPerformanceStats(true);
+			std::atomic<bool> success(true);
+			auto begin = std::chrono::high_resolution_clock::now();
+			std::vector<std::thread> threads;
+			for (uint32_t t = 0; t < threadCount; ++t)
+			{
+				threads.push_back(std::thread([&, t]()
+				{
+					for (uint32_t i = 0; i < iterations && success; ++i)
+					{
+						if (!RunScript(runtime, bytecodes[t]))
+							success = false;
+					}
+				}));
+			}
+			for (auto & thread : threads)
+				thread.join();
+			auto end = std::chrono::high_resolution_clock::now();
+			if (!success)
+			{
+				printf("%-28s execution failed\n", benchmark.name);
+				break;
+			}
+
+			// Report combined throughput of all threads over the elapsed time
+			auto stats = runtime->GetScriptPerformanceStats(true);
+			double timeNs = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count());
+			double instPerSec = static_cast<double>(stats.instructionCount) / (timeNs / 1000000000.0);
+			printf("%-28s %8u %12.2f %14.2f\n", benchmark.name, threadCount, timeNs / 1000000.0, instPerSec / 1000000.0);
+		}
+	}
+}
+
+static void RunBatchBenchmarks(uint32_t iterations)
+{
+	static const size_t scriptCount = 20000;
+	printf("\nSmall script execution (%u ticks of %u scripts)\n", iterations, static_cast<uint32_t>(scriptCount));
+	printf("%-28s %12s %14s\n", "Benchmark", "Time (ms)", "ns/script");
+	auto runtime = CreateRuntime();
+	std::vector<BufferPtr> bytecodes;
+	for (auto scriptText : s_batchScripts)
+	{
+		auto bytecode = runtime->Compile(scriptText, "batch", {});
+		if (!bytecode)
+		{
+			printf("%-28s compilation failed\n", "Small scripts");
+			return;
+		}
+		bytecodes.push_back(bytecode);
+	}
+	for (int batched = 0; batched < 2; ++batched)
+	{
+		std::vector<ScriptPtr> scripts;
+		for (size_t i = 0; i < scriptCount; ++i)
+			scripts.push_back(runtime->CreateScript(bytecodes[i % bytecodes.size()]));
+
+		// Execute each script once per tick, either individually or as a single batch
+		bool success = true;
+		auto begin = std::chrono::high_resolution_clock::now();
+		for (uint32_t i = 0; i < iterations; ++i)
+		{
+			if (batched)
+			{
+				success = runtime->ExecuteScripts(scripts.data(), scripts.size()) && success;
+			}
+			else
+			{
+				for (const auto & script : scripts)
+					success = script->Execute() && success;
+			}
+		}
+		auto end = std::chrono::high_resolution_clock::now();
+		const char * name = batched ? "ExecuteScripts()" : "Execute() per script";
+		if (!success)
+		{
+			printf("%-28s execution failed\n", name);
+			continue;
+		}
+		double timeNs = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count());
+		printf("%-28s %12.2f %14.2f\n", name, timeNs / 1000000.0, timeNs / (static_cast<double>(iterations) * scriptCount));
+	}
+}
+
+static void RunAllocationBenchmarks()
+{
+	printf("\nAllocations per operation\n");
+	printf("%-24s %14s %14s\n", "Benchmark", "Allocations", "Allocs/op");
+	for (const auto & benchmark : s_allocationBenchmarks)
+	{
+		auto runtime = CreateRuntime();
+		auto bytecode = runtime->Compile(benchmark.scriptText, benchmark.name, {});
+		if (!bytecode)
+		{
+			printf("%-24s compilation failed\n", benchmark.name);
+			continue;
+		}
+
+		// Count internal allocations made while executing the script
+		auto before = GetMemoryStats();
+		if (!RunScript(runtime, bytecode))
+		{
+			printf("%-24s execution failed\n", benchmark.name);
+			continue;
+		}
+		auto after = GetMemoryStats();
+		uint32_t allocations = after.internalAllocCount - before.internalAllocCount;
+		printf("%-24s %14u %14.2f\n", benchmark.name, allocations, static_cast<double>(allocations) / benchmark.operations);
+	}
+}
+
+static void RunThreadedAllocationBenchmarks(uint32_t iterations)
+{
+	static const uint32_t threadCounts[] = { 1, 2, 4, 8 };
+	printf("\nMulti-threaded allocations (%u iterations per thread)\n", iterations);
+	printf("%-24s %8s %12s %14s\n", "Benchmark", "Threads", "Time (ms)", "MAllocs/sec");
+	for (const auto & benchmark : s_allocationBenchmarks)
+	{
+		for (uint32_t threadCount : threadCounts)
+		{
+			auto runtime = CreateRuntime();
+			auto bytecode = runtime->Compile(benchmark.scriptText, benchmark.name, {});
+			if (!bytecode)
+			{
+				printf("%-24s compilation failed\n", benchmark.name);
+				break;
+			}
+
+			// Each thread executes the script to completion multiple times, allocating concurrently
+			auto before = GetMemoryStats();
+			std::atomic<bool> success(true);
+			auto begin = std::chrono::high_resolution_clock::now();
+			std::vector<std::thread> threads;
+			for (uint32_t t = 0; t < threadCount; ++t)
+			{
+				threads.push_back(std::thread([&]()
+				{
+					for (uint32_t i = 0; i < iterations && success; ++i)
+					{
+						if (!RunScript(runtime, bytecode))
+							success = false;
+					}
+				}));
+			}
+			for (auto & thread : threads)
+				thread.join();
+			auto end = std::chrono::high_resolution_clock::now();
+			if (!success)
+			{
+				printf("%-24s execution failed\n", benchmark.name);
+				break;
+			}
+
+			// Report combined allocation throughput of all threads over the elapsed time
+			auto after = GetMemoryStats();
+			double timeNs = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count());
+			double allocsPerSec = static_cast<double>(after.internalAllocCount - before.internalAllocCount) / (timeNs / 1000000000.0);
+			printf("%-24s %8u %12.2f %14.2f\n", benchmark.name, threadCount, timeNs / 1000000.0, allocsPerSec / 1000000.0);
+		}
+	}
+}
+
+int main(int argc, char ** argv)
+{
+	printf("Jinx version: %s\n", Jinx::VersionString);
+
+	uint32_t iterations = 10;
+	if (argc > 1)
+		iterations = static_cast<uint32_t>(atoi(argv[1]));
+
+	// Add scope block to ensure all objects are destroyed for shutdown
+	{
+		// Scripts run to completion without yielding
+		GlobalParams globalParams;
+		globalParams.maxInstructions = UINT32_MAX;
+		globalParams.errorOnMaxInstrunctions = false;
+		Jinx::Initialize(globalParams);
+
+		RunInterpreterBenchmarks(iterations);
+		RunLookupBenchmarks(iterations);
+		RunBatchBenchmarks(iterations);
+		RunAllocationBenchmarks();
+		RunThreadedAllocationBenchmarks(iterations);
+	}
+
+	Jinx::ShutDown();
+
+	return 0;
+}
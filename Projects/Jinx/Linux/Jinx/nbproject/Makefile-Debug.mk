@@ -36,6 +36,7 @@ OBJECTDIR=${CND_BUILDDIR}/${CND_CONF}/${CND_PLATFORM}
 # Object Files
 OBJECTFILES= \
 	${OBJECTDIR}/_ext/5555977b/JxBuffer.o \
+	${OBJECTDIR}/_ext/5555977b/JxAsyncCall.o \
 	${OBJECTDIR}/_ext/5555977b/JxCollection.o \
 	${OBJECTDIR}/_ext/5555977b/JxCommon.o \
 	${OBJECTDIR}/_ext/5555977b/JxConversion.o \
@@ -48,11 +49,17 @@ OBJECTFILES= \
 	${OBJECTDIR}/_ext/5555977b/JxLogging.o \
 	${OBJECTDIR}/_ext/5555977b/JxMemory.o \
 	${OBJECTDIR}/_ext/5555977b/JxMutex.o \
+	${OBJECTDIR}/_ext/5555977b/JxArena.o \
 	${OBJECTDIR}/_ext/5555977b/JxParser.o \
+	${OBJECTDIR}/_ext/5555977b/JxPerformanceCounters.o \
+	${OBJECTDIR}/_ext/5555977b/JxProgram.o \
 	${OBJECTDIR}/_ext/5555977b/JxPropertyName.o \
+	${OBJECTDIR}/_ext/5555977b/JxPropertySlot.o \
 	${OBJECTDIR}/_ext/5555977b/JxRuntime.o \
+	${OBJECTDIR}/_ext/5555977b/JxScheduler.o \
 	${OBJECTDIR}/_ext/5555977b/JxScript.o \
 	${OBJECTDIR}/_ext/5555977b/JxSerialize.o \
+	${OBJECTDIR}/_ext/5555977b/JxTimerWheel.o \
 	${OBJECTDIR}/_ext/5555977b/JxUnicode.o \
 	${OBJECTDIR}/_ext/5555977b/JxUnicodeCaseFolding.o \
 	${OBJECTDIR}/_ext/5555977b/JxVariableStackFrame.o \
@@ -90,6 +97,11 @@ ${OBJECTDIR}/_ext/5555977b/JxBuffer.o: ../../../../Source/JxBuffer.cpp
 	${RM} "$@.d"
 	$(COMPILE.cc) -g -std=c++14 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/_ext/5555977b/JxBuffer.o ../../../../Source/JxBuffer.cpp
 
+${OBJECTDIR}/_ext/5555977b/JxAsyncCall.o: ../../../../Source/JxAsyncCall.cpp 
+	${MKDIR} -p ${OBJECTDIR}/_ext/5555977b
+	${RM} "$@.d"
+	$(COMPILE.cc) -g -std=c++14 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/_ext/5555977b/JxAsyncCall.o ../../../../Source/JxAsyncCall.cpp
+
 ${OBJECTDIR}/_ext/5555977b/JxCollection.o: ../../../../Source/JxCollection.cpp 
 	${MKDIR} -p ${OBJECTDIR}/_ext/5555977b
 	${RM} "$@.d"
@@ -150,21 +162,46 @@ ${OBJECTDIR}/_ext/5555977b/JxMutex.o: ../../../../Source/JxMutex.cpp
 	${RM} "$@.d"
 	$(COMPILE.cc) -g -std=c++14 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/_ext/5555977b/JxMutex.o ../../../../Source/JxMutex.cpp
 
+${OBJECTDIR}/_ext/5555977b/JxArena.o: ../../../../Source/JxArena.cpp 
+	${MKDIR} -p ${OBJECTDIR}/_ext/5555977b
+	${RM} "$@.d"
+	$(COMPILE.cc) -g -std=c++14 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/_ext/5555977b/JxArena.o ../../../../Source/JxArena.cpp
+
 ${OBJECTDIR}/_ext/5555977b/JxParser.o: ../../../../Source/JxParser.cpp 
 	${MKDIR} -p ${OBJECTDIR}/_ext/5555977b
 	${RM} "$@.d"
 	$(COMPILE.cc) -g -std=c++14 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/_ext/5555977b/JxParser.o ../../../../Source/JxParser.cpp
 
+${OBJECTDIR}/_ext/5555977b/JxPerformanceCounters.o: ../../../../Source/JxPerformanceCounters.cpp 
+	${MKDIR} -p ${OBJECTDIR}/_ext/5555977b
+	${RM} "$@.d"
+	$(COMPILE.cc) -g -std=c++14 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/_ext/5555977b/JxPerformanceCounters.o ../../../../Source/JxPerformanceCounters.cpp
+
+${OBJECTDIR}/_ext/5555977b/JxProgram.o: ../../../../Source/JxProgram.cpp 
+	${MKDIR} -p ${OBJECTDIR}/_ext/5555977b
+	${RM} "$@.d"
+	$(COMPILE.cc) -g -std=c++14 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/_ext/5555977b/JxProgram.o ../../../../Source/JxProgram.cpp
+
 ${OBJECTDIR}/_ext/5555977b/JxPropertyName.o: ../../../../Source/JxPropertyName.cpp 
 	${MKDIR} -p ${OBJECTDIR}/_ext/5555977b
 	${RM} "$@.d"
 	$(COMPILE.cc) -g -std=c++14 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/_ext/5555977b/JxPropertyName.o ../../../../Source/JxPropertyName.cpp
 
+${OBJECTDIR}/_ext/5555977b/JxPropertySlot.o: ../../../../Source/JxPropertySlot.cpp 
+	${MKDIR} -p ${OBJECTDIR}/_ext/5555977b
+	${RM} "$@.d"
+	$(COMPILE.cc) -g -std=c++14 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/_ext/5555977b/JxPropertySlot.o ../../../../Source/JxPropertySlot.cpp
+
 ${OBJECTDIR}/_ext/5555977b/JxRuntime.o: ../../../../Source/JxRuntime.cpp 
 	${MKDIR} -p ${OBJECTDIR}/_ext/5555977b
 	${RM} "$@.d"
 	$(COMPILE.cc) -g -std=c++14 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/_ext/5555977b/JxRuntime.o ../../../../Source/JxRuntime.cpp
 
+${OBJECTDIR}/_ext/5555977b/JxScheduler.o: ../../../../Source/JxScheduler.cpp 
+	${MKDIR} -p ${OBJECTDIR}/_ext/5555977b
+	${RM} "$@.d"
+	$(COMPILE.cc) -g -std=c++14 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/_ext/5555977b/JxScheduler.o ../../../../Source/JxScheduler.cpp
+
 ${OBJECTDIR}/_ext/5555977b/JxScript.o: ../../../../Source/JxScript.cpp 
 	${MKDIR} -p ${OBJECTDIR}/_ext/5555977b
 	${RM} "$@.d"
@@ -175,6 +212,11 @@ ${OBJECTDIR}/_ext/5555977b/JxSerialize.o: ../../../../Source/JxSerialize.cpp
 	${RM} "$@.d"
 	$(COMPILE.cc) -g -std=c++14 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/_ext/5555977b/JxSerialize.o ../../../../Source/JxSerialize.cpp
 
+${OBJECTDIR}/_ext/5555977b/JxTimerWheel.o: ../../../../Source/JxTimerWheel.cpp 
+	${MKDIR} -p ${OBJECTDIR}/_ext/5555977b
+	${RM} "$@.d"
+	$(COMPILE.cc) -g -std=c++14 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/_ext/5555977b/JxTimerWheel.o ../../../../Source/JxTimerWheel.cpp
+
 ${OBJECTDIR}/_ext/5555977b/JxUnicode.o: ../../../../Source/JxUnicode.cpp 
 	${MKDIR} -p ${OBJECTDIR}/_ext/5555977b
 	${RM} "$@.d"
@@ -0,0 +1,167 @@
+/*
+The Jinx library is distributed under the MIT License (MIT)
+https://opensource.org/licenses/MIT
+See LICENSE.TXT or Jinx.h for license details.
+Copyright (c) 2016 James Boer
+*/
+
+// Reports the most frequent opcode sequences in a corpus of Jinx scripts or compiled bytecode,
+// for choosing which instruction sequences are worth fusing into superinstructions.
+//
+// Usage: OpcodeStats [-n maxLength] [-t topCount] file...
+
+#include <algorithm>
+#include <inttypes.h>
+#include <map>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "../../../Source/JxInternal.h"
+
+using namespace Jinx;
+
+typedef std::vector<Opcode> OpcodeSequence;
+typedef std::map<OpcodeSequence, uint64_t> SequenceCountMap;
+
+static bool ReadFile(const char * filename, std::vector<char> * data)
+{
+	FILE * file = fopen(filename, "rb");
+	if (!file)
+		return false;
+	char buffer[4096];
+	size_t bytesRead;
+	while ((bytesRead = fread(buffer, 1, sizeof(buffer), file)) > 0)
+		data->insert(data->end(), buffer, buffer + bytesRead);
+	fclose(file);
+	return true;
+}
+
+static BufferPtr LoadBytecode(const RuntimePtr & runtime, const char * filename)
+{
+	std::vector<char> data;
+	if (!ReadFile(filename, &data))
+	{
+		printf("Unable to read file %s\n", filename);
+		return nullptr;
+	}
+
+	// Compiled bytecode is used directly, and anything else is compiled as script text
+	BytecodeHeader header;
+	if (data.size() >= sizeof(header))
+	{
+		memcpy(&header, data.data(), sizeof(header));
+		if (header.signature == BytecodeSignature)
+		{
+			auto bytecode = CreateBuffer();
+			bytecode->Write(data.data(), data.size());
+			return bytecode;
+		}
+	}
+	data.push_back(0);
+	auto bytecode = runtime->Compile(data.data(), filename, {});
+	if (!bytecode)
+		printf("Unable to compile script %s\n", filename);
+	return bytecode;
+}
+
+static void CountSequences(const Program & program, size_t maxLength, std::vector<SequenceCountMap> * counts)
+{
+	// Count each sequence of instructions once per starting instruction
+	const Instruction * instructions = program.GetInstructions();
+	size_t instructionCount = program.GetInstructionCount();
+	for (size_t i = 0; i < instructionCount; ++i)
+	{
+		OpcodeSequence sequence;
+		for (size_t length = 1; length <= maxLength && i + length <= instructionCount; ++length)
+		{
+			sequence.push_back(instructions[i + length - 1].opcode);
+			++(*counts)[length - 1][sequence];
+		}
+	}
+}
+
+static void PrintSequences(const SequenceCountMap & counts, size_t topCount)
+{
+	uint64_t total = 0;
+	std::vector<std::pair<uint64_t, OpcodeSequence>> sorted;
+	for (const auto & pair : counts)
+	{
+		sorted.push_back(std::make_pair(pair.second, pair.first));
+		total += pair.second;
+	}
+	std::sort(sorted.begin(), sorted.end(), [](const std::pair<uint64_t, OpcodeSequence> & left, const std::pair<uint64_t, OpcodeSequence> & right)
+	{
+		return left.first > right.first;
+	});
+	if (sorted.size() > topCount)
+		sorted.resize(topCount);
+	for (const auto & pair : sorted)
+	{
+		printf("%8" PRIu64 " %6.2f%%  ", pair.first, 100.0 * static_cast<double>(pair.first) / static_cast<double>(total));
+		for (size_t i = 0; i < pair.second.size(); ++i)
+			printf("%s%s", i ? " " : "", GetOpcodeText(pair.second[i]));
+		printf("\n");
+	}
+}
+
+int main(int argc, char ** argv)
+{
+	size_t maxLength = 4;
+	size_t topCount = 20;
+	std::vector<const char *> filenames;
+	for (int i = 1; i < argc; ++i)
+	{
+		if (strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+			maxLength = std::max(atoi(argv[++i]), 1);
+		else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc)
+			topCount = std::max(atoi(argv[++i]), 1);
+		else
+			filenames.push_back(argv[i]);
+	}
+	if (filenames.empty())
+	{
+		printf("Usage: OpcodeStats [-n maxLength] [-t topCount] file...\n");
+		return 1;
+	}
+
+	std::vector<SequenceCountMap> counts(maxLength);
+	{
+		GlobalParams globalParams;
+		globalParams.logBytecode = false;
+		globalParams.logSymbols = false;
+		Jinx::Initialize(globalParams);
+
+		auto runtime = CreateRuntime();
+		size_t programCount = 0;
+		size_t verifiedCount = 0;
+		for (auto filename : filenames)
+		{
+			auto bytecode = LoadBytecode(runtime, filename);
+			if (!bytecode)
+				continue;
+			Program program(bytecode);
+			if (!program.IsValid())
+			{
+				printf("Invalid bytecode in %s\n", filename);
+				continue;
+			}
+			CountSequences(program, maxLength, &counts);
+			++programCount;
+			if (program.IsVerified())
+				++verifiedCount;
+		}
+		printf("Opcode sequences in %zu of %zu files, %zu verified\n", programCount, filenames.size(), verifiedCount);
+	}
+	Jinx::ShutDown();
+
+	for (size_t length = 1; length <= maxLength; ++length)
+	{
+		printf("\nLength %zu:\n", length);
+		PrintSequences(counts[length - 1], topCount);
+	}
+
+	return 0;
+}
@@ -260,4 +260,27 @@ TEST_CASE("Test Collections", "[Collections]")
 		REQUIRE(collection->find(3) == collection->end());
 	}
 
+	SECTION("Test erasing single element from collection property by key")
+	{
+		static const char * scriptText =
+			u8R"(
+			import core
+
+			set private a to [1, "red"], [2, "green"], [3, "blue"]
+			
+			-- Erase property element by key
+			erase a[2] 
+
+			)";
+
+		auto script = TestExecuteScript(scriptText);
+		REQUIRE(script);
+		auto library = script->GetLibrary();
+		REQUIRE(library->GetProperty("a").IsCollection());
+		auto collection = library->GetProperty("a").GetCollection();
+		REQUIRE(collection);
+		REQUIRE(collection->size() == 2);
+		REQUIRE(collection->find(2) == collection->end());
+	}
+
 }
\ No newline at end of file
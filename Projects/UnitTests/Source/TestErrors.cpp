@@ -6,10 +6,34 @@ Copyright (c) 2016 James Boer
 */
 
 #include "UnitTest.h"
+#include "../../../Source/JxInternal.h"
 
 using namespace Jinx;
 
 
+// Create bytecode from hand-written instructions, followed by empty constant and name tables
+template <typename WriteFn>
+static BufferPtr CreateBytecode(WriteFn writeInstructions)
+{
+	auto bytecode = CreateBuffer();
+	BinaryWriter writer(bytecode);
+	BytecodeHeader header;
+	writer.Write(&header, sizeof(header));
+	writeInstructions(writer);
+	header.tableOffset = static_cast<uint32_t>(writer.Tell());
+	writer.Write(uint32_t(0));
+	writer.Write(uint32_t(0));
+	writer.Seek(0);
+	writer.Write(&header, sizeof(header));
+	return bytecode;
+}
+
+static Variant FortyTwo(ScriptPtr script, Parameters params)
+{
+	return 42;
+}
+
+
 TEST_CASE("Test Syntax, Parsing, and Runtime Errors", "[Errors]")
 {
 	SECTION("Test number parsing error error")
@@ -808,4 +832,115 @@ TEST_CASE("Test Syntax, Parsing, and Runtime Errors", "[Errors]")
 		REQUIRE(!script->Execute());
 	}
 
+	SECTION("Test verified bytecode")
+	{
+		auto bytecode = CreateBytecode([](BinaryWriter & writer)
+		{
+			writer.Write<Opcode, uint8_t>(Opcode::ScopeBegin);
+			writer.Write<Opcode, uint8_t>(Opcode::ScopeEnd);
+			writer.Write<Opcode, uint8_t>(Opcode::Exit);
+		});
+		REQUIRE(Program(bytecode).IsVerified());
+
+		auto script = TestCreateRuntime()->CreateScript(bytecode);
+		REQUIRE(script);
+		REQUIRE(script->Execute());
+		REQUIRE(script->IsFinished());
+	}
+
+	// Bytecode failing verification is executed by the checked interpreter, which reports an error
+	// instead of executing past the end of the stack, scope, or frame stacks
+	SECTION("Test bytecode stack underflow")
+	{
+		auto bytecode = CreateBytecode([](BinaryWriter & writer)
+		{
+			writer.Write<Opcode, uint8_t>(Opcode::Pop);
+			writer.Write<Opcode, uint8_t>(Opcode::Exit);
+		});
+		REQUIRE(Program(bytecode).IsValid());
+		REQUIRE(!Program(bytecode).IsVerified());
+
+		auto script = TestCreateRuntime()->CreateScript(bytecode);
+		REQUIRE(script);
+		REQUIRE(!script->Execute());
+	}
+
+	SECTION("Test bytecode scope end without scope begin")
+	{
+		auto bytecode = CreateBytecode([](BinaryWriter & writer)
+		{
+			writer.Write<Opcode, uint8_t>(Opcode::ScopeEnd);
+			writer.Write<Opcode, uint8_t>(Opcode::Exit);
+		});
+		REQUIRE(Program(bytecode).IsValid());
+		REQUIRE(!Program(bytecode).IsVerified());
+
+		auto script = TestCreateRuntime()->CreateScript(bytecode);
+		REQUIRE(script);
+		REQUIRE(!script->Execute());
+	}
+
+	SECTION("Test bytecode return outside of a function")
+	{
+		auto bytecode = CreateBytecode([](BinaryWriter & writer)
+		{
+			writer.Write<Opcode, uint8_t>(Opcode::Return);
+			writer.Write<Opcode, uint8_t>(Opcode::Exit);
+		});
+		REQUIRE(Program(bytecode).IsValid());
+		REQUIRE(!Program(bytecode).IsVerified());
+
+		auto script = TestCreateRuntime()->CreateScript(bytecode);
+		REQUIRE(script);
+		REQUIRE(!script->Execute());
+	}
+
+	SECTION("Test bytecode tail call outside of a function")
+	{
+		auto runtime = TestCreateRuntime();
+		auto library = runtime->GetLibrary("test");
+		library->RegisterFunction(Visibility::Public, ReturnValue::Required, { "forty", "two" }, FortyTwo);
+
+		// Find the id of the native function from a compiled call
+		auto compiled = runtime->Compile("import test\nset a to forty two\n");
+		REQUIRE(compiled);
+		Program program(compiled);
+		RuntimeID id = 0;
+		for (size_t i = 0; i < program.GetInstructionCount(); ++i)
+		{
+			if (program.GetInstructions()[i].opcode == Opcode::CallFunc)
+				id = program.GetInstructions()[i].id;
+		}
+		REQUIRE(id != 0);
+
+		auto bytecode = CreateBytecode([id](BinaryWriter & writer)
+		{
+			writer.Write<Opcode, uint8_t>(Opcode::TailCall);
+			writer.Write(id);
+			writer.Write(uint32_t(0));
+			writer.Write(uint32_t(1));
+			writer.Write<Opcode, uint8_t>(Opcode::Exit);
+		});
+		REQUIRE(Program(bytecode).IsValid());
+		REQUIRE(!Program(bytecode).IsVerified());
+
+		auto script = runtime->CreateScript(bytecode);
+		REQUIRE(script);
+		REQUIRE(!script->Execute());
+	}
+
+	SECTION("Test bytecode invalid opcode")
+	{
+		auto bytecode = CreateBytecode([](BinaryWriter & writer)
+		{
+			writer.Write(uint8_t(0xFF));
+			writer.Write<Opcode, uint8_t>(Opcode::Exit);
+		});
+		REQUIRE(!Program(bytecode).IsValid());
+
+		auto script = TestCreateRuntime()->CreateScript(bytecode);
+		REQUIRE(script);
+		REQUIRE(!script->Execute());
+	}
+
 }
@@ -425,4 +425,166 @@ TEST_CASE("Test Functions", "[Functions]")
 		REQUIRE(script2->GetVariable("a") == 123);
 	}
 
+	SECTION("Test repeated function calls from scripts sharing bytecode")
+	{
+		static const char * scriptText =
+			u8R"(
+	
+			function return {integer x} plus one
+				return x + 1
+			end
+
+			set a to 0
+			loop i from 1 to 10
+				set a to a plus one
+			end
+
+			)";
+
+		auto runtime = TestCreateRuntime();
+		auto bytecode = runtime->Compile(scriptText, "", {});
+		REQUIRE(bytecode);
+		auto script1 = runtime->CreateScript(bytecode);
+		auto script2 = runtime->CreateScript(bytecode);
+		REQUIRE(script1->Execute());
+		REQUIRE(script2->Execute());
+		REQUIRE(script1->GetVariable("a") == 10);
+		REQUIRE(script2->GetVariable("a") == 10);
+	}
+
+	SECTION("Test operators with changing operand types")
+	{
+		static const char * scriptText =
+			u8R"(
+	
+			function return {a} plus {b}
+				return a + b
+			end
+
+			function return {a} minus {b}
+				return a - b
+			end
+
+			function return {a} is below {b}
+				return a < b
+			end
+
+			function return {a} matches {b}
+				return a = b
+			end
+
+			function return {a} incremented by {b}
+				increment a by b
+				return a
+			end
+
+			set a1 to 1 plus 2
+			set a2 to 1.5 plus 2.0
+			set a3 to "abc" plus "def"
+			set a4 to 3 plus 4
+			set b1 to 5 minus 2
+			set b2 to 5.5 minus 2
+			set b3 to 5 minus 2.5
+			set c1 to 1 is below 2
+			set c2 to 2.5 is below 1.5
+			set c3 to "a" is below "b"
+			set d1 to 3 matches 3
+			set d2 to "abc" matches "abc"
+			set d3 to "abc" matches "abd"
+			set d4 to 2.0 matches 2.0
+			set e1 to 1 incremented by 2
+			set e2 to 1.5 incremented by 1.0
+			set e3 to 10 incremented by 5
+
+			)";
+
+		auto script = TestExecuteScript(scriptText);
+		REQUIRE(script);
+		REQUIRE(script->GetVariable("a1") == 3);
+		REQUIRE(script->GetVariable("a2") == 3.5);
+		REQUIRE(script->GetVariable("a3") == "abcdef");
+		REQUIRE(script->GetVariable("a4") == 7);
+		REQUIRE(script->GetVariable("a4").IsInteger());
+		REQUIRE(script->GetVariable("b1") == 3);
+		REQUIRE(script->GetVariable("b2") == 3.5);
+		REQUIRE(script->GetVariable("b3") == 2.5);
+		REQUIRE(script->GetVariable("c1") == true);
+		REQUIRE(script->GetVariable("c2") == false);
+		REQUIRE(script->GetVariable("c3") == true);
+		REQUIRE(script->GetVariable("d1") == true);
+		REQUIRE(script->GetVariable("d2") == true);
+		REQUIRE(script->GetVariable("d3") == false);
+		REQUIRE(script->GetVariable("d4") == true);
+		REQUIRE(script->GetVariable("e1") == 3);
+		REQUIRE(script->GetVariable("e2") == 2.5);
+		REQUIRE(script->GetVariable("e3") == 15);
+	}
+
+	SECTION("Test recursive functions with local variables")
+	{
+		static const char * scriptText =
+			u8R"(
+
+			import core
+
+			function return {integer n} fib
+				if n < 2
+					return n
+				end
+				set a to (n - 1) fib
+				set b to (n - 2) fib
+				return a + b
+			end
+
+			function return {list} length plus one
+				set x to list size
+				return x + 1
+			end
+
+			set f to 8 fib
+			set c to 1, 2, 3
+			set d to c length plus one
+
+			)";
+
+		auto script = TestExecuteScript(scriptText);
+		REQUIRE(script);
+		REQUIRE(script->GetVariable("f") == 21);
+		REQUIRE(script->GetVariable("d") == 4);
+		REQUIRE(script->GetVariable("a") == nullptr);
+		REQUIRE(script->GetVariable("x") == nullptr);
+	}
+
+	SECTION("Test functions returning the result of a function call")
+	{
+		static const char * scriptText =
+			u8R"(
+
+			import core
+
+			function return {integer n} sum with {integer total}
+				set x to n
+				if x = 0
+					return total
+				end
+				return (x - 1) sum with (total + x)
+			end
+
+			function return {c} item count
+				return c size
+			end
+
+			set a to 100 sum with 0
+			set c to 1, 2, 3
+			set d to c item count
+
+			)";
+
+		auto script = TestExecuteScript(scriptText);
+		REQUIRE(script);
+		REQUIRE(script->GetVariable("a") == 5050);
+		REQUIRE(script->GetVariable("d") == 3);
+		REQUIRE(script->GetVariable("x") == nullptr);
+	}
+
 }
\ No newline at end of file
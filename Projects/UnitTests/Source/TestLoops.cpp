@@ -197,4 +197,127 @@ TEST_CASE("Test Loops", "[Loops]")
 		REQUIRE(script->GetVariable("b") == 3);
 		REQUIRE(script->GetVariable("c") == 6);
 	}
+
+	SECTION("Test loop break inside nested loops")
+	{
+		static const char * scriptText =
+			u8R"(
+
+			set a to 0
+			loop i from 1 to 3
+				loop j from 1 to 10
+					set k to j
+					if j = 2
+						break
+					end
+				end
+				increment a by i
+			end
+
+			set b to 0
+			loop i from 1 to 5
+				if i = 2
+					break
+				end
+				if i = 3
+					break
+				end
+				increment b
+			end
+
+			)";
+
+		auto script = TestExecuteScript(scriptText);
+		REQUIRE(script);
+		REQUIRE(script->GetVariable("a") == 6);
+		REQUIRE(script->GetVariable("b") == 1);
+		REQUIRE(script->GetVariable("i") == nullptr);
+		REQUIRE(script->GetVariable("k") == nullptr);
+	}
+
+	SECTION("Test loop conditions with changing operand types")
+	{
+		static const char * scriptText =
+			u8R"(
+
+			set a to 0
+			set n to 10
+			set i to 1
+			loop while i < n
+				increment a by 1
+				increment i
+			end
+
+			set b to 0
+			set x to 1.5
+			loop until x > 4
+				increment x by 1.0
+				increment b
+			end
+
+			set c to 0
+			set y to 0
+			loop while y < 3
+				increment y by 1
+				if y = 2
+					set y to 2.5
+				end
+				increment c
+			end
+
+			set s to "a"
+			loop while s != "abbb"
+				set s to s + "b"
+			end
+
+			)";
+
+		auto script = TestExecuteScript(scriptText);
+		REQUIRE(script);
+		REQUIRE(script->GetVariable("a") == 9);
+		REQUIRE(script->GetVariable("i") == 10);
+		REQUIRE(script->GetVariable("b") == 3);
+		REQUIRE(script->GetVariable("x") == 4.5);
+		REQUIRE(script->GetVariable("c") == 3);
+		REQUIRE(script->GetVariable("y") == 3.5);
+		REQUIRE(script->GetVariable("s") == "abbb");
+	}
+	SECTION("Test loops exiting with variables declared on some paths")
+	{
+		const char * scriptText =
+			u8R"(
+
+			import core
+
+			set c to [1, "red"], [2, "green"], [3, "blue"]
+			set n to 0
+			loop i over c
+				set v to i key
+				if i value = "blue"
+					erase i
+				end
+				increment n by v
+			end
+
+			set m to 0
+			loop j from 1 to 10
+				increment m
+				if j = 4
+					break
+				end
+				set w to j
+			end
+
+			set total to n + m
+
+			)";
+
+		auto script = TestExecuteScript(scriptText);
+		REQUIRE(script);
+		REQUIRE(script->GetVariable("n") == 6);
+		REQUIRE(script->GetVariable("m") == 4);
+		REQUIRE(script->GetVariable("total") == 10);
+		REQUIRE(script->GetVariable("v").IsNull());
+		REQUIRE(script->GetVariable("w").IsNull());
+	}
 }
\ No newline at end of file
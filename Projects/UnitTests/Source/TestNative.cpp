@@ -5,7 +5,12 @@ See LICENSE.TXT or Jinx.h for license details.
 Copyright (c) 2016 James Boer
 */
 
+#include <atomic>
+#include <chrono>
+#include <thread>
+
 #include "UnitTest.h"
+#include "../../../Source/JxArena.h"
 
 using namespace Jinx;
 
@@ -29,6 +34,34 @@ static Variant AnotherFunction(ScriptPtr script, Parameters params)
 	return "forty two";
 }
 
+static std::atomic<int> s_scheduledCallCount;
+
+static Variant CountCall(ScriptPtr script, Parameters params)
+{
+	++s_scheduledCallCount;
+	return 1;
+}
+
+static Variant Pause(ScriptPtr script, Parameters params)
+{
+	std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	return Variant();
+}
+
+static AsyncCallPtr s_asyncCall;
+static Variant s_asyncParam;
+
+static void FetchAsync(ScriptPtr script, Parameters params, AsyncCallPtr call)
+{
+	s_asyncCall = call;
+	s_asyncParam = params[0];
+}
+
+static void DoubleAsync(ScriptPtr script, Parameters params, AsyncCallPtr call)
+{
+	call->Complete(params[0] * 2);
+}
+
 static Variant YetAnotherFunction(ScriptPtr script, Parameters params)
 {
 	if (params.size() != 3)
@@ -101,6 +134,43 @@ TEST_CASE("Test Native", "[Native]")
 		REQUIRE(script->GetVariable("a") == 42);
 	}
 
+	SECTION("Test native property handles")
+	{
+		static const char * scriptText =
+			u8R"(
+			import test
+
+			set a to prop a
+			set b to prop b
+			set c to prop c
+			set prop a to 99
+
+			)";
+
+		auto runtime = TestCreateRuntime();
+		auto library = runtime->GetLibrary("test");
+		library->RegisterProperty(Visibility::Public, Access::ReadWrite, "prop a", 1);
+		library->RegisterProperty(Visibility::Public, Access::ReadWrite, "prop b", 2);
+		library->RegisterProperty(Visibility::Public, Access::ReadOnly, "prop c", 3);
+		auto handleA = library->GetPropertyHandle("prop a");
+		auto handleB = library->GetPropertyHandle("prop b");
+		auto handleC = library->GetPropertyHandle("prop c");
+		REQUIRE(handleA.IsValid());
+		REQUIRE(handleB.IsValid());
+		REQUIRE(handleC.IsValid());
+		REQUIRE(!library->GetPropertyHandle("prop d").IsValid());
+		library->SetProperty(handleA, 42);
+		std::pair<PropertyHandle, Variant> properties[] = { { handleB, "text" }, { handleC, 3.5 } };
+		library->SetProperties(properties, 2);
+		auto script = TestExecuteScript(scriptText, runtime);
+		REQUIRE(script);
+		REQUIRE(script->GetVariable("a") == 42);
+		REQUIRE(script->GetVariable("b") == "text");
+		REQUIRE(script->GetVariable("c") == 3.5);
+		REQUIRE(library->GetProperty(handleA) == 99);
+		REQUIRE(library->GetProperty(PropertyHandle()).IsNull());
+	}
+
 	SECTION("Test native variant Guid-String conversions")
 	{
 		static const char * guidStr = "06DF8818-07DB-4AAB-9BF6-3365D0F2D4C9";
@@ -109,4 +179,636 @@ TEST_CASE("Test Native", "[Native]")
 		Variant gs2 = gv.GetString();
 		REQUIRE(gs == gs2);
 	}
+
+	SECTION("Test scheduled script execution")
+	{
+		static const char * scriptText =
+			u8R"(
+			import test
+
+			set n to 0
+			loop from 1 to 3
+				increment n by count call
+				wait
+			end
+
+			)";
+
+		auto runtime = TestCreateRuntime();
+		auto library = runtime->GetLibrary("test");
+		library->RegisterFunction(Visibility::Public, ReturnValue::Required, { "count", "call" }, CountCall);
+		auto bytecode = runtime->Compile(scriptText);
+		REQUIRE(bytecode);
+		std::vector<ScriptPtr> scripts;
+		for (int i = 0; i < 100; ++i)
+		{
+			scripts.push_back(runtime->CreateScript(bytecode));
+			runtime->RegisterScript(scripts.back());
+		}
+		s_scheduledCallCount = 0;
+		uint32_t ticks = 0;
+		uint32_t finished = 0;
+		while (ticks < 10)
+		{
+			auto stats = runtime->RunTick();
+			if (stats.scriptCount == 0)
+				break;
+			REQUIRE(stats.errorCount == 0);
+			REQUIRE(stats.threadCount == 4);
+			finished += stats.finishedCount;
+			++ticks;
+		}
+		REQUIRE(ticks == 4);
+		REQUIRE(finished == 100);
+		REQUIRE(s_scheduledCallCount == 300);
+		for (const auto & script : scripts)
+		{
+			REQUIRE(script->IsFinished());
+			REQUIRE(script->GetVariable("n") == 3);
+		}
+	}
+
+	SECTION("Test scripts registered and unregistered more than once")
+	{
+		auto runtime = TestCreateRuntime();
+		auto bytecode = runtime->Compile("set n to 0\nloop from 1 to 3\nincrement n\nwait\nend\n");
+		REQUIRE(bytecode);
+		auto scriptA = runtime->CreateScript(bytecode);
+		auto scriptB = runtime->CreateScript(bytecode);
+		auto scriptC = runtime->CreateScript(bytecode);
+
+		// Scripts registered more than once, before or after a tick, are executed once each tick
+		runtime->RegisterScript(scriptA);
+		runtime->RegisterScript(scriptA);
+		runtime->RegisterScript(scriptB);
+		auto stats = runtime->RunTick();
+		REQUIRE(stats.scriptCount == 2);
+		REQUIRE(scriptA->GetVariable("n") == 1);
+		runtime->RegisterScript(scriptA);
+
+		// Scripts unregistered and registered again before a tick stay registered, while scripts
+		// registered and unregistered again aren't executed
+		runtime->UnregisterScript(scriptB);
+		runtime->RegisterScript(scriptB);
+		runtime->RegisterScript(scriptC);
+		runtime->UnregisterScript(scriptC);
+		stats = runtime->RunTick();
+		REQUIRE(stats.scriptCount == 2);
+		REQUIRE(scriptA->GetVariable("n") == 2);
+		REQUIRE(scriptB->GetVariable("n") == 2);
+		REQUIRE(scriptC->GetVariable("n").IsNull());
+
+		// Finished scripts are unregistered, and can be registered again
+		runtime->RunTick();
+		stats = runtime->RunTick();
+		REQUIRE(stats.finishedCount == 2);
+		REQUIRE(runtime->RunTick().scriptCount == 0);
+		runtime->RegisterScript(scriptA);
+		stats = runtime->RunTick();
+		REQUIRE(stats.scriptCount == 1);
+		REQUIRE(scriptA->GetVariable("n") == 1);
+	}
+
+	SECTION("Test executing scripts in batches")
+	{
+		auto runtime = TestCreateRuntime();
+		auto bytecodeA = runtime->Compile("set a to 1\nwait\nset a to 2\n");
+		auto bytecodeB = runtime->Compile("set b to 1\n");
+		REQUIRE(bytecodeA);
+		REQUIRE(bytecodeB);
+		std::vector<ScriptPtr> scripts;
+		for (int i = 0; i < 10; ++i)
+		{
+			scripts.push_back(runtime->CreateScript(i % 2 ? bytecodeA : bytecodeB));
+			scripts.push_back(nullptr);
+		}
+		std::reverse(scripts.begin(), scripts.end());
+
+		// Stats are recorded for each script executed, and null entries are moved to the end
+		runtime->GetScriptPerformanceStats(true);
+		REQUIRE(runtime->ExecuteScripts(scripts.data(), scripts.size()));
+		REQUIRE(runtime->GetScriptPerformanceStats(true).scriptExecutionCount == 10);
+		REQUIRE(std::count(scripts.begin(), scripts.begin() + 10, nullptr) == 0);
+		REQUIRE(runtime->ExecuteScripts(scripts.data(), scripts.size()));
+		for (int i = 0; i < 10; ++i)
+		{
+			REQUIRE(scripts[i]->IsFinished());
+			REQUIRE((scripts[i]->GetVariable("a") == 2 || scripts[i]->GetVariable("b") == 1));
+		}
+
+		// Errors in any script are reported for the batch
+		auto failed = runtime->CreateScript("set c to 1 / 0\n");
+		REQUIRE(failed);
+		scripts.push_back(failed);
+		REQUIRE(!runtime->ExecuteScripts(scripts.data(), scripts.size()));
+	}
+
+	SECTION("Test performance stats collected from multiple threads")
+	{
+		static const char * scriptText =
+			u8R"(
+			import test
+
+			function return twice {x}
+				return x * 2
+			end
+
+			set n to 1
+			loop from 1 to 10
+				set n to twice n
+				increment n by count call
+			end
+
+			)";
+
+		auto runtime = TestCreateRuntime();
+		auto library = runtime->GetLibrary("test");
+		library->RegisterFunction(Visibility::Public, ReturnValue::Required, { "count", "call" }, CountCall);
+		auto bytecode = runtime->Compile(scriptText);
+		REQUIRE(bytecode);
+
+		// Each thread adds to its own counters, which are summed when stats are retrieved
+		runtime->GetScriptPerformanceStats(true);
+		std::atomic<bool> success(true);
+		std::vector<std::thread> threads;
+		for (int i = 0; i < 4; ++i)
+		{
+			threads.push_back(std::thread([&]()
+			{
+				for (int j = 0; j < 25; ++j)
+				{
+					auto script = runtime->CreateScript(bytecode);
+					if (!script || !script->Execute() || script->GetVariable("n") != 2047)
+						success = false;
+				}
+			}));
+		}
+		for (auto & thread : threads)
+			thread.join();
+		REQUIRE(success);
+		auto stats = runtime->GetScriptPerformanceStats(true);
+		REQUIRE(stats.scriptExecutionCount == 100);
+		REQUIRE(stats.functionCallCount == 1000);
+		REQUIRE(stats.nativeCallCount == 1000);
+		REQUIRE(stats.allocationCount > 0);
+		REQUIRE(stats.instructionCount > 0);
+
+		// Resetting stats leaves every thread's counters at zero
+		stats = runtime->GetScriptPerformanceStats(true);
+		REQUIRE(stats.scriptExecutionCount == 0);
+		REQUIRE(stats.functionCallCount == 0);
+		REQUIRE(stats.instructionCount == 0);
+	}
+
+	SECTION("Test scheduled scripts suspended while waiting")
+	{
+		static const char * scriptText =
+			u8R"(
+			import test
+
+			wait until go
+			set a to 1
+
+			)";
+
+		auto runtime = TestCreateRuntime();
+		auto library = runtime->GetLibrary("test");
+		library->RegisterProperty(Visibility::Public, Access::ReadWrite, "go", false);
+		auto bytecode = runtime->Compile(scriptText);
+		REQUIRE(bytecode);
+		std::vector<ScriptPtr> scripts;
+		for (int i = 0; i < 50; ++i)
+		{
+			scripts.push_back(runtime->CreateScript(bytecode));
+			runtime->RegisterScript(scripts.back());
+		}
+
+		// Scripts arm their waits on the first tick, and are suspended on the second
+		REQUIRE(runtime->RunTick().scriptCount == 50);
+		auto stats = runtime->RunTick();
+		REQUIRE(stats.scriptCount == 50);
+		REQUIRE(stats.suspendedCount == 50);
+		REQUIRE(runtime->RunTick().scriptCount == 0);
+
+		// Setting the property reschedules the scripts
+		library->SetProperty("go", true);
+		stats = runtime->RunTick();
+		REQUIRE(stats.scriptCount == 50);
+		REQUIRE(stats.finishedCount == 50);
+		for (const auto & script : scripts)
+			REQUIRE(script->GetVariable("a") == 1);
+	}
+
+	SECTION("Test scheduled scripts sleeping in timed waits")
+	{
+		auto runtime = TestCreateRuntime();
+		std::vector<ScriptPtr> scripts;
+		const double durations[] = { 0.1, 0.3, 5.0, 70.0, 20000.0 };
+		for (auto duration : durations)
+		{
+			std::string scriptText = "wait " + std::to_string(duration) + " seconds\nset a to 1\n";
+			auto bytecode = runtime->Compile(scriptText.c_str());
+			REQUIRE(bytecode);
+			for (int i = 0; i < 20; ++i)
+			{
+				scripts.push_back(runtime->CreateScript(bytecode));
+				runtime->RegisterScript(scripts.back());
+			}
+		}
+
+		// Scripts are suspended on their first tick, and each group wakes when the clock reaches its deadline
+		auto stats = runtime->RunTick();
+		REQUIRE(stats.scriptCount == 100);
+		REQUIRE(stats.suspendedCount == 100);
+		for (auto duration : durations)
+		{
+			runtime->UpdateClock(duration - 0.05);
+			REQUIRE(runtime->RunTick().scriptCount == 0);
+			runtime->UpdateClock(duration);
+			stats = runtime->RunTick();
+			REQUIRE(stats.scriptCount == 20);
+			REQUIRE(stats.finishedCount == 20);
+		}
+		for (const auto & script : scripts)
+			REQUIRE(script->GetVariable("a") == 1);
+	}
+
+	SECTION("Test scripts yielding at their maximum execution time")
+	{
+		static const char * scriptText =
+			u8R"(
+			import test
+
+			set count to 0
+			loop while count < 10
+				pause
+				increment count
+			end
+
+			)";
+
+		auto runtime = TestCreateRuntime();
+		auto library = runtime->GetLibrary("test");
+		library->RegisterFunction(Visibility::Public, ReturnValue::None, { "pause" }, Pause);
+		auto script = runtime->CreateScript(scriptText);
+		REQUIRE(script);
+		script->SetMaxExecutionTime(3000000);
+		REQUIRE(script->Execute());
+		REQUIRE(!script->IsFinished());
+		REQUIRE(script->GetVariable("count") > 0);
+		REQUIRE(script->GetVariable("count") < 10);
+		int executeCount = 1;
+		while (!script->IsFinished() && executeCount < 20)
+		{
+			REQUIRE(script->Execute());
+			++executeCount;
+		}
+		REQUIRE(script->IsFinished());
+		REQUIRE(script->GetVariable("count") == 10);
+	}
+
+	SECTION("Test scheduled scripts deferred by the tick time limit")
+	{
+		static const char * scriptText =
+			u8R"(
+			import test
+
+			pause
+			set a to 1
+
+			)";
+
+		auto runtime = TestCreateRuntime();
+		auto library = runtime->GetLibrary("test");
+		library->RegisterFunction(Visibility::Public, ReturnValue::None, { "pause" }, Pause);
+		auto bytecode = runtime->Compile(scriptText);
+		REQUIRE(bytecode);
+		std::vector<ScriptPtr> scripts;
+		for (int i = 0; i < 8; ++i)
+		{
+			scripts.push_back(runtime->CreateScript(bytecode));
+			runtime->RegisterScript(scripts.back());
+		}
+
+		// Scripts not started before the limit passes are deferred, and executed in later ticks
+		auto stats = runtime->RunTick(3000000);
+		REQUIRE(stats.deferredCount > 0);
+		REQUIRE(stats.scriptCount + stats.deferredCount == 8);
+		uint32_t finished = stats.finishedCount;
+		for (int i = 0; i < 20 && finished < 8; ++i)
+		{
+			stats = runtime->RunTick(3000000);
+			REQUIRE(stats.errorCount == 0);
+			finished += stats.finishedCount;
+		}
+		REQUIRE(finished == 8);
+		for (const auto & script : scripts)
+			REQUIRE(script->GetVariable("a") == 1);
+	}
+
+	SECTION("Test asynchronous native functions")
+	{
+		static const char * scriptText =
+			u8R"(
+			import test
+
+			function return fetch twice {x}
+				return fetch x * 2
+			end
+
+			set a to fetch 21
+			set b to fetch twice 5
+			set c to double now 4
+
+			)";
+
+		auto runtime = TestCreateRuntime();
+		auto library = runtime->GetLibrary("test");
+		library->RegisterAsyncFunction(Visibility::Public, ReturnValue::Required, { "fetch", "{}" }, FetchAsync);
+		library->RegisterAsyncFunction(Visibility::Public, ReturnValue::Required, { "double", "now", "{}" }, DoubleAsync);
+		auto script = runtime->CreateScript(scriptText);
+		REQUIRE(script);
+
+		// The script is suspended at the call until it's completed from another thread
+		REQUIRE(script->Execute());
+		REQUIRE(s_asyncCall);
+		REQUIRE(s_asyncParam == 21);
+		runtime->GetScriptPerformanceStats(true);
+		REQUIRE(script->Execute());
+		REQUIRE(runtime->GetScriptPerformanceStats(true).instructionCount == 0);
+		auto call = std::move(s_asyncCall);
+		std::thread([call]() { call->Complete(42); }).join();
+
+		// Calls in tail position return their result from the calling function
+		REQUIRE(script->Execute());
+		REQUIRE(!script->IsFinished());
+		REQUIRE(s_asyncCall);
+		REQUIRE(s_asyncParam == 10);
+		s_asyncCall->Complete(20);
+		s_asyncCall->Complete(30);
+		s_asyncCall.reset();
+
+		// Calls completed immediately don't suspend the script
+		REQUIRE(script->Execute());
+		REQUIRE(script->IsFinished());
+		REQUIRE(script->GetVariable("a") == 42);
+		REQUIRE(script->GetVariable("b") == 20);
+		REQUIRE(script->GetVariable("c") == 8);
+	}
+
+	SECTION("Test memory stats of allocations freed by other threads")
+	{
+		// Allocations made from one thread's cache and freed by another thread are still counted
+		auto before = GetMemoryStats();
+		std::vector<void *> allocations;
+		std::thread([&]()
+		{
+			for (size_t i = 0; i < 1000; ++i)
+				allocations.push_back(JinxAlloc(16 + i % 200));
+			for (size_t i = 0; i < 500; ++i)
+				JinxFree(allocations[i]);
+		}).join();
+		for (size_t i = 500; i < allocations.size(); ++i)
+			JinxFree(allocations[i]);
+		auto after = GetMemoryStats();
+		REQUIRE(after.internalAllocCount - before.internalAllocCount == 1000);
+		REQUIRE(after.internalFreeCount - before.internalFreeCount == 1000);
+		REQUIRE(after.currentUsedMemory == before.currentUsedMemory);
+	}
+
+	SECTION("Test freed memory reused by allocations of the same size")
+	{
+		// Long-lived allocations keep their blocks from being freed, fragmenting memory
+		std::vector<void *> allocations;
+		std::thread([&]()
+		{
+			for (size_t i = 0; i < 2000; ++i)
+				allocations.push_back(JinxAlloc(48));
+		}).join();
+		for (size_t i = 0; i < allocations.size(); ++i)
+		{
+			if (i % 100)
+				JinxFree(allocations[i]);
+		}
+		auto before = GetMemoryStats();
+		REQUIRE(before.currentFreeListMemory > 0);
+		REQUIRE(before.fragmentation > 0.0);
+
+		// Freed allocations are reused instead of allocating new blocks
+		std::vector<void *> reused;
+		for (size_t i = 0; i < 1980; ++i)
+			reused.push_back(JinxAlloc(48));
+		auto after = GetMemoryStats();
+		REQUIRE(after.currentAllocatedMemory == before.currentAllocatedMemory);
+		REQUIRE(after.fragmentation < before.fragmentation);
+		for (auto allocation : reused)
+			JinxFree(allocation);
+		for (size_t i = 0; i < allocations.size(); i += 100)
+			JinxFree(allocations[i]);
+	}
+
+	SECTION("Test small container allocations freed by other threads")
+	{
+		// Small allocations made through Allocator and freed by another thread are reused by their owner
+		struct Object { uint64_t values[4]; };
+		Allocator<Object> allocator;
+		auto before = GetMemoryStats();
+		std::vector<Object *> objects;
+		for (size_t i = 0; i < 1000; ++i)
+			objects.push_back(allocator.allocate(1));
+		auto allocated = GetMemoryStats();
+		std::thread([&]()
+		{
+			for (size_t i = 0; i < 500; ++i)
+				allocator.deallocate(objects[i], 1);
+		}).join();
+		for (size_t i = 0; i < 500; ++i)
+			objects[i] = allocator.allocate(1);
+		auto reused = GetMemoryStats();
+		REQUIRE(reused.currentAllocatedMemory == allocated.currentAllocatedMemory);
+		for (auto object : objects)
+			allocator.deallocate(object, 1);
+		auto after = GetMemoryStats();
+		REQUIRE(after.internalAllocCount - before.internalAllocCount == 1500);
+		REQUIRE(after.internalFreeCount - before.internalFreeCount == 1500);
+		REQUIRE(after.currentUsedMemory == before.currentUsedMemory);
+	}
+
+	SECTION("Test script stacks allocated from the script's arena")
+	{
+		static const char * scriptText =
+			u8R"(
+
+			function return factorial { x }
+				if x <= 1
+					return 1
+				end
+				return x * factorial (x - 1)
+			end
+
+			set a to factorial 20
+
+			)";
+
+		// Scripts of a runtime with arenas make fewer allocations, since their stacks grow within the arena
+		TestCreateRuntime();
+		RuntimeParams params;
+		params.scriptArenaSize = 0;
+		auto heapRuntime = CreateRuntime(params);
+		params.scriptArenaSize = 1024 * 2;
+		auto arenaRuntime = CreateRuntime(params);
+		uint64_t allocCounts[2];
+		RuntimePtr runtimes[2] = { heapRuntime, arenaRuntime };
+		for (int i = 0; i < 2; ++i)
+		{
+			auto bytecode = runtimes[i]->Compile(scriptText);
+			REQUIRE(bytecode);
+			auto first = runtimes[i]->CreateScript(bytecode);
+			REQUIRE(first->Execute());
+			REQUIRE(first->GetVariable("a") == 2432902008176640000);
+
+			// All of the script's memory is released when it's destroyed
+			auto before = GetMemoryStats();
+			uint64_t allocCount = GetThreadAllocationCount();
+			auto script = runtimes[i]->CreateScript(bytecode);
+			REQUIRE(script->Execute());
+			REQUIRE(script->IsFinished());
+			allocCounts[i] = GetThreadAllocationCount() - allocCount;
+			script = nullptr;
+			auto after = GetMemoryStats();
+			REQUIRE(after.currentUsedMemory == before.currentUsedMemory);
+		}
+		REQUIRE(allocCounts[1] < allocCounts[0]);
+	}
+
+	SECTION("Test arena allocations")
+	{
+		// Allocations are made contiguously from the arena's chunk
+		Arena arena(256);
+		auto first = static_cast<uint8_t *>(arena.Allocate(64));
+		auto second = static_cast<uint8_t *>(arena.Allocate(64));
+		REQUIRE(second == first + 64);
+
+		// Freeing the most recent allocation returns it to the arena, while other freed memory is kept
+		arena.Free(second, 64);
+		REQUIRE(arena.Allocate(64) == second);
+		arena.Free(first, 64);
+		REQUIRE(arena.Allocate(64) == second + 64);
+		REQUIRE(arena.GetCapacity() == 256);
+
+		// Allocations larger than the rest of the chunk grow the arena with a chunk twice the size
+		auto third = static_cast<uint8_t *>(arena.Allocate(192));
+		REQUIRE(arena.GetCapacity() == 256 + 512);
+		REQUIRE(arena.Allocate(64) == third + 192);
+	}
+
+	SECTION("Test runtimes allocating from private heaps")
+	{
+		static const char * scriptText =
+			u8R"(
+
+			set s to ""
+			set c to [1, "one"], [2, "two"]
+			loop i from 1 to 100
+				set s to s + "text"
+				set c [i] to s
+			end
+
+			)";
+
+		// Each runtime's memory is allocated from its own heap, isolated from the global heap
+		TestCreateRuntime();
+		auto globalBefore = GetMemoryStats();
+		RuntimeParams params;
+		params.privateHeap = true;
+		auto runtimeA = CreateRuntime(params);
+		auto runtimeB = CreateRuntime(params);
+		auto globalCreated = GetMemoryStats();
+		auto statsB = runtimeB->GetMemoryStats();
+		auto script = runtimeA->CreateScript(scriptText);
+		REQUIRE(script);
+		REQUIRE(script->Execute());
+		REQUIRE(script->GetVariable("s").GetString().size() == 400);
+		REQUIRE(runtimeA->GetMemoryStats().currentUsedMemory > statsB.currentUsedMemory);
+		REQUIRE(runtimeB->GetMemoryStats().currentUsedMemory == statsB.currentUsedMemory);
+		REQUIRE(GetMemoryStats().currentUsedMemory == globalCreated.currentUsedMemory);
+
+		// A runtime's heap is destroyed along with its remaining memory once the runtime is released
+		script = nullptr;
+		runtimeA = nullptr;
+		runtimeB = nullptr;
+		REQUIRE(GetMemoryStats().currentUsedMemory == globalBefore.currentUsedMemory);
+	}
+
+	SECTION("Test empty blocks freed when cycling runtimes")
+	{
+		// Runtimes fit in a heap's default block size, so a compiled runtime's heap holds a single block
+		// and a span of slab pages
+		TestCreateRuntime();
+		RuntimeParams params;
+		params.privateHeap = true;
+		auto globalBefore = GetMemoryStats();
+		for (int i = 0; i < 100; ++i)
+		{
+			auto runtime = CreateRuntime(params);
+			REQUIRE(runtime->Compile("set a to 1"));
+			REQUIRE(runtime->GetMemoryStats().currentBlockCount <= 2);
+		}
+		REQUIRE(GetMemoryStats().currentBlockCount == globalBefore.currentBlockCount);
+
+		// Allocations too large for an emptied tail block don't leave it behind the new block
+		BlockHeap * heap = CreateHeap(params);
+		{
+			HeapScope scope(heap);
+			void * first = JinxAlloc(64);
+			for (int i = 0; i < 100; ++i)
+			{
+				void * large = JinxAlloc(1024 * 24);
+				void * small = JinxAlloc(64);
+				JinxFree(large);
+				JinxFree(small);
+			}
+			REQUIRE(GetMemoryStats(heap).currentBlockCount == 2);
+			JinxFree(first);
+		}
+		ReleaseHeap(heap);
+		REQUIRE(GetMemoryStats().currentUsedMemory == globalBefore.currentUsedMemory);
+	}
+
+	SECTION("Test properties accessed from multiple threads")
+	{
+		auto runtime = TestCreateRuntime();
+		auto library = runtime->GetLibrary("test");
+		library->RegisterProperty(Visibility::Public, Access::ReadOnly, "shared", 1);
+		std::vector<BufferPtr> bytecodes;
+		for (int i = 0; i < 4; ++i)
+		{
+			std::string name = "counter" + std::to_string(i);
+			library->RegisterProperty(Visibility::Public, Access::ReadWrite, name.c_str(), 0);
+			std::string scriptText = "import test\nloop from 1 to 100\nset " + name + " to " + name + " + shared\nend\n";
+			bytecodes.push_back(runtime->Compile(scriptText.c_str()));
+			REQUIRE(bytecodes.back());
+		}
+
+		// Register more properties while scripts run, growing the runtime's property table
+		std::atomic<bool> success(true);
+		std::vector<std::thread> threads;
+		for (int i = 0; i < 4; ++i)
+		{
+			threads.push_back(std::thread([&, i]()
+			{
+				auto script = runtime->CreateScript(bytecodes[i]);
+				if (!script || !script->Execute() || !script->IsFinished())
+					success = false;
+			}));
+		}
+		for (int i = 0; i < 100; ++i)
+			library->RegisterProperty(Visibility::Public, Access::ReadWrite, ("extra" + std::to_string(i)).c_str(), i);
+		for (auto & thread : threads)
+			thread.join();
+		REQUIRE(success);
+		for (int i = 0; i < 4; ++i)
+			REQUIRE(library->GetProperty(("counter" + std::to_string(i)).c_str()) == 100);
+		REQUIRE(library->GetProperty("extra99") == 99);
+	}
 }
\ No newline at end of file
@@ -110,6 +110,28 @@ multiline comment
 		REQUIRE(script->GetVariable("some null") == nullptr);
 	}
 
+	SECTION("Test equivalent constants of different types")
+	{
+		const char * scriptText =
+			u8R"(
+
+			set a to 1
+			set b to 1.0
+			set c to "1"
+			set d to true
+			set e to 1
+
+			)";
+
+		auto script = TestExecuteScript(scriptText);
+		REQUIRE(script);
+		REQUIRE(script->GetVariable("a").IsInteger());
+		REQUIRE(script->GetVariable("b").IsNumber());
+		REQUIRE(script->GetVariable("c").IsString());
+		REQUIRE(script->GetVariable("d").IsBoolean());
+		REQUIRE(script->GetVariable("e") == 1);
+	}
+
 	SECTION("Test variable and property type")
 	{
 		const char * scriptText =
@@ -411,6 +433,103 @@ multiline comment
 		REQUIRE(library->GetProperty("counter") == 10);
 	}
 
+	SECTION("Test wait until suspended until property is set")
+	{
+		const char * scriptText =
+			u8R"(
+	
+			set private ready to false
+			wait until ready
+			set a to 1
+
+			)";
+
+		auto runtime = TestCreateRuntime();
+		auto script = TestCreateScript(scriptText, runtime);
+		REQUIRE(script);
+		REQUIRE(script->Execute());
+		REQUIRE(script->Execute());
+		REQUIRE(!script->IsFinished());
+
+		// Suspended scripts don't execute any instructions
+		runtime->GetScriptPerformanceStats(true);
+		for (int i = 0; i < 10; ++i)
+			REQUIRE(script->Execute());
+		REQUIRE(runtime->GetScriptPerformanceStats(true).instructionCount == 0);
+		REQUIRE(!script->IsFinished());
+
+		script->GetLibrary()->SetProperty("ready", true);
+		REQUIRE(script->Execute());
+		REQUIRE(script->IsFinished());
+		REQUIRE(script->GetVariable("a") == 1);
+	}
+
+	SECTION("Test wait while suspended until variable is set")
+	{
+		const char * scriptText =
+			u8R"(
+	
+			set x to 0
+			wait while x < 3
+			set a to x
+
+			)";
+
+		auto runtime = TestCreateRuntime();
+		auto script = TestCreateScript(scriptText, runtime);
+		REQUIRE(script);
+		REQUIRE(script->Execute());
+		REQUIRE(script->Execute());
+		runtime->GetScriptPerformanceStats(true);
+		REQUIRE(script->Execute());
+		REQUIRE(runtime->GetScriptPerformanceStats(true).instructionCount == 0);
+		script->SetVariable("x", 3);
+		REQUIRE(script->Execute());
+		REQUIRE(script->IsFinished());
+		REQUIRE(script->GetVariable("a") == 3);
+	}
+
+	SECTION("Test timed wait suspended until clock is updated")
+	{
+		const char * scriptText =
+			u8R"(
+
+			set a to 1
+			wait 2.5 seconds
+			set a to 2
+			wait 1 second
+			set a to 3
+
+			)";
+
+		auto runtime = TestCreateRuntime();
+		auto script = TestCreateScript(scriptText, runtime);
+		REQUIRE(script);
+		REQUIRE(script->Execute());
+		REQUIRE(script->GetVariable("a") == 1);
+
+		// Sleeping scripts don't execute any instructions, and setting variables doesn't wake them
+		runtime->GetScriptPerformanceStats(true);
+		script->SetVariable("a", 1);
+		for (int i = 0; i < 10; ++i)
+			REQUIRE(script->Execute());
+		REQUIRE(runtime->GetScriptPerformanceStats(true).instructionCount == 0);
+
+		runtime->UpdateClock(2.0);
+		REQUIRE(script->Execute());
+		REQUIRE(script->GetVariable("a") == 1);
+		runtime->UpdateClock(2.5);
+		REQUIRE(script->Execute());
+		REQUIRE(script->GetVariable("a") == 2);
+		runtime->UpdateClock(3.4);
+		REQUIRE(script->Execute());
+		REQUIRE(!script->IsFinished());
+		runtime->UpdateClock(3.5);
+		REQUIRE(script->Execute());
+		REQUIRE(script->IsFinished());
+		REQUIRE(script->GetVariable("a") == 3);
+	}
+
 	SECTION("Test external statement")
 	{
 		const char * scriptText =
@@ -428,4 +547,22 @@ multiline comment
 		REQUIRE(script->GetVariable("another var") == 123);
 	}
 
+	SECTION("Test variables set by host but not used by script")
+	{
+		const char * scriptText =
+			u8R"(
+	
+			set a to 1
+
+			)";
+
+		auto script = TestCreateScript(scriptText);
+		REQUIRE(script);
+		script->SetVariable("some var", 123);
+		script->Execute();
+		REQUIRE(script->GetVariable("some var") == 123);
+		REQUIRE(script->GetVariable("a") == 1);
+		REQUIRE(script->GetVariable("another var").IsNull());
+	}
+
 }
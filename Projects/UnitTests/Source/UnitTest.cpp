@@ -21,6 +21,7 @@ Jinx::RuntimePtr TestCreateRuntime()
 		globalParams.allocFn = [](size_t size) { return malloc(size); };
 		globalParams.reallocFn = [](void * p, size_t size) { return realloc(p, size); };
 		globalParams.freeFn = [](void * p) { free(p); };
+		globalParams.schedulerThreads = 4;
 		Jinx::Initialize(globalParams);
 
 		s_initializedGlobals = true;
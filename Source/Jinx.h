@@ -100,6 +100,36 @@ namespace Jinx
 	// Signature for native function callback
 	typedef std::function<Variant(ScriptPtr, const Parameters &)> FunctionCallback;
 
+	/// Completion token for an asynchronous native function call
+	/**
+	Asynchronous native functions receive a token along with their parameters, and the calling
+	script is suspended until the token is completed.  The token may be kept and completed later
+	from any thread, such as a job thread performing the function's work.  A script whose call is
+	never completed remains suspended.
+	\sa ILibrary::RegisterAsyncFunction()
+	*/
+	class IAsyncCall
+	{
+	public:
+
+		/// Complete the function call
+		/**
+		The suspended script resumes the next time it's executed, with the result returned from the
+		function call.  Only the first call to Complete() has any effect.
+		\param result The function's return value, ignored if the function doesn't return a value
+		*/
+		virtual void Complete(const Variant & result = Variant()) = 0;
+
+	protected:
+		virtual ~IAsyncCall() {}
+	};
+
+	/// Shared pointer to asynchronous call token
+	typedef std::shared_ptr<IAsyncCall> AsyncCallPtr;
+
+	// Signature for asynchronous native function callback
+	typedef std::function<void(ScriptPtr, const Parameters &, AsyncCallPtr)> AsyncFunctionCallback;
+
 	enum class Visibility
 	{
 		Public,
@@ -118,12 +148,37 @@ namespace Jinx
 		Required,
 	};
 
+	// Forward declarations
+	class Library;
+	class PropertySlot;
+
+	/// Handle for fast native access to a property
+	/**
+	PropertyHandle refers directly to a property's storage, so property values can be retrieved or
+	set without looking up the property by name.  Handles are retrieved with ILibrary::GetPropertyHandle(),
+	and remain valid as long as the runtime owning the property exists.
+	*/
+	class PropertyHandle
+	{
+	public:
+		PropertyHandle() : m_slot(nullptr) {}
+
+		/// Does this handle refer to a property?
+		bool IsValid() const { return m_slot != nullptr; }
+
+	private:
+		friend class Library;
+		explicit PropertyHandle(PropertySlot * slot) : m_slot(slot) {}
+		PropertySlot * m_slot;
+	};
+
 	/// ILibrary represents a single module of script code.
 	/** 
 	Multiple scripts can be compiled as part of a single library.  This interface allows the creation of
 	native functions that script code can execute via RegisterFunction() and properties through the use
 	of the RegisterProperty() function.  You can also get or set property values using the GetProperty()
-	and SetProperty() functions.
+	and SetProperty() functions.  Native code frequently accessing a property should retrieve a handle
+	with GetPropertyHandle() once, and use the handle to access the property without name lookups.
 	*/
 	class ILibrary
 	{
@@ -141,6 +196,20 @@ namespace Jinx
 		*/
 		virtual bool RegisterFunction(Visibility visibility, ReturnValue returnValue, std::initializer_list<String> name, FunctionCallback function) = 0;
 
+		/// Register an asynchronous native function for use by scripts
+		/**
+		This method registers a native function which doesn't return its result immediately.  Scripts
+		calling the function are suspended until the call's completion token is completed, and then
+		continue with the function's result the next time they're executed.
+		\param visibility Indicates whether property is public or private.
+		\param returnValue Indicates whether this function requires a return value or not.
+		\param name A list of names and parameters, following the same rules as RegisterFunction().
+		\param function The callback function executed by the script, which receives the call's completion token.
+		\return Returns true on success or false on failure.
+		\sa IAsyncCall
+		*/
+		virtual bool RegisterAsyncFunction(Visibility visibility, ReturnValue returnValue, std::initializer_list<String> name, AsyncFunctionCallback function) = 0;
+
 		/// Register a property for use by scripts
 		/**
 		This method registers a library property.
@@ -169,6 +238,41 @@ namespace Jinx
 		*/
 		virtual void SetProperty(const String & name, const Variant & value) = 0;
 
+		/// Get property handle
+		/**
+		This method retrieves a handle for fast access to a property.
+		\param name Property name to retrieve a handle for
+		\return Returns a handle for the indicated property.  Returns an invalid handle if the property
+		has not been registered and assigned a value.
+		\sa PropertyHandle
+		*/
+		virtual PropertyHandle GetPropertyHandle(const String & name) const = 0;
+
+		/// Get property value by handle
+		/**
+		This method retrieves a property value without looking up the property by name.
+		\param handle Handle of the property to retrieve
+		\return Returns the indicated property value.  Returns a null Variant if the handle is invalid.
+		*/
+		virtual Variant GetProperty(PropertyHandle handle) const = 0;
+
+		/// Set property value by handle
+		/**
+		This method sets a property value without looking up the property by name.
+		\param handle Handle of the property to set
+		\param value Variant value to set
+		*/
+		virtual void SetProperty(PropertyHandle handle, const Variant & value) = 0;
+
+		/// Set multiple property values by handle
+		/**
+		This method sets a number of property values with a single call, for native code updating many
+		properties each tick.
+		\param properties Array of property handles and values to set
+		\param count Number of properties in the array
+		*/
+		virtual void SetProperties(const std::pair<PropertyHandle, Variant> * properties, size_t count) = 0;
+
 	protected:
 		virtual ~ILibrary() {}
 	};
@@ -192,11 +296,28 @@ namespace Jinx
 		/// Execute the script
 		/**
 		The client is responsible for calling Execute() once per simulation tick until the
-		script is finished executing, which is checked with the IsFinished() function.
+		script is finished executing, which is checked with the IsFinished() function.  A script
+		waiting with `wait until` or `wait while` on a condition that only reads properties,
+		variables, and constants is suspended, and Execute() returns immediately without
+		evaluating the condition until one of the properties or variables is set.  A script
+		executing a timed wait, such as `wait 2.5 seconds`, is suspended until the runtime's
+		clock reaches the end of the wait.  If the script has a maximum execution time, it
+		yields once the time has passed, and continues from that point in the next call.
 		\return true if executed successfully and false if an error has occured.
+		\sa SetMaxExecutionTime()
 		*/
 		virtual bool Execute() = 0;
 
+		/// Set the maximum execution time of each call to Execute()
+		/**
+		Scripts check the time at loop iterations and function calls, so a script may exceed the
+		limit by the time taken to reach the next check.  Scripts begin with the time limit set by
+		GlobalParams::maxExecutionTimeNs.
+		\param timeNs The maximum execution time in nanoseconds, or zero for no time limit
+		\sa Execute()
+		*/
+		virtual void SetMaxExecutionTime(uint64_t timeNs) = 0;
+
 		/// Checks if the script is finished executing
 		/**
 		Determines if the script has finished executed or hit a fatal error
@@ -243,7 +364,10 @@ namespace Jinx
 			executionTimeNs(0),
 			scriptCompilationCount(0),
 			scriptExecutionCount(0),
-			instructionCount(0)
+			instructionCount(0),
+			functionCallCount(0),
+			nativeCallCount(0),
+			allocationCount(0)
 		{}
 		/// Total compilation time of all scripts in nanoseconds
 		uint64_t compilationTimeNs;
@@ -255,11 +379,62 @@ namespace Jinx
 		uint32_t scriptExecutionCount;
 		/// Number of instructions executed
 		uint64_t instructionCount;
+		/// Number of script function calls, each pushing an execution frame
+		uint64_t functionCallCount;
+		/// Number of native function calls
+		uint64_t nativeCallCount;
+		/// Number of memory allocations made while executing scripts
+		uint64_t allocationCount;
+	};
+
+	/// Scheduler stats
+	/**
+	Struct that contains stats from a single scheduler tick, returned by IRuntime::RunTick().
+	\sa IRuntime::RunTick()
+	*/
+	struct SchedulerStats
+	{
+		SchedulerStats() :
+			scriptCount(0),
+			finishedCount(0),
+			errorCount(0),
+			suspendedCount(0),
+			deferredCount(0),
+			threadCount(0),
+			stealCount(0),
+			tickTimeNs(0)
+		{}
+		/// Number of scripts executed during the tick
+		uint32_t scriptCount;
+		/// Number of scripts that finished executing during the tick
+		uint32_t finishedCount;
+		/// Number of scripts that stopped with a runtime error during the tick
+		uint32_t errorCount;
+		/// Number of scripts suspended until a value their wait condition reads changes, or until
+		/// a timed wait ends.  Suspended scripts aren't executed again until woken.
+		uint32_t suspendedCount;
+		/// Number of scripts not executed because the tick's time limit had passed.  Deferred
+		/// scripts are executed first in the next tick.
+		uint32_t deferredCount;
+		/// Number of threads that executed scripts, including the calling thread
+		uint32_t threadCount;
+		/// Number of batches of scripts taken from another thread's queue
+		uint32_t stealCount;
+		/// Total duration of the tick in nanoseconds
+		uint64_t tickTimeNs;
 	};
 
 	/// Jinx runtime interface
 	/** 
 	The Jinx runtime interface represents the entire runtime scripting environment.
+
+	Scripts created by the same runtime may execute concurrently on different threads, either
+	by the runtime's scheduler, or by the client calling IScript::Execute() from multiple
+	threads.  An individual script must only be executed by one thread at a time.  Bytecode,
+	functions, properties, and libraries are shared by all scripts, and are safe to access
+	concurrently.  Native function callbacks may be called from any thread executing scripts,
+	and collection values shared between scripts, such as through properties, are not
+	synchronized.
 	*/
 	class IRuntime
 	{
@@ -312,6 +487,21 @@ namespace Jinx
 		*/
 		virtual ScriptPtr ExecuteScript(const char * scriptText, String uniqueName = String(), std::initializer_list<String> libraries = {}) = 0;
 
+		/// Execute a batch of scripts
+		/**
+		Executes each script once on the calling thread, as if calling IScript::Execute() for each,
+		but records performance stats once for the whole batch, which is considerably cheaper when
+		executing many small scripts.  After executing, the array is sorted into the order scripts
+		are laid out in memory, which improves cache locality when the same batch is executed
+		again.  Batches may be executed concurrently on different threads, as long as no
+		script appears in more than one batch at a time.
+		\param scripts An array of scripts to execute.  Null entries are skipped.
+		\param count Number of scripts in the array
+		\return true if every script executed successfully, and false if any encountered an error
+		\sa IScript::Execute(), RunTick()
+		*/
+		virtual bool ExecuteScripts(ScriptPtr * scripts, size_t count) = 0;
+
 		/// Retrieve library by name or create empty library if not found
 		/**
 		\param name Name of the library to create or retrieve
@@ -329,6 +519,57 @@ namespace Jinx
 		*/
 		virtual PerformanceStats GetScriptPerformanceStats(bool resetStats = true) = 0;
 
+		/// Get memory stats
+		/**
+		Retrieve stats of the heap this runtime allocates from.  Runtimes created without a
+		private heap share the global heap, and report global memory stats.
+		\return A MemoryStats structure containing memory usage statistics
+		\sa RuntimeParams::privateHeap
+		*/
+		virtual MemoryStats GetMemoryStats() const = 0;
+
+		/// Register a script with the scheduler
+		/**
+		Registered scripts are executed once each time RunTick() is called, until they finish
+		executing or encounter an error, at which point they're automatically unregistered.
+		The scheduler doesn't keep scripts alive, so scripts released by the client are also
+		unregistered.  Scripts registered during a tick are first executed in the next tick.
+		Registering an already registered script has no effect.
+		\param script The script to register
+		\sa RunTick(), UnregisterScript()
+		*/
+		virtual void RegisterScript(ScriptPtr script) = 0;
+
+		/// Unregister a script from the scheduler
+		/**
+		\param script The script to unregister
+		\sa RegisterScript()
+		*/
+		virtual void UnregisterScript(ScriptPtr script) = 0;
+
+		/// Execute all registered scripts
+		/**
+		Executes each registered script once, spreading execution across the scheduler's thread
+		pool.  The calling thread also executes scripts, and the function returns when all
+		registered scripts have executed.  Only one thread may call RunTick() at a time.  If a
+		time limit is specified, scripts executing when it passes yield as they would on reaching
+		their own maximum execution time, and scripts not yet executed are deferred to the next tick.
+		\param maxTickTimeNs The maximum duration of the tick in nanoseconds, or zero for no time limit
+		\return A SchedulerStats structure containing stats for this tick
+		\sa RegisterScript(), SchedulerStats, GlobalParams::schedulerThreads, IScript::SetMaxExecutionTime()
+		*/
+		virtual SchedulerStats RunTick(uint64_t maxTickTimeNs = 0) = 0;
+
+		/// Update the runtime clock
+		/**
+		Sets the time of the clock used by timed wait statements, such as `wait 2.5 seconds`,
+		waking scripts whose waits have ended.  Time is measured in seconds from a starting point
+		chosen by the client, begins at zero, and must never decrease.  Scripts sleeping in a timed
+		wait won't resume unless the client updates the clock.
+		\param time The current time in seconds
+		*/
+		virtual void UpdateClock(double time) = 0;
+
 	protected:
 		virtual ~IRuntime() {}
 	};
@@ -357,6 +598,41 @@ namespace Jinx
 	typedef std::function<void(const char *)> LogFn;
 
 
+	/// Parameters of an individual runtime
+	/**
+	\sa CreateRuntime()
+	*/
+	struct RuntimeParams
+	{
+		RuntimeParams() :
+			privateHeap(false),
+			allocBlockSize(8192),
+			scriptArenaSize(std::numeric_limits<size_t>::max())
+		{}
+		/// Allocate the runtime's strings, collections, and scripts from a heap owned by the runtime,
+		/// isolating its memory use and stats from other runtimes
+		bool privateHeap;
+		/// Alloc memory function of the private heap, or empty to use the global function
+		AllocFn allocFn;
+		/// Realloc memory function of the private heap, or empty to use the global function
+		ReallocFn reallocFn;
+		/// Free memory function of the private heap, or empty to use the global function
+		FreeFn freeFn;
+		/// Size of each individual block allocation of the private heap in bytes
+		size_t allocBlockSize;
+		/// Size in bytes of each script's arena, zero to allocate script stacks from the heap, or the
+		/// maximum size_t value to use GlobalParams::scriptArenaSize
+		size_t scriptArenaSize;
+	};
+
+	/// Create a runtime object with its own parameters
+	/**
+	\param params A RuntimeParams struct containing parameters of this runtime
+	\sa IRuntime, RuntimeParams
+	*/
+	RuntimePtr CreateRuntime(const RuntimeParams & params);
+
+
 	/// Initializes global Jinx parameters
 	/**
 	\param params A GlobalParams struct containing a number of parameters that affect any
@@ -371,7 +647,10 @@ namespace Jinx
 			logBytecode(false),
 			allocBlockSize(8192),
 			maxInstructions(2000),
-			errorOnMaxInstrunctions(true)
+			errorOnMaxInstrunctions(true),
+			maxExecutionTimeNs(0),
+			schedulerThreads(0),
+			scriptArenaSize(0)
 		{}
 		/// Logging function 
 		LogFn logFn;
@@ -393,6 +672,15 @@ namespace Jinx
 		uint32_t maxInstructions;
 		/// Maximum total script instrunctions
 		bool errorOnMaxInstrunctions;
+		/// Maximum execution time of each IScript::Execute() call in nanoseconds, or zero for no time
+		/// limit.  Scripts reaching the limit yield, and continue executing in the next call.
+		uint64_t maxExecutionTimeNs;
+		/// Number of threads used by each runtime's scheduler, including the thread calling RunTick(), or
+		/// zero to use one thread per hardware thread
+		uint32_t schedulerThreads;
+		/// Size in bytes of each script's arena, holding the script's execution stacks and released all at
+		/// once when the script is destroyed, or zero to allocate them from the heap
+		size_t scriptArenaSize;
 	};
 
 	/// Initializes global Jinx parameters
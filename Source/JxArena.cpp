@@ -0,0 +1,80 @@
+/*
+The Jinx library is distributed under the MIT License (MIT)
+https://opensource.org/licenses/MIT
+See LICENSE.TXT or Jinx.h for license details.
+Copyright (c) 2016 James Boer
+*/
+
+#include "JxInternal.h"
+
+using namespace Jinx;
+
+
+Arena::Arena(size_t chunkSize) :
+	m_chunkSize(chunkSize),
+	m_capacity(0),
+	m_chunks(nullptr),
+	m_top(nullptr),
+	m_end(nullptr)
+{
+}
+
+Arena::~Arena()
+{
+	// Release all memory at once, regardless of what was freed
+	while (m_chunks)
+	{
+		Chunk * next = m_chunks->next;
+		JinxFree(m_chunks);
+		m_chunks = next;
+	}
+}
+
+void * Arena::Allocate(size_t bytes)
+{
+	if (!m_chunkSize)
+		return MemPoolAllocateSlab(bytes);
+	if (!bytes)
+		return nullptr;
+	bytes = NextHighestMultiple(bytes, std::alignment_of<max_align_t>::value);
+	if (bytes > static_cast<size_t>(m_end - m_top))
+		return AllocateChunk(bytes);
+	void * ptr = m_top;
+	m_top += bytes;
+	return ptr;
+}
+
+void * Arena::AllocateChunk(size_t bytes)
+{
+	// Each chunk is at least twice the size of the last, so growing arenas need few chunks
+	size_t chunkBytes = std::max(m_chunkSize, m_chunks ? m_chunks->bytes * 2 : 0);
+	chunkBytes = std::max(chunkBytes, bytes);
+	size_t headerBytes = NextHighestMultiple(sizeof(Chunk), std::alignment_of<max_align_t>::value);
+	Chunk * chunk = static_cast<Chunk *>(JinxAlloc(headerBytes + chunkBytes));
+	chunk->next = m_chunks;
+	chunk->bytes = chunkBytes;
+	m_chunks = chunk;
+	m_capacity += chunkBytes;
+
+	// Allocations continue from the new chunk, leaving the rest of the last chunk unused
+	uint8_t * data = reinterpret_cast<uint8_t *>(chunk) + headerBytes;
+	m_top = data + bytes;
+	m_end = data + chunkBytes;
+	return data;
+}
+
+void Arena::Free(void * ptr, size_t bytes)
+{
+	if (!m_chunkSize)
+	{
+		MemPoolFreeSlab(ptr, bytes);
+		return;
+	}
+	if (!ptr)
+		return;
+
+	// Only the most recent allocation can be returned to the arena
+	bytes = NextHighestMultiple(bytes, std::alignment_of<max_align_t>::value);
+	if (static_cast<uint8_t *>(ptr) + bytes == m_top)
+		m_top = static_cast<uint8_t *>(ptr);
+}
@@ -0,0 +1,91 @@
+/*
+The Jinx library is distributed under the MIT License (MIT)
+https://opensource.org/licenses/MIT
+See LICENSE.TXT or Jinx.h for license details.
+Copyright (c) 2016 James Boer
+*/
+
+#pragma once
+#ifndef JX_ARENA_H__
+#define JX_ARENA_H__
+
+
+namespace Jinx
+{
+
+	// Bump allocator for memory owned by a single object, all released at once when the arena is destroyed.
+	// Memory is allocated from chunks, each at least twice the size of the last.  Freeing the most recent
+	// allocation returns its memory to the arena, while other freed memory is kept until the arena is
+	// destroyed.  An arena with a chunk size of zero is disabled, and passes allocations to the heap.
+	// Arenas are not thread-safe.
+	class Arena
+	{
+	public:
+		explicit Arena(size_t chunkSize);
+		~Arena();
+
+		Arena(const Arena &) = delete;
+		Arena & operator = (const Arena &) = delete;
+
+		void * Allocate(size_t bytes);
+		void Free(void * ptr, size_t bytes);
+
+		// Total size of the arena's chunks
+		size_t GetCapacity() const { return m_capacity; }
+
+	private:
+
+		struct Chunk
+		{
+			Chunk * next;
+			size_t bytes;
+		};
+
+		void * AllocateChunk(size_t bytes);
+
+		size_t m_chunkSize;
+		size_t m_capacity;
+		Chunk * m_chunks;
+		uint8_t * m_top;
+		uint8_t * m_end;
+	};
+
+	// Allocator for STL containers owned by the same object as the arena
+	template <typename T>
+	class ArenaAllocator
+	{
+	public:
+		typedef size_t size_type;
+		typedef ptrdiff_t difference_type;
+		typedef T* pointer;
+		typedef const T* const_pointer;
+		typedef T& reference;
+		typedef const T& const_reference;
+		typedef T value_type;
+
+		explicit ArenaAllocator(Arena * arena) throw() : m_arena(arena) {}
+		ArenaAllocator(const ArenaAllocator & other) throw() : m_arena(other.m_arena) {}
+
+		template<typename U>
+		ArenaAllocator(const ArenaAllocator<U> & other) throw() : m_arena(other.GetArena()) {}
+
+		template <typename U>
+		struct rebind { typedef ArenaAllocator<U> other; };
+
+		pointer allocate(size_type n) { return static_cast<pointer>(m_arena->Allocate(n * sizeof(value_type))); }
+		void deallocate(pointer ptr, size_type n) { m_arena->Free(ptr, n * sizeof(value_type)); }
+
+		Arena * GetArena() const { return m_arena; }
+
+	private:
+		Arena * m_arena;
+	};
+
+	template <typename T, typename U>
+	bool operator == (const ArenaAllocator<T> & a, const ArenaAllocator<U> & b) { return a.GetArena() == b.GetArena(); }
+	template <typename T, typename U>
+	bool operator != (const ArenaAllocator<T> & a, const ArenaAllocator<U> & b) { return a.GetArena() != b.GetArena(); }
+
+};
+
+#endif // JX_ARENA_H__
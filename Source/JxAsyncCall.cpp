@@ -0,0 +1,31 @@
+/*
+The Jinx library is distributed under the MIT License (MIT)
+https://opensource.org/licenses/MIT
+See LICENSE.TXT or Jinx.h for license details.
+Copyright (c) 2016 James Boer
+*/
+
+#include "JxInternal.h"
+
+using namespace Jinx;
+
+
+AsyncCall::AsyncCall(const std::weak_ptr<Script> & script, uint32_t waitGeneration) :
+	m_script(script),
+	m_waitGeneration(waitGeneration),
+	m_completing(false),
+	m_complete(false)
+{
+}
+
+void AsyncCall::Complete(const Variant & result)
+{
+	// Only the first completion sets the result
+	if (m_completing.exchange(true, std::memory_order_acq_rel))
+		return;
+	m_result = result;
+	m_complete.store(true, std::memory_order_release);
+	auto script = m_script.lock();
+	if (script)
+		script->Wake(m_waitGeneration);
+}
@@ -0,0 +1,45 @@
+/*
+The Jinx library is distributed under the MIT License (MIT)
+https://opensource.org/licenses/MIT
+See LICENSE.TXT or Jinx.h for license details.
+Copyright (c) 2016 James Boer
+*/
+
+#pragma once
+#ifndef JX_ASYNC_CALL_H__
+#define JX_ASYNC_CALL_H__
+
+
+namespace Jinx
+{
+
+	class Script;
+
+	// Completion token for an asynchronous native function call, waking the calling script when completed.
+	// The result is written before the call is marked complete, so the script can read it once it sees
+	// the call is complete.
+	class AsyncCall : public IAsyncCall
+	{
+	public:
+		AsyncCall(const std::weak_ptr<Script> & script, uint32_t waitGeneration);
+
+		// IAsyncCall interface
+		void Complete(const Variant & result) override;
+
+		// Internal interface
+		bool IsComplete() const { return m_complete.load(std::memory_order_acquire); }
+		const Variant & GetResult() const { return m_result; }
+
+	private:
+		std::weak_ptr<Script> m_script;
+		uint32_t m_waitGeneration;
+		std::atomic<bool> m_completing;
+		std::atomic<bool> m_complete;
+		Variant m_result;
+	};
+
+	typedef std::shared_ptr<AsyncCall> AsyncCallIPtr;
+
+};
+
+#endif // JX_ASYNC_CALL_H__
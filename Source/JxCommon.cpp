@@ -72,8 +72,10 @@ static const char * s_opcodeName[] =
 	"setvar",
 	"setvarkey",
 	"subtract",
+	"tailcall",
 	"type",
 	"wait",
+	"waittime",
 };
 
 static_assert(countof(s_opcodeName) == static_cast<size_t>(Opcode::NumOpcodes), "Opcode descriptions don't match enum count");
@@ -237,6 +239,21 @@ bool Jinx::ErrorOnMaxInstrunction()
 	return s_globalParams.errorOnMaxInstrunctions;
 }
 
+uint64_t Jinx::MaxExecutionTimeNs()
+{
+	return s_globalParams.maxExecutionTimeNs;
+}
+
+uint32_t Jinx::SchedulerThreads()
+{
+	return s_globalParams.schedulerThreads;
+}
+
+size_t Jinx::ScriptArenaSize()
+{
+	return s_globalParams.scriptArenaSize;
+}
+
 void Jinx::Initialize(const GlobalParams & params)
 {
 	s_globalParams = params;
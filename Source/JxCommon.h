@@ -71,8 +71,10 @@ namespace Jinx
 		SetVar,
 		SetVarKey,
 		Subtract,
+		TailCall,
 		Type,
 		Wait,
+		WaitTime,
 		NumOpcodes,
 	};
 
@@ -176,21 +178,23 @@ namespace Jinx
 
 	const uint32_t BytecodeSignature = MakeFourCC('J', 'I', 'N', 'X');
 	const uint16_t BytecodeMajorVersion = 0;
-	const uint16_t BytecodeMinorVersion = 1;
+	const uint16_t BytecodeMinorVersion = 6;
 
 	struct BytecodeHeader
 	{
 		BytecodeHeader() :
 			signature(BytecodeSignature),
 			majorVer(BytecodeMajorVersion),
-			minorVer(BytecodeMinorVersion)
+			minorVer(BytecodeMinorVersion),
+			tableOffset(0)
 		{}
 		uint32_t signature;
 		uint16_t majorVer;
 		uint16_t minorVer;
+		uint32_t tableOffset;	// Offset of the constant and name tables following the executable bytecode
 	};
 
-	static_assert(sizeof(BytecodeHeader) == 8, "BytecodeHeader struct is not properly aligned on this platform");
+	static_assert(sizeof(BytecodeHeader) == 12, "BytecodeHeader struct is not properly aligned on this platform");
 
 	template <typename T>
 	inline T NextHighestMultiple(T val, T multiple)
@@ -221,6 +225,12 @@ namespace Jinx
 	RuntimeID GetRandomId();
 	uint32_t MaxInstructions();
 	bool ErrorOnMaxInstrunction();
+	uint64_t MaxExecutionTimeNs();
+	uint32_t SchedulerThreads();
+	size_t ScriptArenaSize();
+
+	// Monotonic clock used for execution time limits
+	typedef std::chrono::steady_clock::time_point TimePoint;
 
 	// Forward declarations
 	class Runtime;
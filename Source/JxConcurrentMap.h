@@ -0,0 +1,203 @@
+/*
+The Jinx library is distributed under the MIT License (MIT)
+https://opensource.org/licenses/MIT
+See LICENSE.TXT or Jinx.h for license details.
+Copyright (c) 2016 James Boer
+*/
+
+#pragma once
+#ifndef JX_CONCURRENT_MAP_H__
+#define JX_CONCURRENT_MAP_H__
+
+
+namespace Jinx
+{
+
+	// Open addressing hash map for read-mostly data, allowing lookups without locking while other
+	// threads insert.  Insertions are serialized with a mutex, and publish fully constructed entries
+	// with atomic stores.  Entries are never removed, and tables replaced when the map grows are kept
+	// until the map is destroyed, so readers never access freed memory.  Since the table doubles in
+	// size when growing, retained tables never use more memory than the current one.
+	template<typename K, typename V>
+	class ConcurrentMap
+	{
+	public:
+		ConcurrentMap();
+		~ConcurrentMap();
+
+		ConcurrentMap(const ConcurrentMap &) = delete;
+		ConcurrentMap & operator = (const ConcurrentMap &) = delete;
+
+		// Find a value by key - returns nullptr if not found
+		V * Find(const K & key) const;
+
+		// Insert a value constructed from the arguments, returning the value and whether it was inserted.
+		// If the key already exists, the existing value is returned instead.
+		template<typename... Args>
+		std::pair<V *, bool> Insert(const K & key, Args &&... args);
+
+		// Visit each key and value.  Must not be called concurrently with insertions.
+		template<typename F>
+		void ForEach(F function);
+
+	private:
+
+		static const size_t InitialCapacity = 16;
+
+		struct Entry
+		{
+			template<typename... Args>
+			Entry(const K & k, uint64_t h, Args &&... args) : key(k), hash(h), value(std::forward<Args>(args)...) {}
+			const K key;
+			const uint64_t hash;
+			V value;
+		};
+
+		struct Table
+		{
+			size_t mask;
+			std::atomic<Entry *> * entries;
+			Table * previous;
+		};
+
+		static uint64_t HashKey(uint64_t key);
+		static uint64_t HashKey(const String & key);
+
+		static Table * CreateTable(size_t capacity, Table * previous);
+		static size_t FindIndex(const Table * table, uint64_t hash, const K & key);
+
+		Mutex m_mutex;
+		std::atomic<Table *> m_table;
+		size_t m_count;
+	};
+
+	template<typename K, typename V>
+	inline ConcurrentMap<K, V>::ConcurrentMap() :
+		m_table(nullptr),
+		m_count(0)
+	{
+		m_table.store(CreateTable(InitialCapacity, nullptr), std::memory_order_relaxed);
+	}
+
+	template<typename K, typename V>
+	inline ConcurrentMap<K, V>::~ConcurrentMap()
+	{
+		Table * table = m_table.load(std::memory_order_relaxed);
+		for (size_t i = 0; i <= table->mask; ++i)
+			JinxDelete(table->entries[i].load(std::memory_order_relaxed));
+		while (table)
+		{
+			Table * previous = table->previous;
+			JinxFree(table->entries);
+			JinxFree(table);
+			table = previous;
+		}
+	}
+
+	template<typename K, typename V>
+	inline V * ConcurrentMap<K, V>::Find(const K & key) const
+	{
+		uint64_t hash = HashKey(key);
+		const Table * table = m_table.load(std::memory_order_acquire);
+		for (size_t index = static_cast<size_t>(hash) & table->mask;; index = (index + 1) & table->mask)
+		{
+			Entry * entry = table->entries[index].load(std::memory_order_acquire);
+			if (!entry)
+				return nullptr;
+			if (entry->hash == hash && entry->key == key)
+				return &entry->value;
+		}
+	}
+
+	template<typename K, typename V>
+	template<typename... Args>
+	inline std::pair<V *, bool> ConcurrentMap<K, V>::Insert(const K & key, Args &&... args)
+	{
+		std::lock_guard<Mutex> lock(m_mutex);
+		uint64_t hash = HashKey(key);
+		Table * table = m_table.load(std::memory_order_relaxed);
+		size_t index = FindIndex(table, hash, key);
+		Entry * entry = table->entries[index].load(std::memory_order_relaxed);
+		if (entry)
+			return std::make_pair(&entry->value, false);
+
+		// Keep the table at most half full, so probe sequences stay short and always end at an empty slot
+		if ((m_count + 1) * 2 > table->mask + 1)
+		{
+			Table * newTable = CreateTable((table->mask + 1) * 2, table);
+			for (size_t i = 0; i <= table->mask; ++i)
+			{
+				Entry * e = table->entries[i].load(std::memory_order_relaxed);
+				if (e)
+					newTable->entries[FindIndex(newTable, e->hash, e->key)].store(e, std::memory_order_relaxed);
+			}
+			m_table.store(newTable, std::memory_order_release);
+			table = newTable;
+			index = FindIndex(table, hash, key);
+		}
+
+		entry = JinxNew(Entry, key, hash, std::forward<Args>(args)...);
+		table->entries[index].store(entry, std::memory_order_release);
+		++m_count;
+		return std::make_pair(&entry->value, true);
+	}
+
+	template<typename K, typename V>
+	template<typename F>
+	inline void ConcurrentMap<K, V>::ForEach(F function)
+	{
+		Table * table = m_table.load(std::memory_order_acquire);
+		for (size_t i = 0; i <= table->mask; ++i)
+		{
+			Entry * entry = table->entries[i].load(std::memory_order_acquire);
+			if (entry)
+				function(entry->key, entry->value);
+		}
+	}
+
+	template<typename K, typename V>
+	inline uint64_t ConcurrentMap<K, V>::HashKey(uint64_t key)
+	{
+		// Mix the bits of integer keys, since the table index uses only the low bits
+		key ^= key >> 33;
+		key *= 0xff51afd7ed558ccdull;
+		key ^= key >> 33;
+		return key;
+	}
+
+	template<typename K, typename V>
+	inline uint64_t ConcurrentMap<K, V>::HashKey(const String & key)
+	{
+		return GetHash(reinterpret_cast<const uint8_t *>(key.c_str()), static_cast<uint32_t>(key.size()));
+	}
+
+	template<typename K, typename V>
+	inline typename ConcurrentMap<K, V>::Table * ConcurrentMap<K, V>::CreateTable(size_t capacity, Table * previous)
+	{
+		Table * table = static_cast<Table *>(JinxAlloc(sizeof(Table)));
+		table->mask = capacity - 1;
+		table->entries = static_cast<std::atomic<Entry *> *>(JinxAlloc(capacity * sizeof(std::atomic<Entry *>)));
+		for (size_t i = 0; i < capacity; ++i)
+			new(&table->entries[i]) std::atomic<Entry *>(nullptr);
+		table->previous = previous;
+		return table;
+	}
+
+	template<typename K, typename V>
+	inline size_t ConcurrentMap<K, V>::FindIndex(const Table * table, uint64_t hash, const K & key)
+	{
+		// Returns the index of the matching entry, or of the empty slot ending the probe sequence.  Only
+		// called while holding the insertion lock, so the slot can't be filled before it's used.
+		size_t index = static_cast<size_t>(hash) & table->mask;
+		while (true)
+		{
+			Entry * entry = table->entries[index].load(std::memory_order_relaxed);
+			if (!entry || (entry->hash == hash && entry->key == key))
+				return index;
+			index = (index + 1) & table->mask;
+		}
+	}
+
+};
+
+#endif // JX_CONCURRENT_MAP_H__
@@ -16,12 +16,12 @@ namespace Jinx
 	class FunctionDefinition
 	{
 	public:
-		FunctionDefinition(const FunctionSignature & signature, BufferPtr bytecode, size_t offset) :
+		FunctionDefinition(const FunctionSignature & signature, ProgramPtr program, size_t entry) :
 			m_id(signature.GetId()),
 			m_parameterCount(signature.GetParameterCount()),
 			m_returnParameter(signature.HasReturnParameter()),
-			m_bytecode(bytecode),
-			m_offset(offset)
+			m_program(program),
+			m_entry(entry)
 		{}
 		FunctionDefinition(const FunctionSignature & signature, FunctionCallback callback) :
 			m_id(signature.GetId()),
@@ -29,21 +29,29 @@ namespace Jinx
 			m_returnParameter(signature.HasReturnParameter()),
 			m_callback(callback)
 		{}
+		FunctionDefinition(const FunctionSignature & signature, AsyncFunctionCallback asyncCallback) :
+			m_id(signature.GetId()),
+			m_parameterCount(signature.GetParameterCount()),
+			m_returnParameter(signature.HasReturnParameter()),
+			m_asyncCallback(asyncCallback)
+		{}
 		size_t GetParameterCount() const { return m_parameterCount; }
 		bool HasReturnParameter() const { return m_returnParameter; }
 		RuntimeID GetId() const { return m_id; }
-		const BufferPtr & GetBytecode() const { return m_bytecode; }
-		size_t GetOffset() const { return m_offset; }
+		const ProgramPtr & GetProgram() const { return m_program; }
+		size_t GetEntry() const { return m_entry; }
 		FunctionCallback GetCallback() const { return m_callback; }
+		const AsyncFunctionCallback & GetAsyncCallback() const { return m_asyncCallback; }
 		friend class FunctionTable;
 
 	private:
 		RuntimeID m_id;
 		size_t m_parameterCount;
 		bool m_returnParameter;
-		BufferPtr m_bytecode;
-		size_t m_offset;
+		ProgramPtr m_program;
+		size_t m_entry;
 		FunctionCallback m_callback;
+		AsyncFunctionCallback m_asyncCallback;
 	};
 	
 	typedef std::shared_ptr<FunctionDefinition> FunctionDefinitionPtr;
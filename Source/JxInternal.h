@@ -26,8 +26,11 @@ Copyright (c) 2016 James Boer
 #include <string.h>
 #include <cstddef>
 #include <atomic>
+#include <thread>
+#include <chrono>
 #include <locale>
 #include <codecvt>
+#include <cmath>
 
 #include "Jinx.h"
 #include "JxLogging.h"
@@ -39,15 +42,23 @@ Copyright (c) 2016 James Boer
 #include "JxSerialize.h"
 #include "JxPropertyName.h"
 #include "JxMutex.h"
+#include "JxArena.h"
 #include "JxLexer.h"
 #include "JxHash.h"
+#include "JxConcurrentMap.h"
+#include "JxPropertySlot.h"
 #include "JxFunctionSignature.h"
+#include "JxProgram.h"
 #include "JxFunctionDefinition.h"
 #include "JxFunctionTable.h"
 #include "JxLibrary.h"
 #include "JxVariableStackFrame.h"
 #include "JxParser.h"
+#include "JxAsyncCall.h"
 #include "JxScript.h"
+#include "JxScheduler.h"
+#include "JxTimerWheel.h"
+#include "JxPerformanceCounters.h"
 #include "JxRuntime.h"
 #include "JxLibCore.h"
 
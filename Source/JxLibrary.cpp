@@ -13,7 +13,8 @@ using namespace Jinx;
 Library::Library(RuntimeWPtr runtime, const String & name) :
 	m_name(name),
 	m_maxPropertyParts(0),
-	m_runtime(runtime)
+	m_runtime(runtime),
+	m_heap(runtime.lock()->GetHeap())
 {
 }
 
@@ -143,6 +144,7 @@ PropertyName Library::GetPropertyName(const String & name)
 
 Variant Library::GetProperty(const String & name) const
 {
+	HeapScope scope(m_heap);
 	std::lock_guard<Mutex> lock(m_propertyMutex);
 	auto itr = m_propertyNameTable.find(name);
 	if (itr == m_propertyNameTable.end())
@@ -153,14 +155,46 @@ Variant Library::GetProperty(const String & name) const
 	return runtime->GetProperty(itr->second.GetId());
 }
 
+Variant Library::GetProperty(PropertyHandle handle) const
+{
+	if (!handle.m_slot)
+		return Variant();
+	HeapScope scope(m_heap);
+	return handle.m_slot->Get();
+}
+
+PropertyHandle Library::GetPropertyHandle(const String & name) const
+{
+	std::lock_guard<Mutex> lock(m_propertyMutex);
+	auto itr = m_propertyNameTable.find(name);
+	if (itr == m_propertyNameTable.end())
+		return PropertyHandle();
+	auto runtime = m_runtime.lock();
+	if (!runtime)
+		return PropertyHandle();
+	return PropertyHandle(runtime->FindProperty(itr->second.GetId()));
+}
+
 bool Library::PropertyNameExists(const String & name) const
 {
 	std::lock_guard<Mutex> lock(m_propertyMutex);
 	return m_propertyNameTable.find(name) == m_propertyNameTable.end() ? false : true;
 }
 
+bool Library::RegisterAsyncFunction(Visibility visibility, ReturnValue returnValue, std::initializer_list<String> name, AsyncFunctionCallback function)
+{
+	return RegisterNativeFunction(visibility, returnValue, name, function);
+}
+
 bool Library::RegisterFunction(Visibility visibility, ReturnValue returnValue, std::initializer_list<String> name, FunctionCallback function)
 {
+	return RegisterNativeFunction(visibility, returnValue, name, function);
+}
+
+template<typename T>
+bool Library::RegisterNativeFunction(Visibility visibility, ReturnValue returnValue, std::initializer_list<String> name, const T & function)
+{
+	HeapScope scope(m_heap);
 	if (name.size() < 1)
 	{
 		LogWriteLine("Registered function requires a valid name");
@@ -194,6 +228,7 @@ bool Library::RegisterFunction(Visibility visibility, ReturnValue returnValue, s
 
 bool Library::RegisterProperty(Visibility visibility, Access access, const String & name, const Variant & value)
 {
+	HeapScope scope(m_heap);
 	std::lock_guard<Mutex> lock(m_propertyMutex);
 
 	// Register the property name with the library
@@ -227,8 +262,19 @@ bool Library::RegisterPropertyNameInternal(const PropertyName & propertyName, bo
 	return true;
 }
 
+void Library::SetProperties(const std::pair<PropertyHandle, Variant> * properties, size_t count)
+{
+	HeapScope scope(m_heap);
+	for (size_t i = 0; i < count; ++i)
+	{
+		if (properties[i].first.m_slot)
+			properties[i].first.m_slot->Set(properties[i].second);
+	}
+}
+
 void Library::SetProperty(const String & name, const Variant & value)
 {
+	HeapScope scope(m_heap);
 	std::lock_guard<Mutex> lock(m_propertyMutex);
 	auto itr = m_propertyNameTable.find(name);
 	if (itr == m_propertyNameTable.end())
@@ -239,3 +285,11 @@ void Library::SetProperty(const String & name, const Variant & value)
 	runtime->SetProperty(itr->second.GetId(), value);
 }
 
+void Library::SetProperty(PropertyHandle handle, const Variant & value)
+{
+	if (!handle.m_slot)
+		return;
+	HeapScope scope(m_heap);
+	handle.m_slot->Set(value);
+}
+
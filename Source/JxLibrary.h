@@ -20,9 +20,14 @@ namespace Jinx
 
 		// ILibrary interface
 		bool RegisterFunction(Visibility visibility, ReturnValue returnValue, std::initializer_list<String> name, FunctionCallback function) override;
+		bool RegisterAsyncFunction(Visibility visibility, ReturnValue returnValue, std::initializer_list<String> name, AsyncFunctionCallback function) override;
 		bool RegisterProperty(Visibility visibility, Access access, const String & name, const Variant & value) override;
 		Variant GetProperty(const String & name) const override;
 		void SetProperty(const String & name, const Variant & value) override;
+		PropertyHandle GetPropertyHandle(const String & name) const override;
+		Variant GetProperty(PropertyHandle handle) const override;
+		void SetProperty(PropertyHandle handle, const Variant & value) override;
+		void SetProperties(const std::pair<PropertyHandle, Variant> * properties, size_t count) override;
 
 		// Internal functions
 		FunctionTable & Functions() { return m_functionTable; }
@@ -37,6 +42,8 @@ namespace Jinx
 		
 		// Private internal functions
 		FunctionSignature CreateFunctionSignature(bool publicScope, bool returnValue, std::initializer_list<String> name) const;
+		template<typename T>
+		bool RegisterNativeFunction(Visibility visibility, ReturnValue returnValue, std::initializer_list<String> name, const T & function);
 		bool RegisterPropertyNameInternal(const PropertyName & propertyName, bool checkForDuplicates);
 
 		typedef std::map <String, PropertyName, std::less<String>, Allocator<std::pair<String, PropertyName>>> PropertyNameTable;
@@ -54,6 +61,9 @@ namespace Jinx
 
 		// Weak ptr to runtime system
 		RuntimeWPtr m_runtime;
+
+		// Heap of the runtime, allocated from when called by the client
+		BlockHeap * m_heap;
 	};
 
 	typedef std::shared_ptr<Library> LibraryIPtr;
@@ -25,6 +25,22 @@ using namespace std;
 // check if anything is using new/delete under the hood.
 //#define JINX_OVERRIDE_NEW_AND_DELETE
 
+// An application can disable the per-thread allocation caches using this define, so
+// every allocation locks the pool allocator.
+//#define JINX_DISABLE_THREAD_CACHE
+
+// Thread caches are also disabled in debug allocation mode, which tracks every allocation
+// in its block's list of allocations.
+#if !defined(JINX_DEBUG_ALLOCATION) && !defined(JINX_DISABLE_THREAD_CACHE)
+#define JINX_USE_THREAD_CACHE
+#endif
+
+// Small allocations made through Allocator are made from slab pages without headers, except
+// in debug allocation mode, which tracks every allocation through its header.
+#if !defined(JINX_DEBUG_ALLOCATION) && !defined(JINX_DISABLE_POOL_ALLOCATOR) && !defined(JINX_DEBUG_USE_STD_ALLOC)
+#define JINX_USE_SLAB_ALLOCATOR
+#endif
+
 // Whenever we are using debug allocation mode, also use memory guards.  However,
 // we can also enable it independently if desired.  The memory guards put a protective
 // band around each allocation in an attempt to detect memory overwrites.
@@ -87,6 +103,35 @@ namespace Jinx
 
 	struct MemoryHeader;
 
+	// Freed allocations up to this size, including the header, are kept in free lists by size class
+	// for reuse.  Each size class is a multiple of the allocation alignment.
+	static const size_t SIZE_CLASS_MAX_BYTES = 1024;
+	static const size_t SIZE_CLASS_COUNT = SIZE_CLASS_MAX_BYTES / std::alignment_of<max_align_t>::value;
+	// Allocations have room to link them into a free list when freed
+	static const size_t MIN_ALLOC_BYTES = sizeof(void *) * 2;
+	// Set in the size of allocations in the heap's free lists
+	static const size_t FREE_ALLOC_FLAG = 1;
+
+#ifdef JINX_USE_THREAD_CACHE
+	// Allocations up to this size, including the header, are made from thread caches
+	static const size_t THREAD_CACHE_MAX_BYTES = SIZE_CLASS_MAX_BYTES;
+	// Freed allocations up to this size are kept in thread cache free lists for reuse
+	static const size_t FREE_LIST_MAX_BYTES = 256;
+	static const size_t FREE_LIST_COUNT = FREE_LIST_MAX_BYTES / std::alignment_of<max_align_t>::value;
+	// Maximum number of allocations kept in each free list, and taken from the heap's free lists at once
+	static const uint32_t FREE_LIST_MAX_LENGTH = 32;
+	static const uint32_t FREE_LIST_REFILL_LENGTH = 16;
+#endif
+
+#ifdef JINX_USE_SLAB_ALLOCATOR
+	// Allocations up to this size made through Allocator are made from slab pages by size class
+	static const size_t SLAB_MAX_BYTES = 256;
+	static const size_t SLAB_CLASS_COUNT = SLAB_MAX_BYTES / std::alignment_of<max_align_t>::value;
+	// Slab pages are aligned to their size, and allocated together in spans
+	static const size_t SLAB_PAGE_SIZE = 1024 * 8;
+	static const uint32_t SLAB_SPAN_PAGES = 16;
+	static const uint32_t SLAB_SPAN_FULL = (1u << SLAB_SPAN_PAGES) - 1;
+#endif
 
 
 	// This structure is placed at the beginning of each large system allocated block
@@ -106,6 +151,13 @@ namespace Jinx
 		size_t count;
 		MemoryBlock * prev;
 		MemoryBlock * next;
+		// The heap the block was allocated by, which allocations in the block are freed to
+		BlockHeap * heap;
+#ifdef JINX_USE_THREAD_CACHE
+		// The thread cache allocating from this block, and whether it still is
+		void * cache;
+		bool active;
+#endif
 #ifdef JINX_DEBUG_ALLOCATION
 		MemoryHeader * head;
 		MemoryHeader * tail;
@@ -141,6 +193,152 @@ namespace Jinx
 	// Make sure our MemoryHeader struct is properly padded
 	static_assert((sizeof(MemoryHeader) % std::alignment_of<max_align_t>::value) == 0, "MemoryHeader must be padded to proper allocation alignment");
 
+	// Links of a freed allocation in the heap's free lists, stored after its header
+	struct FreeLinks
+	{
+		MemoryHeader * prev;
+		MemoryHeader * next;
+	};
+
+	inline FreeLinks * GetFreeLinks(MemoryHeader * header)
+	{
+		return reinterpret_cast<FreeLinks *>(reinterpret_cast<char *>(header) + sizeof(MemoryHeader));
+	}
+
+	inline size_t SizeClass(size_t bytes)
+	{
+		return bytes / std::alignment_of<max_align_t>::value - 1;
+	}
+
+#ifdef JINX_USE_SLAB_ALLOCATOR
+
+	// Slab pages hold allocations of a single size class without headers.  Pages are aligned to their
+	// size, so an allocation's page is found by masking its address, and allocations are freed with the
+	// size they were made with to find their size class.  Each thread allocates from and frees to its
+	// own pages without locking.  Allocations freed by other threads are pushed onto the page's remote
+	// free list, and collected by the owning thread when it runs out of free allocations.  The pages of
+	// exited threads are shared, and allocated from and freed to with the heap locked.
+	struct SlabObject
+	{
+		SlabObject * next;
+	};
+
+	struct SlabSpan;
+
+	struct SlabPage
+	{
+		SlabSpan * span;
+		SlabPage * prev;
+		SlabPage * next;
+		// The thread cache owning the page, or null if shared
+		std::atomic<void *> owner;
+		SlabObject * freeList;
+		std::atomic<SlabObject *> remoteFrees;
+		uint8_t * data;
+		uint32_t sizeClass;
+		uint32_t objectBytes;
+		uint32_t capacity;
+		// Written only by the page's owner, or with the heap locked if shared, and read for stats
+		std::atomic<uint32_t> carved;
+		std::atomic<uint32_t> used;
+	};
+
+	// A span of pages allocated together, placed in the memory left over from aligning its pages
+	struct SlabSpan
+	{
+		void * memory;
+		uint8_t * pages;
+		uint32_t usedPages;
+		BlockHeap * heap;
+		SlabSpan * prev;
+		SlabSpan * next;
+	};
+
+	inline SlabPage * GetSlabPage(void * ptr)
+	{
+		return reinterpret_cast<SlabPage *>(reinterpret_cast<uintptr_t>(ptr) & ~static_cast<uintptr_t>(SLAB_PAGE_SIZE - 1));
+	}
+
+	inline size_t SlabClass(size_t bytes)
+	{
+		return (bytes - 1) / std::alignment_of<max_align_t>::value;
+	}
+
+	inline size_t SlabObjectBytes(size_t sizeClass)
+	{
+		return (sizeClass + 1) * std::alignment_of<max_align_t>::value;
+	}
+
+	inline void LinkSlabPage(SlabPage * page, SlabPage *& pages)
+	{
+		page->prev = nullptr;
+		page->next = pages;
+		if (pages)
+			pages->prev = page;
+		pages = page;
+	}
+
+	inline void UnlinkSlabPage(SlabPage * page, SlabPage *& pages)
+	{
+		if (page->prev)
+			page->prev->next = page->next;
+		else
+			pages = page->next;
+		if (page->next)
+			page->next->prev = page->prev;
+		page->prev = nullptr;
+		page->next = nullptr;
+	}
+
+#endif // JINX_USE_SLAB_ALLOCATOR
+
+#ifdef JINX_USE_THREAD_CACHE
+
+	// Each thread allocates small allocations by bumping through its own block, and keeps small
+	// allocations it frees in free lists by size for reuse, so most allocations and frees don't lock
+	// the heap.  The heap is only locked to refill the cache with a new block, to free allocations
+	// made by other threads or too large to cache, and to collect the cache's stats.  Allocations
+	// made from the current block are added to the block's count when it's retired, and cached
+	// allocations are still counted by their blocks until they're returned to the heap.
+	struct ThreadCache
+	{
+		ThreadCache();
+		~ThreadCache();
+
+		MemoryBlock * block;
+		std::atomic<size_t> blockBytes;
+		size_t blockCount;
+		MemoryHeader * freeLists[FREE_LIST_COUNT];
+		uint32_t freeListLengths[FREE_LIST_COUNT];
+
+		// Stats written only by this thread, with a relaxed load and store, and summed by the heap
+		std::atomic<uint64_t> allocCount;
+		std::atomic<uint64_t> freeCount;
+		std::atomic<uint64_t> usedMemory;
+		std::atomic<uint64_t> cachedMemory;
+
+#ifdef JINX_USE_SLAB_ALLOCATOR
+		// Slab pages owned by this thread by size class, with the page allocated from first
+		SlabPage * slabPages[SLAB_CLASS_COUNT];
+#endif
+
+		ThreadCache * prev;
+		ThreadCache * next;
+	};
+
+	inline void AddToCounter(std::atomic<uint64_t> & counter, uint64_t value)
+	{
+		counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+	}
+
+	// Thread cache free lists are linked through the memory following each allocation's header
+	inline MemoryHeader *& NextFree(MemoryHeader * header)
+	{
+		return GetFreeLinks(header)->next;
+	}
+
+#endif // JINX_USE_THREAD_CACHE
+
 	class BlockHeap
 	{
 	public:
@@ -148,6 +346,7 @@ namespace Jinx
 		~BlockHeap();
 
 		void Initialize(const GlobalParams & params);
+		void Initialize(const RuntimeParams & params, const BlockHeap & defaults);
 
 		void * Alloc(size_t bytes);
 		void * Realloc(void * ptr, size_t bytes);
@@ -155,17 +354,66 @@ namespace Jinx
 		void Free(MemoryHeader * header);
 		MemoryStats GetMemoryStats();
 		void LogAllocations();
+		void Release();
 		void ShutDown();
 
+#ifdef JINX_USE_SLAB_ALLOCATOR
+		void * AllocSlab(size_t bytes);
+		void FreeSlab(void * ptr, size_t bytes);
+#endif
+
+#ifdef JINX_USE_THREAD_CACHE
+		void AddThreadCache(ThreadCache * cache);
+		void RemoveThreadCache(ThreadCache * cache);
+#endif
+
 	private:
+		static void Destroy(BlockHeap * heap);
+		bool IsDestroyable() const;
 		MemoryBlock * AllocBlock(size_t bytes);
 		void FreeInternal(MemoryHeader * header);
 		void FreeBlock(MemoryBlock * block);
+		MemoryHeader * PopFreeAlloc(size_t sizeClass);
+		void PushFreeAlloc(MemoryHeader * header);
+		void RemoveFreeAlloc(MemoryHeader * header);
+#ifdef JINX_USE_SLAB_ALLOCATOR
+		void * AllocFromSlabPages(SlabPage *& pages);
+		SlabPage * AllocSlabPage(size_t sizeClass, void * owner);
+		SlabSpan * AllocSlabSpan();
+		void CollectRemoteFrees(SlabPage * page);
+		void ReleaseSlabPage(SlabPage * page);
+#endif
+#ifdef JINX_USE_THREAD_CACHE
+		void * AllocCached(ThreadCache * cache, size_t bytes);
+		bool FreeCached(ThreadCache * cache, MemoryHeader * header);
+		void FlushThreadCache(ThreadCache * cache);
+		void RefillThreadCache(ThreadCache * cache);
+		void RetireThreadCacheBlock(ThreadCache * cache);
+		MemoryHeader * TakeFreeAllocs(ThreadCache * cache, size_t sizeClass);
+#endif
+#if defined(JINX_USE_THREAD_CACHE) && defined(JINX_USE_SLAB_ALLOCATOR)
+		void FlushSlabPages(ThreadCache * cache);
+#endif
 
 	private:
 		Mutex m_mutex;
 		MemoryBlock * m_head;
 		MemoryBlock * m_tail;
+		// Freed allocations by size class, and their lengths, read without locking as a hint by thread caches
+		MemoryHeader * m_freeLists[SIZE_CLASS_COUNT];
+		std::atomic<uint32_t> m_freeListLengths[SIZE_CLASS_COUNT];
+		uint64_t m_freeListBytes;
+#ifdef JINX_USE_SLAB_ALLOCATOR
+		// Shared slab pages by size class, and all spans of slab pages
+		SlabPage * m_slabPages[SLAB_CLASS_COUNT];
+		SlabSpan * m_slabSpans;
+#endif
+#ifdef JINX_USE_THREAD_CACHE
+		ThreadCache * m_caches;
+#endif
+		// Heaps owned by runtimes don't use thread caches, and are destroyed once released and unused
+		bool m_private;
+		bool m_released;
 		size_t m_allocBlockSize;
 		AllocFn m_allocFn = [](size_t size) { return malloc(size); };
 		ReallocFn m_reallocFn = [](void * p, size_t size) { return realloc(p, size); };
@@ -222,10 +470,42 @@ namespace Jinx
 
 	static BlockHeap	s_heap;
 
+#ifdef JINX_USE_THREAD_CACHE
+
+	// Set when the thread's cache is destroyed, so allocations freed later in the thread's exit lock the heap
+	static thread_local bool s_threadCacheDestroyed = false;
+	static thread_local ThreadCache s_threadCache;
+
+	inline ThreadCache * GetThreadCache()
+	{
+		return s_threadCacheDestroyed ? nullptr : &s_threadCache;
+	}
+
+#endif // JINX_USE_THREAD_CACHE
+
 #else // JINX_DISABLE_POOL_ALLOCATOR
 
 	static DefaultHeap s_heap;
 
+#endif // JINX_DISABLE_POOL_ALLOCATOR
+
+	static thread_local uint64_t s_threadAllocCount = 0;
+
+	// Heap the calling thread allocates from, or null for the global heap
+	static thread_local BlockHeap * s_currentHeap = nullptr;
+
+#ifndef JINX_DISABLE_POOL_ALLOCATOR
+
+	inline BlockHeap * CurrentHeap()
+	{
+		return s_currentHeap ? s_currentHeap : &s_heap;
+	}
+
+	inline BlockHeap * OwningHeap(void * ptr)
+	{
+		return reinterpret_cast<MemoryHeader *>(static_cast<char *>(ptr) - sizeof(MemoryHeader))->memBlock->heap;
+	}
+
 #endif // JINX_DISABLE_POOL_ALLOCATOR
 
 } // namespace Jinx
@@ -238,10 +518,28 @@ using namespace Jinx;
 BlockHeap::BlockHeap() :
 	m_head(nullptr),
 	m_tail(nullptr),
+	m_freeListBytes(0),
+#ifdef JINX_USE_SLAB_ALLOCATOR
+	m_slabSpans(nullptr),
+#endif
+#ifdef JINX_USE_THREAD_CACHE
+	m_caches(nullptr),
+#endif
+	m_private(false),
+	m_released(false),
 	m_allocBlockSize((1024 * 8) - sizeof(MemoryBlock))
 {
 	m_allocFn = [](size_t size) { return malloc(size); };
 	m_freeFn = [](void * p) { return free(p); };
+	for (size_t i = 0; i < SIZE_CLASS_COUNT; ++i)
+	{
+		m_freeLists[i] = nullptr;
+		m_freeListLengths[i] = 0;
+	}
+#ifdef JINX_USE_SLAB_ALLOCATOR
+	for (size_t i = 0; i < SLAB_CLASS_COUNT; ++i)
+		m_slabPages[i] = nullptr;
+#endif
 }
 
 BlockHeap::~BlockHeap()
@@ -250,46 +548,88 @@ BlockHeap::~BlockHeap()
 	assert(m_head == nullptr && m_tail == nullptr);
 }
 
+#ifdef JINX_USE_THREAD_CACHE
+
+void BlockHeap::AddThreadCache(ThreadCache * cache)
+{
+	std::lock_guard<Mutex> lock(m_mutex);
+	cache->next = m_caches;
+	if (m_caches)
+		m_caches->prev = cache;
+	m_caches = cache;
+}
+
+#endif
+
 void * BlockHeap::Alloc(size_t bytes)
 {
 	if (!bytes)
 		return nullptr;
 
-	// Ensure thread-safe access to the allocator
-	std::lock_guard<Mutex> lock(m_mutex);
-
 	// The required allocation size is request size plus the size of the memory header
-	size_t requestedBytes = bytes + sizeof(MemoryHeader);
+	size_t requestedBytes = std::max(bytes, MIN_ALLOC_BYTES) + sizeof(MemoryHeader);
 
 	// Make sure allocations are always property aligned to the maximum 
 	requestedBytes = NextHighestMultiple(requestedBytes, std::alignment_of<max_align_t>::value);
 
-	// Make sure we have a valid memory block for the requested size
-	if (!m_head)
+#ifdef JINX_USE_THREAD_CACHE
+	// Small allocations are made from the calling thread's cache
+	if (!m_private && requestedBytes <= THREAD_CACHE_MAX_BYTES)
 	{
-		m_head = AllocBlock(requestedBytes);
-		m_tail = m_head;
+		ThreadCache * cache = GetThreadCache();
+		if (cache)
+			return AllocCached(cache, requestedBytes);
 	}
-	else
+#endif
+
+	// Ensure thread-safe access to the allocator
+	std::lock_guard<Mutex> lock(m_mutex);
+
+	// Reuse a freed allocation of the same size class if there is one
+	MemoryHeader * header = nullptr;
+	if (requestedBytes <= SIZE_CLASS_MAX_BYTES)
+		header = PopFreeAlloc(SizeClass(requestedBytes));
+	if (!header)
 	{
-		if (requestedBytes > (m_tail->capacity - m_tail->allocatedBytes))
+		// Make sure we have a valid memory block for the requested size
+		if (!m_head)
 		{
-			MemoryBlock * newBlock = AllocBlock(requestedBytes);
-			m_tail->next = newBlock;
-			newBlock->prev = m_tail;
-			m_tail = newBlock;
+			m_head = AllocBlock(requestedBytes);
+			m_tail = m_head;
+		}
+		else
+		{
+#ifdef JINX_USE_THREAD_CACHE
+			// Blocks in use by thread caches are only allocated from by their thread
+			if (m_tail->active || requestedBytes > (m_tail->capacity - m_tail->allocatedBytes))
+#else
+			if (requestedBytes > (m_tail->capacity - m_tail->allocatedBytes))
+#endif
+			{
+				// An empty tail block kept for reuse is freed instead of being left behind the new block
+#ifdef JINX_USE_THREAD_CACHE
+				MemoryBlock * emptyTail = (m_tail->count == 0 && !m_tail->active) ? m_tail : nullptr;
+#else
+				MemoryBlock * emptyTail = m_tail->count == 0 ? m_tail : nullptr;
+#endif
+				MemoryBlock * newBlock = AllocBlock(requestedBytes);
+				m_tail->next = newBlock;
+				newBlock->prev = m_tail;
+				m_tail = newBlock;
+				if (emptyTail)
+					FreeBlock(emptyTail);
+			}
 		}
-	}
 
-	// Return a memory pointer
-	void * ptr = m_tail->data + m_tail->allocatedBytes;
-	m_tail->allocatedBytes += requestedBytes;
-	m_tail->usedBytes += requestedBytes;
-	m_tail->count++;
+		// Return a memory pointer
+		header = reinterpret_cast<MemoryHeader *>(m_tail->data + m_tail->allocatedBytes);
+		m_tail->allocatedBytes += requestedBytes;
+		header->memBlock = m_tail;
+	}
+	header->memBlock->usedBytes += requestedBytes;
+	header->memBlock->count++;
 
 	// Fill out memory header with required information
-	MemoryHeader * header = static_cast<MemoryHeader *>(ptr);
-	header->memBlock = m_tail;
 	header->bytes = requestedBytes;
 
 #ifdef JINX_DEBUG_ALLOCATION
@@ -328,7 +668,7 @@ void * BlockHeap::Alloc(size_t bytes)
 
 	// Return the allocated pointer advanced by the size of the memory header.  We'll
 	// reverse the process when freeing the memory.
-	return static_cast<char*>(ptr) + sizeof(MemoryHeader);
+	return reinterpret_cast<char *>(header) + sizeof(MemoryHeader);
 }
 
 MemoryBlock * BlockHeap::AllocBlock(size_t bytes)
@@ -344,6 +684,11 @@ MemoryBlock * BlockHeap::AllocBlock(size_t bytes)
 	newBlock->count = 0;
 	newBlock->prev = nullptr;
 	newBlock->next = nullptr;
+	newBlock->heap = this;
+#ifdef JINX_USE_THREAD_CACHE
+	newBlock->cache = nullptr;
+	newBlock->active = false;
+#endif
 #ifdef JINX_DEBUG_ALLOCATION
 	newBlock->head = nullptr;
 	newBlock->tail = nullptr;
@@ -358,25 +703,291 @@ MemoryBlock * BlockHeap::AllocBlock(size_t bytes)
 	return newBlock;
 }
 
-void BlockHeap::Free(void * ptr)
+#ifdef JINX_USE_SLAB_ALLOCATOR
+
+void * BlockHeap::AllocFromSlabPages(SlabPage *& pages)
 {
-	// Ensure thread-safe access to the allocated blocks
+	// Allocate from the first page with a free allocation, and move it to the front of the list.  Must
+	// be called by the pages' owner, or with the mutex locked for shared pages.
+	for (SlabPage * page = pages; page; page = page->next)
+	{
+		if (!page->freeList && page->remoteFrees.load(std::memory_order_relaxed))
+			CollectRemoteFrees(page);
+		SlabObject * object = page->freeList;
+		if (object)
+		{
+			page->freeList = object->next;
+		}
+		else
+		{
+			uint32_t carved = page->carved.load(std::memory_order_relaxed);
+			if (carved == page->capacity)
+				continue;
+			object = reinterpret_cast<SlabObject *>(page->data + carved * page->objectBytes);
+			page->carved.store(carved + 1, std::memory_order_relaxed);
+		}
+		page->used.store(page->used.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		if (page != pages)
+		{
+			UnlinkSlabPage(page, pages);
+			LinkSlabPage(page, pages);
+		}
+		return object;
+	}
+	return nullptr;
+}
+
+void * BlockHeap::AllocSlab(size_t bytes)
+{
+	if (!bytes)
+		return nullptr;
+	if (bytes > SLAB_MAX_BYTES)
+		return Alloc(bytes);
+	size_t sizeClass = SlabClass(bytes);
+	void * ptr;
+
+#ifdef JINX_USE_THREAD_CACHE
+	// Allocate from the calling thread's pages, only locking the heap to add a page
+	ThreadCache * cache = m_private ? nullptr : GetThreadCache();
+	if (cache)
+	{
+		SlabPage *& pages = cache->slabPages[sizeClass];
+		ptr = AllocFromSlabPages(pages);
+		if (!ptr)
+		{
+			{
+				std::lock_guard<Mutex> lock(m_mutex);
+				LinkSlabPage(AllocSlabPage(sizeClass, cache), pages);
+			}
+			ptr = AllocFromSlabPages(pages);
+		}
+
+		// Update memory stats
+		AddToCounter(cache->allocCount, 1);
+		AddToCounter(cache->usedMemory, SlabObjectBytes(sizeClass));
+		return ptr;
+	}
+#endif
+
+	// Otherwise allocate from the shared pages
 	std::lock_guard<Mutex> lock(m_mutex);
+	SlabPage *& pages = m_slabPages[sizeClass];
+	ptr = AllocFromSlabPages(pages);
+	if (!ptr)
+	{
+		LinkSlabPage(AllocSlabPage(sizeClass, nullptr), pages);
+		ptr = AllocFromSlabPages(pages);
+	}
 
+	// Update memory stats
+	m_stats.currentUsedMemory += SlabObjectBytes(sizeClass);
+	m_stats.internalAllocCount++;
+	return ptr;
+}
+
+SlabPage * BlockHeap::AllocSlabPage(size_t sizeClass, void * owner)
+{
+	// Must be called with the mutex locked
+	SlabSpan * span = m_slabSpans;
+	while (span && span->usedPages == SLAB_SPAN_FULL)
+		span = span->next;
+	if (!span)
+		span = AllocSlabSpan();
+	uint32_t index = 0;
+	while (span->usedPages & (1u << index))
+		++index;
+	span->usedPages |= (1u << index);
+
+	uint8_t * memory = span->pages + index * SLAB_PAGE_SIZE;
+	SlabPage * page = new (memory) SlabPage();
+	page->span = span;
+	page->prev = nullptr;
+	page->next = nullptr;
+	page->owner.store(owner, std::memory_order_relaxed);
+	page->freeList = nullptr;
+	page->remoteFrees.store(nullptr, std::memory_order_relaxed);
+	page->data = memory + NextHighestMultiple(sizeof(SlabPage), std::alignment_of<max_align_t>::value);
+	page->sizeClass = static_cast<uint32_t>(sizeClass);
+	page->objectBytes = static_cast<uint32_t>(SlabObjectBytes(sizeClass));
+	page->capacity = static_cast<uint32_t>((memory + SLAB_PAGE_SIZE - page->data) / page->objectBytes);
+	page->carved.store(0, std::memory_order_relaxed);
+	page->used.store(0, std::memory_order_relaxed);
+	return page;
+}
+
+SlabSpan * BlockHeap::AllocSlabSpan()
+{
+	// Allocate an extra page of memory to align the span's pages, and place the span header before
+	// the aligned pages if there's room, or otherwise after them.  Must be called with the mutex locked.
+	size_t bytes = (SLAB_SPAN_PAGES + 1) * SLAB_PAGE_SIZE;
+	uint8_t * memory = static_cast<uint8_t *>(m_allocFn(bytes));
+	uint8_t * pages = reinterpret_cast<uint8_t *>(NextHighestMultiple(reinterpret_cast<uintptr_t>(memory), static_cast<uintptr_t>(SLAB_PAGE_SIZE)));
+	SlabSpan * span;
+	if (static_cast<size_t>(pages - memory) >= sizeof(SlabSpan))
+		span = reinterpret_cast<SlabSpan *>(memory);
+	else
+		span = reinterpret_cast<SlabSpan *>(pages + SLAB_SPAN_PAGES * SLAB_PAGE_SIZE);
+	span->memory = memory;
+	span->pages = pages;
+	span->usedPages = 0;
+	span->heap = this;
+	span->prev = nullptr;
+	span->next = m_slabSpans;
+	if (m_slabSpans)
+		m_slabSpans->prev = span;
+	m_slabSpans = span;
+	m_stats.currentAllocatedMemory += bytes;
+	m_stats.externalAllocCount++;
+	m_stats.currentBlockCount++;
+	return span;
+}
+
+void BlockHeap::CollectRemoteFrees(SlabPage * page)
+{
+	// Move allocations freed by other threads to the page's free list.  Must be called by the page's
+	// owner, or with the mutex locked for shared pages.
+	SlabObject * object = page->remoteFrees.exchange(nullptr, std::memory_order_acquire);
+	uint32_t count = 0;
+	while (object)
+	{
+		SlabObject * next = object->next;
+		object->next = page->freeList;
+		page->freeList = object;
+		object = next;
+		++count;
+	}
+	page->used.store(page->used.load(std::memory_order_relaxed) - count, std::memory_order_relaxed);
+}
+
+#endif // JINX_USE_SLAB_ALLOCATOR
+
+void BlockHeap::Destroy(BlockHeap * heap)
+{
+	// Private heaps are allocated from the global heap
+	heap->~BlockHeap();
+	s_heap.Free(heap);
+}
+
+#ifdef JINX_USE_THREAD_CACHE
+
+void * BlockHeap::AllocCached(ThreadCache * cache, size_t bytes)
+{
+	// Reuse a freed allocation of the same size from the cache or the heap, or allocate from
+	// the end of the cache's block
+	MemoryHeader * header = nullptr;
+	size_t sizeClass = SizeClass(bytes);
+	if (bytes <= FREE_LIST_MAX_BYTES && cache->freeLists[sizeClass])
+	{
+		header = cache->freeLists[sizeClass];
+		cache->freeLists[sizeClass] = NextFree(header);
+		--cache->freeListLengths[sizeClass];
+		AddToCounter(cache->cachedMemory, 0 - static_cast<uint64_t>(bytes));
+	}
+	else if (m_freeListLengths[sizeClass].load(std::memory_order_relaxed))
+	{
+		header = TakeFreeAllocs(cache, sizeClass);
+	}
+	if (!header)
+	{
+		size_t blockBytes = cache->blockBytes.load(std::memory_order_relaxed);
+		if (!cache->block || bytes > (cache->block->capacity - blockBytes))
+		{
+			RefillThreadCache(cache);
+			blockBytes = 0;
+		}
+		header = reinterpret_cast<MemoryHeader *>(cache->block->data + blockBytes);
+		header->memBlock = cache->block;
+		header->bytes = bytes;
+		cache->blockBytes.store(blockBytes + bytes, std::memory_order_relaxed);
+		++cache->blockCount;
+#ifdef JINX_USE_MEMORY_GUARDS
+		memset(header->memGuardHead, MEMORY_GUARD_PATTERN, MEMORY_GUARD_SIZE);
+		memset(header->memGuardTail, MEMORY_GUARD_PATTERN, MEMORY_GUARD_SIZE);
+#endif
+	}
+
+	// Update memory stats
+	AddToCounter(cache->allocCount, 1);
+	AddToCounter(cache->usedMemory, bytes);
+	return reinterpret_cast<char *>(header) + sizeof(MemoryHeader);
+}
+
+void BlockHeap::FlushThreadCache(ThreadCache * cache)
+{
+	// Return cached allocations and the cache's block to the heap.  Must be called with the mutex locked.
+	for (size_t i = 0; i < FREE_LIST_COUNT; ++i)
+	{
+		while (cache->freeLists[i])
+		{
+			MemoryHeader * header = cache->freeLists[i];
+			cache->freeLists[i] = NextFree(header);
+			FreeInternal(header);
+		}
+		cache->freeListLengths[i] = 0;
+	}
+	cache->cachedMemory.store(0, std::memory_order_relaxed);
+	RetireThreadCacheBlock(cache);
+}
+
+#ifdef JINX_USE_SLAB_ALLOCATOR
+
+void BlockHeap::FlushSlabPages(ThreadCache * cache)
+{
+	// Share the cache's slab pages still in use, and release the rest.  Allocations another thread
+	// frees while the page changes owner may be left in its remote free list, until collected by the
+	// next thread to allocate from the page.  Must be called with the mutex locked.
+	for (size_t i = 0; i < SLAB_CLASS_COUNT; ++i)
+	{
+		while (cache->slabPages[i])
+		{
+			SlabPage * page = cache->slabPages[i];
+			UnlinkSlabPage(page, cache->slabPages[i]);
+			page->owner.store(nullptr);
+			CollectRemoteFrees(page);
+			if (page->used.load(std::memory_order_relaxed) == 0)
+				ReleaseSlabPage(page);
+			else
+				LinkSlabPage(page, m_slabPages[i]);
+		}
+	}
+}
+
+#endif
+
+#endif
+
+void BlockHeap::Free(void * ptr)
+{
 	// Retrieve the memory header from the raw pointer
 	MemoryHeader * header = reinterpret_cast<MemoryHeader*>(static_cast<char *>(ptr) - sizeof(MemoryHeader));
 
-	// Free the memory from the allocated block
-	FreeInternal(header);
+	Free(header);
 }
 
 void BlockHeap::Free(MemoryHeader * header)
 {
-	// Ensure thread-safe access to the allocated blocks
-	std::lock_guard<Mutex> lock(m_mutex);
+#ifdef JINX_USE_THREAD_CACHE
+	// Small allocations made by the calling thread are kept in its cache for reuse
+	ThreadCache * cache = GetThreadCache();
+	if (cache && FreeCached(cache, header))
+		return;
+#endif
+
+	bool destroy;
+	{
+		// Ensure thread-safe access to the allocated blocks
+		std::lock_guard<Mutex> lock(m_mutex);
 
-	// Free the memory from the allocated block
-	FreeInternal(header);
+		// Update memory stats
+		m_stats.currentUsedMemory -= header->bytes;
+		m_stats.internalFreeCount++;
+
+		// Free the memory from the allocated block
+		FreeInternal(header);
+		destroy = IsDestroyable();
+	}
+	if (destroy)
+		Destroy(this);
 }
 
 void BlockHeap::FreeInternal(MemoryHeader * header)
@@ -389,9 +1000,15 @@ void BlockHeap::FreeInternal(MemoryHeader * header)
 	assert(memcmp(header->memGuardTail, s_memoryGuardCheck, MEMORY_GUARD_SIZE) == 0);
 #endif 
 
-	// Assert we're not freeing more than we've allocated
+	// Assert we're not freeing more than we've allocated.  Blocks in use by thread caches
+	// don't yet count allocations made from them.
+#ifdef JINX_USE_THREAD_CACHE
+	assert(memBlock->active || memBlock->usedBytes >= header->bytes);
+	assert(memBlock->active || memBlock->count > 0);
+#else
 	assert(memBlock->usedBytes >= header->bytes);
 	assert(memBlock->count > 0);
+#endif
 
 	// Subtract memory buffer size
 	memBlock->usedBytes -= header->bytes;
@@ -399,10 +1016,6 @@ void BlockHeap::FreeInternal(MemoryHeader * header)
 	// Subtract an allocation count
 	memBlock->count--;
 
-	// Update memory stats
-	m_stats.currentUsedMemory -= header->bytes;
-	m_stats.internalFreeCount++;
-
 #ifdef JINX_DEBUG_ALLOCATION
 
 	// Update the memory blocks head or tail pointers if required
@@ -422,9 +1035,18 @@ void BlockHeap::FreeInternal(MemoryHeader * header)
 #endif
 
 	// If the allocation count reaches zero, then we can free
-	// the block.
+	// the block.  Blocks in use by thread caches are freed when
+	// retired, since their count doesn't yet include allocations
+	// made from them.  Otherwise, small allocations are kept
+	// for reuse.
+#ifdef JINX_USE_THREAD_CACHE
+	if (memBlock->count == 0 && !memBlock->active)
+#else
 	if (memBlock->count == 0)
+#endif
 		FreeBlock(memBlock);
+	else if (header->bytes <= SIZE_CLASS_MAX_BYTES)
+		PushFreeAlloc(header);
 }
 
 void BlockHeap::FreeBlock(MemoryBlock * block)
@@ -438,6 +1060,18 @@ void BlockHeap::FreeBlock(MemoryBlock * block)
 	assert(memcmp(block->memGuardTail, s_memoryGuardCheck, MEMORY_GUARD_SIZE) == 0);
 #endif 
 
+	// Remove the block's freed allocations from the free lists.  Allocations are
+	// made contiguously from the start of the block, so each header is found
+	// following the last.
+	size_t offset = 0;
+	while (offset < block->allocatedBytes)
+	{
+		MemoryHeader * header = reinterpret_cast<MemoryHeader *>(block->data + offset);
+		if (header->bytes & FREE_ALLOC_FLAG)
+			RemoveFreeAlloc(header);
+		offset += header->bytes & ~FREE_ALLOC_FLAG;
+	}
+
 	// If this is the tail block but not the head, don't free it, but instead just 
 	// reset the size parameter, which effectively resets the allocations
 	// from this block.
@@ -445,6 +1079,10 @@ void BlockHeap::FreeBlock(MemoryBlock * block)
 	{
 		block->allocatedBytes = 0;
 		block->usedBytes = 0;
+#ifdef JINX_USE_THREAD_CACHE
+		// A retired thread cache block reused for shared allocations no longer belongs to the cache
+		block->cache = nullptr;
+#endif
 	}
 	else
 	{
@@ -466,12 +1104,171 @@ void BlockHeap::FreeBlock(MemoryBlock * block)
 	}
 }
 
+#ifdef JINX_USE_THREAD_CACHE
+
+bool BlockHeap::FreeCached(ThreadCache * cache, MemoryHeader * header)
+{
+	if (header->bytes > FREE_LIST_MAX_BYTES || header->memBlock->cache != cache)
+		return false;
+	size_t index = SizeClass(header->bytes);
+	if (cache->freeListLengths[index] >= FREE_LIST_MAX_LENGTH)
+		return false;
+#ifdef JINX_USE_MEMORY_GUARDS
+	assert(memcmp(header->memGuardHead, s_memoryGuardCheck, MEMORY_GUARD_SIZE) == 0);
+	assert(memcmp(header->memGuardTail, s_memoryGuardCheck, MEMORY_GUARD_SIZE) == 0);
+#endif
+	NextFree(header) = cache->freeLists[index];
+	cache->freeLists[index] = header;
+	++cache->freeListLengths[index];
+
+	// Update memory stats
+	AddToCounter(cache->freeCount, 1);
+	AddToCounter(cache->usedMemory, 0 - static_cast<uint64_t>(header->bytes));
+	AddToCounter(cache->cachedMemory, header->bytes);
+	return true;
+}
+
+#endif
+
+#ifdef JINX_USE_SLAB_ALLOCATOR
+
+void BlockHeap::FreeSlab(void * ptr, size_t bytes)
+{
+	size_t sizeClass = SlabClass(bytes);
+	uint64_t objectBytes = SlabObjectBytes(sizeClass);
+	SlabPage * page = GetSlabPage(ptr);
+	SlabObject * object = static_cast<SlabObject *>(ptr);
+
+#ifdef JINX_USE_THREAD_CACHE
+	ThreadCache * cache = GetThreadCache();
+	void * owner = page->owner.load();
+	if (owner && owner == cache)
+	{
+		// Free to the calling thread's own page without locking
+		object->next = page->freeList;
+		page->freeList = object;
+		uint32_t used = page->used.load(std::memory_order_relaxed) - 1;
+		page->used.store(used, std::memory_order_relaxed);
+
+		// Update memory stats
+		AddToCounter(cache->freeCount, 1);
+		AddToCounter(cache->usedMemory, 0 - objectBytes);
+
+		// Release emptied pages, except the page allocations are made from first
+		if (used == 0 && page != cache->slabPages[sizeClass])
+		{
+			std::lock_guard<Mutex> lock(m_mutex);
+			UnlinkSlabPage(page, cache->slabPages[sizeClass]);
+			ReleaseSlabPage(page);
+		}
+		return;
+	}
+	if (owner)
+	{
+		// Push the allocation onto the page's remote free list, collected by its owner.  The page isn't
+		// accessed after the push, since the owner may then collect the allocation and release the page.
+		SlabObject * head = page->remoteFrees.load(std::memory_order_relaxed);
+		do
+		{
+			object->next = head;
+		}
+		while (!page->remoteFrees.compare_exchange_weak(head, object, std::memory_order_release, std::memory_order_relaxed));
+
+		// Update memory stats
+		if (cache)
+		{
+			AddToCounter(cache->freeCount, 1);
+			AddToCounter(cache->usedMemory, 0 - objectBytes);
+		}
+		else
+		{
+			std::lock_guard<Mutex> lock(m_mutex);
+			m_stats.currentUsedMemory -= objectBytes;
+			m_stats.internalFreeCount++;
+		}
+		return;
+	}
+#endif
+
+	// Free to a shared page with the heap locked
+	bool destroy;
+	{
+		std::lock_guard<Mutex> lock(m_mutex);
+		CollectRemoteFrees(page);
+		object->next = page->freeList;
+		page->freeList = object;
+		uint32_t used = page->used.load(std::memory_order_relaxed) - 1;
+		page->used.store(used, std::memory_order_relaxed);
+
+		// Update memory stats
+		m_stats.currentUsedMemory -= objectBytes;
+		m_stats.internalFreeCount++;
+
+		if (used == 0 && page != m_slabPages[sizeClass])
+		{
+			UnlinkSlabPage(page, m_slabPages[sizeClass]);
+			ReleaseSlabPage(page);
+		}
+		destroy = IsDestroyable();
+	}
+	if (destroy)
+		Destroy(this);
+}
+
+#endif
+
 MemoryStats BlockHeap::GetMemoryStats()
 {
 	// Ensure thread-safe access to the allocated blocks
 	std::lock_guard<Mutex> lock(m_mutex);
 
-	return m_stats;
+	MemoryStats stats = m_stats;
+	stats.currentFreeListMemory = m_freeListBytes;
+#ifdef JINX_USE_THREAD_CACHE
+	// Add the stats of allocations made through thread caches
+	for (ThreadCache * cache = m_caches; cache; cache = cache->next)
+	{
+		stats.internalAllocCount += static_cast<uint32_t>(cache->allocCount.load(std::memory_order_relaxed));
+		stats.internalFreeCount += static_cast<uint32_t>(cache->freeCount.load(std::memory_order_relaxed));
+		stats.currentUsedMemory += cache->usedMemory.load(std::memory_order_relaxed);
+		stats.currentFreeListMemory += cache->cachedMemory.load(std::memory_order_relaxed);
+	}
+#endif
+
+	// Memory allocated from blocks but no longer in use is fragmented, since it can only be reused
+	// by allocations of the same size, or reclaimed when the rest of its block is freed
+	uint64_t allocatedBytes = 0;
+	for (MemoryBlock * block = m_head; block; block = block->next)
+	{
+#ifdef JINX_USE_THREAD_CACHE
+		if (block->active)
+		{
+			allocatedBytes += static_cast<ThreadCache *>(block->cache)->blockBytes.load(std::memory_order_relaxed);
+			continue;
+		}
+#endif
+		allocatedBytes += block->allocatedBytes;
+	}
+#ifdef JINX_USE_SLAB_ALLOCATOR
+	// Memory carved from slab pages but no longer in use is kept in the pages' free lists.  The use
+	// count is read first, since it never exceeds the carved count, which only increases.
+	for (SlabSpan * span = m_slabSpans; span; span = span->next)
+	{
+		for (uint32_t i = 0; i < SLAB_SPAN_PAGES; ++i)
+		{
+			if (!(span->usedPages & (1u << i)))
+				continue;
+			SlabPage * page = reinterpret_cast<SlabPage *>(span->pages + i * SLAB_PAGE_SIZE);
+			uint64_t used = page->used.load(std::memory_order_relaxed);
+			uint64_t carved = page->carved.load(std::memory_order_relaxed);
+			allocatedBytes += carved * page->objectBytes;
+			stats.currentFreeListMemory += (carved - used) * page->objectBytes;
+		}
+	}
+#endif
+	if (stats.currentAllocatedMemory && allocatedBytes > stats.currentUsedMemory)
+		stats.fragmentation = static_cast<double>(allocatedBytes - stats.currentUsedMemory) / static_cast<double>(stats.currentAllocatedMemory);
+	return stats;
 }
 
 void BlockHeap::Initialize(const GlobalParams & params)
@@ -489,6 +1286,33 @@ void BlockHeap::Initialize(const GlobalParams & params)
 	}
 }
 
+void BlockHeap::Initialize(const RuntimeParams & params, const BlockHeap & defaults)
+{
+	m_private = true;
+	if (params.allocFn || params.reallocFn || params.freeFn)
+	{
+		// If you're using one custom memory function, you must use them ALL
+		assert(params.allocFn && params.reallocFn && params.freeFn);
+		m_allocFn = params.allocFn;
+		m_reallocFn = params.reallocFn;
+		m_freeFn = params.freeFn;
+	}
+	else
+	{
+		m_allocFn = defaults.m_allocFn;
+		m_reallocFn = defaults.m_reallocFn;
+		m_freeFn = defaults.m_freeFn;
+	}
+	assert(params.allocBlockSize >= (1024 * 4));
+	m_allocBlockSize = params.allocBlockSize - sizeof(MemoryBlock);
+}
+
+bool BlockHeap::IsDestroyable() const
+{
+	// Must be called with the mutex locked
+	return m_released && m_stats.internalAllocCount == m_stats.internalFreeCount;
+}
+
 void BlockHeap::LogAllocations()
 {
 	LogWriteLine("=== Memory Log Begin ===");
@@ -533,11 +1357,37 @@ void BlockHeap::LogAllocations()
 	LogWriteLine("Current block count:      %i", memStats.currentBlockCount);
 	LogWriteLine("Current allocated memory: %lli", memStats.currentAllocatedMemory);
 	LogWriteLine("Current used memory:      %lli", memStats.currentAllocatedMemory);
+	LogWriteLine("Current free list memory: %lli", memStats.currentFreeListMemory);
+	LogWriteLine("Fragmentation:            %.2f", memStats.fragmentation);
 	LogWriteLine("");
 	LogWriteLine("=== Memory Log End ===");
 
 }
 
+MemoryHeader * BlockHeap::PopFreeAlloc(size_t sizeClass)
+{
+	// Must be called with the mutex locked
+	MemoryHeader * header = m_freeLists[sizeClass];
+	if (header)
+		RemoveFreeAlloc(header);
+	return header;
+}
+
+void BlockHeap::PushFreeAlloc(MemoryHeader * header)
+{
+	// Must be called with the mutex locked
+	size_t sizeClass = SizeClass(header->bytes);
+	FreeLinks * links = GetFreeLinks(header);
+	links->prev = nullptr;
+	links->next = m_freeLists[sizeClass];
+	if (links->next)
+		GetFreeLinks(links->next)->prev = header;
+	m_freeLists[sizeClass] = header;
+	m_freeListLengths[sizeClass].store(m_freeListLengths[sizeClass].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	m_freeListBytes += header->bytes;
+	header->bytes |= FREE_ALLOC_FLAG;
+}
+
 void * BlockHeap::Realloc(void * ptr, size_t bytes)
 {
 
@@ -575,14 +1425,172 @@ void * BlockHeap::Realloc(void * ptr, size_t bytes)
 	return p;
 }
 
+void BlockHeap::Release()
+{
+	bool destroy;
+	{
+		std::lock_guard<Mutex> lock(m_mutex);
+		m_released = true;
+		destroy = IsDestroyable();
+	}
+	if (destroy)
+		Destroy(this);
+}
+
+#ifdef JINX_USE_SLAB_ALLOCATOR
+
+void BlockHeap::ReleaseSlabPage(SlabPage * page)
+{
+	// Return an empty page to its span, and free the span if none of its pages are in use.  Must be
+	// called with the mutex locked.
+	SlabSpan * span = page->span;
+	uint32_t index = static_cast<uint32_t>((reinterpret_cast<uint8_t *>(page) - span->pages) / SLAB_PAGE_SIZE);
+	span->usedPages &= ~(1u << index);
+	if (span->usedPages)
+		return;
+	if (span->prev)
+		span->prev->next = span->next;
+	else
+		m_slabSpans = span->next;
+	if (span->next)
+		span->next->prev = span->prev;
+	m_stats.externalFreeCount++;
+	m_stats.currentAllocatedMemory -= (SLAB_SPAN_PAGES + 1) * SLAB_PAGE_SIZE;
+	m_stats.currentBlockCount--;
+	m_freeFn(span->memory);
+}
+
+#endif
+
+void BlockHeap::RemoveFreeAlloc(MemoryHeader * header)
+{
+	// Must be called with the mutex locked
+	header->bytes &= ~FREE_ALLOC_FLAG;
+	size_t sizeClass = SizeClass(header->bytes);
+	FreeLinks * links = GetFreeLinks(header);
+	if (links->prev)
+		GetFreeLinks(links->prev)->next = links->next;
+	else
+		m_freeLists[sizeClass] = links->next;
+	if (links->next)
+		GetFreeLinks(links->next)->prev = links->prev;
+	m_freeListLengths[sizeClass].store(m_freeListLengths[sizeClass].load(std::memory_order_relaxed) - 1, std::memory_order_relaxed);
+	m_freeListBytes -= header->bytes;
+}
+
+#ifdef JINX_USE_THREAD_CACHE
+
+void BlockHeap::RefillThreadCache(ThreadCache * cache)
+{
+	std::lock_guard<Mutex> lock(m_mutex);
+	RetireThreadCacheBlock(cache);
+
+	// Thread cache blocks are added to the front of the list, leaving the tail block for shared allocations
+	MemoryBlock * block = AllocBlock(m_allocBlockSize);
+	block->cache = cache;
+	block->active = true;
+	if (m_head)
+	{
+		block->next = m_head;
+		m_head->prev = block;
+		m_head = block;
+	}
+	else
+	{
+		m_head = block;
+		m_tail = block;
+	}
+	cache->block = block;
+}
+
+void BlockHeap::RemoveThreadCache(ThreadCache * cache)
+{
+	std::lock_guard<Mutex> lock(m_mutex);
+	FlushThreadCache(cache);
+#ifdef JINX_USE_SLAB_ALLOCATOR
+	FlushSlabPages(cache);
+#endif
+
+	// Keep the stats of the cache's allocations
+	m_stats.internalAllocCount += static_cast<uint32_t>(cache->allocCount.load(std::memory_order_relaxed));
+	m_stats.internalFreeCount += static_cast<uint32_t>(cache->freeCount.load(std::memory_order_relaxed));
+	m_stats.currentUsedMemory += cache->usedMemory.load(std::memory_order_relaxed);
+
+	if (cache->prev)
+		cache->prev->next = cache->next;
+	else
+		m_caches = cache->next;
+	if (cache->next)
+		cache->next->prev = cache->prev;
+}
+
+void BlockHeap::RetireThreadCacheBlock(ThreadCache * cache)
+{
+	// Add the allocations made from the cache's block to its count.  Must be called with the mutex locked.
+	MemoryBlock * block = cache->block;
+	if (!block)
+		return;
+	size_t blockBytes = cache->blockBytes.load(std::memory_order_relaxed);
+	block->allocatedBytes = blockBytes;
+	block->usedBytes += blockBytes;
+	block->count += cache->blockCount;
+	block->active = false;
+	cache->block = nullptr;
+	cache->blockBytes.store(0, std::memory_order_relaxed);
+	cache->blockCount = 0;
+	if (block->count == 0)
+		FreeBlock(block);
+}
+
+#endif
+
 void BlockHeap::ShutDown()
 {
+#ifdef JINX_USE_THREAD_CACHE
+	// Return the calling thread's cached memory, so its blocks can be freed
+	ThreadCache * cache = m_private ? nullptr : GetThreadCache();
+	if (cache)
+	{
+		std::lock_guard<Mutex> lock(m_mutex);
+		FlushThreadCache(cache);
+#ifdef JINX_USE_SLAB_ALLOCATOR
+		FlushSlabPages(cache);
+#endif
+	}
+#endif
+
+#ifdef JINX_USE_SLAB_ALLOCATOR
+	// Release shared slab pages no longer in use, so their spans can be freed
+	{
+		std::lock_guard<Mutex> lock(m_mutex);
+		for (size_t i = 0; i < SLAB_CLASS_COUNT; ++i)
+		{
+			SlabPage * page = m_slabPages[i];
+			while (page)
+			{
+				SlabPage * next = page->next;
+				CollectRemoteFrees(page);
+				if (page->used.load(std::memory_order_relaxed) == 0)
+				{
+					UnlinkSlabPage(page, m_slabPages[i]);
+					ReleaseSlabPage(page);
+				}
+				page = next;
+			}
+		}
+	}
+#endif
+
 	MemoryBlock * curr = m_head;
 	MemoryBlock * next;
 	while (curr)
 	{
 		next = curr->next;
+#ifdef JINX_USE_THREAD_CACHE
+		if (curr->usedBytes == 0 && !curr->active)
+#else
 		if (curr->usedBytes == 0)
+#endif
 		{
 			m_stats.externalFreeCount++;
 			m_stats.currentAllocatedMemory -= (curr->capacity + sizeof(MemoryBlock));
@@ -596,14 +1604,83 @@ void BlockHeap::ShutDown()
 	}
 	m_head = nullptr;
 	m_tail = nullptr;
+
+	// Allocations freed in blocks still in use aren't reused after shutting down
+	for (size_t i = 0; i < SIZE_CLASS_COUNT; ++i)
+	{
+		m_freeLists[i] = nullptr;
+		m_freeListLengths[i] = 0;
+	}
+	m_freeListBytes = 0;
 }
 
+#ifdef JINX_USE_THREAD_CACHE
+
+MemoryHeader * BlockHeap::TakeFreeAllocs(ThreadCache * cache, size_t sizeClass)
+{
+	// Take a freed allocation from the heap, and more for the cache's free list if it keeps this size
+	std::lock_guard<Mutex> lock(m_mutex);
+	MemoryHeader * header = PopFreeAlloc(sizeClass);
+	if (!header)
+		return nullptr;
+	header->memBlock->usedBytes += header->bytes;
+	header->memBlock->count++;
+	if (header->bytes <= FREE_LIST_MAX_BYTES)
+	{
+		while (cache->freeListLengths[sizeClass] < FREE_LIST_REFILL_LENGTH)
+		{
+			MemoryHeader * cached = PopFreeAlloc(sizeClass);
+			if (!cached)
+				break;
+			cached->memBlock->usedBytes += cached->bytes;
+			cached->memBlock->count++;
+			NextFree(cached) = cache->freeLists[sizeClass];
+			cache->freeLists[sizeClass] = cached;
+			++cache->freeListLengths[sizeClass];
+			AddToCounter(cache->cachedMemory, cached->bytes);
+		}
+	}
+	return header;
+}
+
+ThreadCache::ThreadCache() :
+	block(nullptr),
+	blockBytes(0),
+	blockCount(0),
+	allocCount(0),
+	freeCount(0),
+	usedMemory(0),
+	cachedMemory(0),
+	prev(nullptr),
+	next(nullptr)
+{
+	for (size_t i = 0; i < FREE_LIST_COUNT; ++i)
+	{
+		freeLists[i] = nullptr;
+		freeListLengths[i] = 0;
+	}
+#ifdef JINX_USE_SLAB_ALLOCATOR
+	for (size_t i = 0; i < SLAB_CLASS_COUNT; ++i)
+		slabPages[i] = nullptr;
+#endif
+	s_heap.AddThreadCache(this);
+}
+
+ThreadCache::~ThreadCache()
+{
+	s_heap.RemoveThreadCache(this);
+	s_threadCacheDestroyed = true;
+}
+
+#endif // JINX_USE_THREAD_CACHE
+
 #endif // JINX_DISABLE_POOL_ALLOCATOR
 
 #ifdef JINX_DEBUG_ALLOCATION
 
 void * Jinx::MemPoolAllocate(const char * file, const char * function, uint32_t line, size_t bytes)
 {
+	++s_threadAllocCount;
 	void * p;
 #if defined(JINX_DEBUG_USE_STD_ALLOC)
 	Jinx::ref(file);
@@ -616,7 +1693,7 @@ void * Jinx::MemPoolAllocate(const char * file, const char * function, uint32_t
 	Jinx::ref(line);
 	p = s_heap.Alloc(bytes);
 #else
-	p = s_heap.Alloc(bytes);
+	p = CurrentHeap()->Alloc(bytes);
 	MemoryHeader * header = reinterpret_cast<MemoryHeader*>(static_cast<char *>(p) - sizeof(MemoryHeader));
 	header->file = file;
 	header->function = function;
@@ -627,6 +1704,7 @@ void * Jinx::MemPoolAllocate(const char * file, const char * function, uint32_t
 
 void * Jinx::MemPoolReallocate(const char * file, const char * function, uint32_t line, void * ptr, size_t bytes)
 {
+	++s_threadAllocCount;
 	void * p;
 #ifdef JINX_DEBUG_USE_STD_ALLOC
 	Jinx::ref(file);
@@ -648,7 +1726,7 @@ void * Jinx::MemPoolReallocate(const char * file, const char * function, uint32_
 	Jinx::ref(line);
 	p = s_heap.Realloc(ptr, bytes);
 #else
-	p = s_heap.Realloc(ptr, bytes);
+	p = (ptr ? OwningHeap(ptr) : CurrentHeap())->Realloc(ptr, bytes);
 	if (p)
 	{
 		MemoryHeader * header = reinterpret_cast<MemoryHeader*>(static_cast<char *>(p) - sizeof(MemoryHeader));
@@ -664,22 +1742,28 @@ void * Jinx::MemPoolReallocate(const char * file, const char * function, uint32_
 
 void * Jinx::MemPoolAllocate(size_t bytes)
 {
+	++s_threadAllocCount;
 	void * p;
-#ifdef JINX_DEBUG_USE_STD_ALLOC
+#if defined(JINX_DEBUG_USE_STD_ALLOC)
 	p = malloc(bytes);
-#else
+#elif defined(JINX_DISABLE_POOL_ALLOCATOR)
 	p = s_heap.Alloc(bytes);
+#else
+	p = CurrentHeap()->Alloc(bytes);
 #endif
 	return p;
 }
 
 void * Jinx::MemPoolReallocate(void * ptr, size_t bytes)
 {
+	++s_threadAllocCount;
 	void * p;
-#ifdef JINX_DEBUG_USE_STD_ALLOC
+#if defined(JINX_DEBUG_USE_STD_ALLOC)
 	p = realloc(ptr, bytes);
-#else
+#elif defined(JINX_DISABLE_POOL_ALLOCATOR)
 	p = s_heap.Realloc(ptr, bytes);
+#else
+	p = (ptr ? OwningHeap(ptr) : CurrentHeap())->Realloc(ptr, bytes);
 #endif
 	return p;
 }
@@ -690,10 +1774,38 @@ void Jinx::MemPoolFree(void * ptr)
 {
 	if (!ptr)
 		return;
-#ifdef JINX_DEBUG_USE_STD_ALLOC
+#if defined(JINX_DEBUG_USE_STD_ALLOC)
 	free(ptr);
-#else
+#elif defined(JINX_DISABLE_POOL_ALLOCATOR)
 	s_heap.Free(ptr);
+#else
+	OwningHeap(ptr)->Free(ptr);
+#endif
+}
+
+void * Jinx::MemPoolAllocateSlab(size_t bytes)
+{
+#ifdef JINX_USE_SLAB_ALLOCATOR
+	++s_threadAllocCount;
+	return CurrentHeap()->AllocSlab(bytes);
+#else
+	return JinxAlloc(bytes);
+#endif
+}
+
+void Jinx::MemPoolFreeSlab(void * ptr, size_t bytes)
+{
+#ifdef JINX_USE_SLAB_ALLOCATOR
+	// Slab allocations are freed to the heap owning their page
+	if (!ptr)
+		return;
+	if (bytes > SLAB_MAX_BYTES)
+		OwningHeap(ptr)->Free(ptr);
+	else
+		GetSlabPage(ptr)->span->heap->FreeSlab(ptr, bytes);
+#else
+	Jinx::ref(bytes);
+	MemPoolFree(ptr);
 #endif
 }
 
@@ -707,11 +1819,60 @@ void Jinx::ShutDownMemory()
 	s_heap.ShutDown();
 }
 
+uint64_t Jinx::GetThreadAllocationCount()
+{
+	return s_threadAllocCount;
+}
+
 MemoryStats Jinx::GetMemoryStats()
 {
 	return s_heap.GetMemoryStats();
 }
 
+BlockHeap * Jinx::CreateHeap(const RuntimeParams & params)
+{
+#if defined(JINX_DISABLE_POOL_ALLOCATOR) || defined(JINX_DEBUG_USE_STD_ALLOC)
+	Jinx::ref(params);
+	return nullptr;
+#else
+	// Heaps are allocated from the global heap, and outlive the runtime owning them until all their memory is freed
+	BlockHeap * heap = new (s_heap.Alloc(sizeof(BlockHeap))) BlockHeap();
+	heap->Initialize(params, s_heap);
+	return heap;
+#endif
+}
+
+void Jinx::ReleaseHeap(BlockHeap * heap)
+{
+#if defined(JINX_DISABLE_POOL_ALLOCATOR) || defined(JINX_DEBUG_USE_STD_ALLOC)
+	Jinx::ref(heap);
+#else
+	if (heap)
+		heap->Release();
+#endif
+}
+
+MemoryStats Jinx::GetMemoryStats(BlockHeap * heap)
+{
+#ifdef JINX_DISABLE_POOL_ALLOCATOR
+	Jinx::ref(heap);
+	return s_heap.GetMemoryStats();
+#else
+	return heap ? heap->GetMemoryStats() : s_heap.GetMemoryStats();
+#endif
+}
+
+HeapScope::HeapScope(BlockHeap * heap) :
+	m_previous(s_currentHeap)
+{
+	s_currentHeap = heap;
+}
+
+HeapScope::~HeapScope()
+{
+	s_currentHeap = m_previous;
+}
+
 void Jinx::LogAllocations()
 {
 #ifndef JINX_DEBUG_USE_STD_ALLOC
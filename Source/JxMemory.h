@@ -161,6 +161,14 @@ namespace Jinx
 
 	void MemPoolFree(void * ptr);
 
+	// Allocate small allocations without a header from pages of allocations the same size.  These must
+	// be freed with the same size they were allocated with.
+	void * MemPoolAllocateSlab(size_t bytes);
+	void MemPoolFreeSlab(void * ptr, size_t bytes);
+
+	// Number of allocations made by the calling thread, counted without locking for performance stats
+	uint64_t GetThreadAllocationCount();
+
 	template<typename T>
 	void MemPoolFreeObject(T * obj)
 	{
@@ -200,9 +208,9 @@ namespace Jinx
 		pointer address(reference value) const { return &value; }
 		const_pointer address(const_reference value) const { return &value; }
 
-		pointer allocate(size_type n) { return static_cast<pointer> (Jinx::JinxAlloc(n * sizeof(value_type))); }
-		pointer allocate(size_type n, const void *) { return static_cast<pointer> (Jinx::JinxAlloc(n * sizeof(value_type))); }
-		void deallocate(void* ptr, size_type) { Jinx::JinxFree(static_cast<T*> (ptr)); }
+		pointer allocate(size_type n) { return static_cast<pointer> (Jinx::MemPoolAllocateSlab(n * sizeof(value_type))); }
+		pointer allocate(size_type n, const void *) { return static_cast<pointer> (Jinx::MemPoolAllocateSlab(n * sizeof(value_type))); }
+		void deallocate(void* ptr, size_type n) { Jinx::MemPoolFreeSlab(ptr, n * sizeof(value_type)); }
 
 		template<typename U, typename... Args>
 		void construct(U* ptr, Args&&  ... args) { ::new ((void*)(ptr)) U(std::forward<Args>(args)...); }
@@ -236,7 +244,9 @@ namespace Jinx
 			internalFreeCount(0),
 			currentBlockCount(0),
 			currentAllocatedMemory(0),
-			currentUsedMemory(0)
+			currentUsedMemory(0),
+			currentFreeListMemory(0),
+			fragmentation(0.0)
 		{}
 		uint32_t externalAllocCount;
 		uint32_t externalFreeCount;
@@ -245,6 +255,10 @@ namespace Jinx
 		uint32_t currentBlockCount;
 		uint64_t currentAllocatedMemory;
 		uint64_t currentUsedMemory;
+		// Memory of freed allocations kept in free lists for reuse
+		uint64_t currentFreeListMemory;
+		// Fraction of allocated memory that was used by allocations since freed, but not yet reclaimed
+		double fragmentation;
 	};
 
 
@@ -256,6 +270,35 @@ namespace Jinx
 	// Get memory stats
 	MemoryStats GetMemoryStats();
 
+	// Heaps owned by individual runtimes, so independent runtimes don't share a lock, fragmentation, or
+	// stats.  Memory is always freed to the heap it was allocated from, whichever heap is current.
+	class BlockHeap;
+	struct RuntimeParams;
+
+	// Create a heap, or return null if only the global heap is available in this build
+	BlockHeap * CreateHeap(const RuntimeParams & params);
+
+	// Release a heap, which is destroyed once all memory allocated from it is freed
+	void ReleaseHeap(BlockHeap * heap);
+
+	// Get memory stats of a heap, or of the global heap if null
+	MemoryStats GetMemoryStats(BlockHeap * heap);
+
+	// Allocations made by the calling thread are made from the scope's heap, or from the global
+	// heap if null, until the scope ends
+	class HeapScope
+	{
+	public:
+		explicit HeapScope(BlockHeap * heap);
+		~HeapScope();
+
+		HeapScope(const HeapScope &) = delete;
+		HeapScope & operator = (const HeapScope &) = delete;
+
+	private:
+		BlockHeap * m_previous;
+	};
+
 	// Log all currently allocated memory (debug only)
 	void LogAllocations();
 
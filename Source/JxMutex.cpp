@@ -23,8 +23,10 @@ using namespace Jinx;
 
 #if defined(JINX_WINDOWS)
 static_assert(sizeof(CRITICAL_SECTION) <= MutexDataSize, "Data size must match or exceed CRITICAL_SECTION");
+static_assert(sizeof(CONDITION_VARIABLE) <= ConditionVariableDataSize, "Data size must match or exceed CONDITION_VARIABLE");
 #elif defined(JINX_MACOS) || defined(JINX_LINUX)
 static_assert(sizeof(pthread_mutex_t) <= MutexDataSize, "Data size must match or exceed pthread_mutex_t");
+static_assert(sizeof(pthread_cond_t) <= ConditionVariableDataSize, "Data size must match or exceed pthread_cond_t");
 #else
 assert(!"Platform-specific mutex not defined");
 #endif
@@ -73,3 +75,47 @@ void Mutex::unlock()
 #endif
 }
 
+ConditionVariable::ConditionVariable()
+{
+#if defined(JINX_WINDOWS)
+	InitializeConditionVariable(reinterpret_cast<PCONDITION_VARIABLE>(&m_data));
+#elif defined(JINX_MACOS) || defined(JINX_LINUX)
+	pthread_cond_init(reinterpret_cast<pthread_cond_t *>(&m_data), NULL);
+#else
+	assert(!"Platform-specific condition variable not defined");
+#endif
+}
+
+ConditionVariable::~ConditionVariable()
+{
+#if defined(JINX_WINDOWS)
+	// Windows condition variables don't need to be destroyed
+#elif defined(JINX_MACOS) || defined(JINX_LINUX)
+	pthread_cond_destroy(reinterpret_cast<pthread_cond_t *>(&m_data));
+#else
+	assert(!"Platform-specific condition variable not defined");
+#endif
+}
+
+void ConditionVariable::wait(Mutex & mutex)
+{
+#if defined(JINX_WINDOWS)
+	SleepConditionVariableCS(reinterpret_cast<PCONDITION_VARIABLE>(&m_data), reinterpret_cast<LPCRITICAL_SECTION>(&mutex.m_data), INFINITE);
+#elif defined(JINX_MACOS) || defined(JINX_LINUX)
+	pthread_cond_wait(reinterpret_cast<pthread_cond_t *>(&m_data), reinterpret_cast<pthread_mutex_t *>(&mutex.m_data));
+#else
+	assert(!"Platform-specific condition variable not defined");
+#endif
+}
+
+void ConditionVariable::notify_all()
+{
+#if defined(JINX_WINDOWS)
+	WakeAllConditionVariable(reinterpret_cast<PCONDITION_VARIABLE>(&m_data));
+#elif defined(JINX_MACOS) || defined(JINX_LINUX)
+	pthread_cond_broadcast(reinterpret_cast<pthread_cond_t *>(&m_data));
+#else
+	assert(!"Platform-specific condition variable not defined");
+#endif
+}
+
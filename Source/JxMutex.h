@@ -12,6 +12,7 @@ Copyright (c) 2016 James Boer
 namespace Jinx
 {
 	const size_t MutexDataSize = 64;
+	const size_t ConditionVariableDataSize = 64;
 
 	// Platform-specific locking mechanism.  We don't use std::mutex because it uses new/delete internally,
 	// and we'd prefer to control all allocations.
@@ -25,9 +26,26 @@ namespace Jinx
 		void unlock();
 
 	private:
+		friend class ConditionVariable;
 		uint8_t m_data[MutexDataSize];
 	};
 
+	// Platform-specific condition variable, used with a locked Mutex for the same reason.
+	class ConditionVariable
+	{
+	public:
+		ConditionVariable();
+		~ConditionVariable();
+
+		// Atomically unlocks the mutex and waits until notified, relocking the mutex before returning.
+		// Waits can end spuriously, so callers must recheck their condition in a loop.
+		void wait(Mutex & mutex);
+		void notify_all();
+
+	private:
+		uint8_t m_data[ConditionVariableDataSize];
+	};
+
 };
 
 
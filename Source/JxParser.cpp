@@ -15,11 +15,14 @@ Parser::Parser(RuntimeIPtr runtime, const SymbolList & symbolList, const String
 	m_uniqueName(uniqueName),
 	m_symbolList(symbolList),
 	m_error(false),
-	m_breakAddress(false),
+	m_breakScopeDepth(0),
 	m_bytecode(CreateBuffer()),
 	m_writer(m_bytecode),
+	m_frameOffset(sizeof(BytecodeHeader)),
 	m_requireReturnValue(false),
-	m_returnedValue(false)
+	m_returnedValue(false),
+	m_callOffset(0),
+	m_callEndOffset(0)
 {
 	m_currentSymbol = symbolList.begin();
 	m_importList = libraries;
@@ -38,6 +41,15 @@ bool Parser::Execute()
 	// Parse script symbols into bytecode
 	ParseScript();
 
+	// Append the constant and variable name tables and update the header with their location
+	RecordFrameSlots();
+	header.tableOffset = static_cast<uint32_t>(m_writer.Tell());
+	EmitConstantTable();
+	EmitNameTable();
+	m_writer.Seek(0);
+	m_writer.Write(&header, sizeof(header));
+	m_writer.Seek(header.tableOffset);
+
 	// Return error status
 	return !m_error;
 }
@@ -56,12 +68,23 @@ bool Parser::VariableExists(const String & name) const
 void Parser::FrameBegin()
 {
 	m_variableStackFrame.FrameBegin();
+	m_frameOffset = m_writer.Tell();
 }
 
 void Parser::FrameEnd()
 {
+	RecordFrameSlots();
 	if (!m_variableStackFrame.FrameEnd())
 		Error("%", m_variableStackFrame.GetErrorMessage());
+	m_frameOffset = sizeof(BytecodeHeader);
+}
+
+void Parser::RecordFrameSlots()
+{
+	FrameSlots frameSlots;
+	frameSlots.offset = m_frameOffset;
+	frameSlots.slots = m_variableStackFrame.GetFrameSlots();
+	m_nameTable.push_back(frameSlots);
 }
 
 void Parser::ScopeBegin()
@@ -164,9 +187,30 @@ void Parser::EmitOpcode(Opcode opcode)
 	m_writer.Write<Opcode, uint8_t>(opcode);
 }
 
+void Parser::EmitSlot(const String & name)
+{
+	uint32_t slot = 0;
+	if (!m_variableStackFrame.GetVariableSlot(name, &slot))
+		Error("Unable to find variable '%s'", name.c_str());
+	m_writer.Write(slot);
+}
+
 void Parser::EmitValue(const Variant & value)
 {
-	value.Write(m_writer);
+	// Values are stored once in the constant table and referenced by index
+	uint32_t index;
+	auto itr = m_constantIndices.find(value);
+	if (itr != m_constantIndices.end())
+	{
+		index = itr->second;
+	}
+	else
+	{
+		index = static_cast<uint32_t>(m_constants.size());
+		m_constants.push_back(value);
+		m_constantIndices.insert(std::make_pair(value, index));
+	}
+	m_writer.Write(index);
 }
 
 void Parser::EmitId(RuntimeID id)
@@ -184,6 +228,30 @@ void Parser::EmitValueType(ValueType valueType)
 	m_writer.Write(ValueTypeToByte(valueType));
 }
 
+void Parser::EmitConstantTable()
+{
+	m_writer.Write(static_cast<uint32_t>(m_constants.size()));
+	for (const auto & value : m_constants)
+		value.Write(m_writer);
+}
+
+void Parser::EmitNameTable()
+{
+	// The name table maps variable names to slots for each execution frame, identified by the
+	// offset of the frame's first instruction.  It's only used to access variables by name.
+	m_writer.Write(static_cast<uint32_t>(m_nameTable.size()));
+	for (const auto & frame : m_nameTable)
+	{
+		m_writer.Write(static_cast<uint32_t>(frame.offset));
+		m_writer.Write(static_cast<uint32_t>(frame.slots.size()));
+		for (const auto & slot : frame.slots)
+		{
+			m_writer.Write(slot.first);
+			m_writer.Write(slot.second);
+		}
+	}
+}
+
 void Parser::NextSymbol()
 {
 	++m_currentSymbol;
@@ -1259,7 +1327,7 @@ void Parser::ParseFunctionDefinition(VisibilityType scope)
 	{
 		VariableAssign(itr->names.front());
 		EmitOpcode(Opcode::SetIndex);
-		EmitName(itr->names.front());
+		EmitSlot(itr->names.front());
 		EmitIndex(stackIndex);
 		EmitValueType(itr->valueType);
 		--stackIndex;
@@ -1367,8 +1435,12 @@ void Parser::ParseFunctionCall(const FunctionSignature * signature)
 	}
 
 	// When finished validating the function and pushing parameters, call the function
+	m_callOffset = m_writer.Tell();
 	EmitOpcode(Opcode::CallFunc);
 	EmitId(signature->GetId());
+	EmitCount(static_cast<uint32_t>(signature->GetParameterCount()));
+	EmitCount(signature->HasReturnParameter() ? 1 : 0);
+	m_callEndOffset = signature->HasReturnParameter() ? m_writer.Tell() : 0;
 }
 
 void Parser::ParseSubexpressionOperand(std::vector<Opcode, Allocator<Opcode>> & opcodeStack, bool suppressFunctionCall)
@@ -1408,7 +1480,7 @@ void Parser::ParseSubexpressionOperand(std::vector<Opcode, Allocator<Opcode>> &
 		String name = ParseVariable();
 		bool subscript = ParseSubscript();
 		EmitOpcode(subscript ? Opcode::PushVarKey : Opcode::PushVar);
-		EmitName(name);
+		EmitSlot(name);
 		if (Accept(SymbolType::Type))
 			EmitOpcode(Opcode::Type);
 	}
@@ -1605,7 +1677,7 @@ void Parser::ParseErase()
 			ParseSubexpression();
 			Expect(SymbolType::SquareClose);
 			Expect(SymbolType::NewLine);
-			EmitOpcode(Opcode::EraseVarElem);
+			EmitOpcode(Opcode::ErasePropElem);
 		}
 		else
 		{
@@ -1629,7 +1701,7 @@ void Parser::ParseErase()
 			Expect(SymbolType::NewLine);
 			EmitOpcode(Opcode::EraseVar);
 		}
-		EmitName(varName);
+		EmitSlot(varName);
 	}
 	else
 	{
@@ -1660,7 +1732,7 @@ void Parser::ParseIncDec()
 	{
 		varName = ParseVariable();
 		EmitOpcode(Opcode::PushVar);
-		EmitName(varName);
+		EmitSlot(varName);
 	}
 	else
 	{
@@ -1685,7 +1757,7 @@ void Parser::ParseIncDec()
 	else
 	{
 		EmitOpcode(Opcode::SetVar);
-		EmitName(varName);
+		EmitSlot(varName);
 	}
 	Expect(SymbolType::NewLine);
 }
@@ -1771,6 +1843,11 @@ void Parser::ParseIfElse()
 
 void Parser::ParseLoop()
 {
+	// Track breaks and scope depth for this loop, restoring the outer loop's values when done
+	auto breakCount = m_breakAddresses.size();
+	auto outerBreakScopeDepth = m_breakScopeDepth;
+	m_breakScopeDepth = m_variableStackFrame.GetScopeDepth();
+
 	// Check to see if we're using an explicitly named variable for the loop counter
 	String name;
 	if (CheckName())
@@ -1793,7 +1870,7 @@ void Parser::ParseLoop()
 		{
 			VariableAssign(name);
 			EmitOpcode(Opcode::SetVar);
-			EmitName(name);
+			EmitSlot(name);
 		}
 
 		// Parse to value
@@ -1854,7 +1931,7 @@ void Parser::ParseLoop()
 		{
 			VariableAssign(name);
 			EmitOpcode(Opcode::SetVar);
-			EmitName(name);
+			EmitSlot(name);
 		}
 
 		// Store where the loop logic begins
@@ -1937,12 +2014,11 @@ void Parser::ParseLoop()
 		return;
 	}
 
-	// If we used a break somewhere inside the loop, backfill the address now
-	if (m_breakAddress)
-	{
-		EmitAddressBackfill(m_breakAddress);
-		m_breakAddress = 0;
-	}
+	// If we used a break somewhere inside the loop, backfill the addresses now
+	for (auto i = breakCount; i < m_breakAddresses.size(); ++i)
+		EmitAddressBackfill(m_breakAddresses[i]);
+	m_breakAddresses.resize(breakCount);
+	m_breakScopeDepth = outerBreakScopeDepth;
 }
 
 void Parser::ParseStatement()
@@ -2049,12 +2125,12 @@ void Parser::ParseStatement()
 					ParseExpression();
 					Expect(SymbolType::NewLine);
 
-					// Assign a variable.  
-					EmitOpcode(subscript ? Opcode::SetVarKey : Opcode::SetVar);
-					EmitName(name);
-
 					// Add to variable table
 					VariableAssign(name);
+
+					// Assign a variable.  
+					EmitOpcode(subscript ? Opcode::SetVarKey : Opcode::SetVar);
+					EmitSlot(name);
 				}
 			}
 		}
@@ -2099,7 +2175,20 @@ void Parser::ParseStatement()
 					else
 						m_returnedValue = true;
 					ParseExpression();
-					EmitOpcode(Opcode::ReturnValue);
+
+					// If the returned expression ends by calling a function, the call returns its result
+					// directly, reusing this function's execution frame
+					if (m_callEndOffset == m_writer.Tell() && m_callEndOffset != 0)
+					{
+						size_t current = m_writer.Tell();
+						m_writer.Seek(m_callOffset);
+						EmitOpcode(Opcode::TailCall);
+						m_writer.Seek(current);
+					}
+					else
+					{
+						EmitOpcode(Opcode::ReturnValue);
+					}
 				}
 				else
 				{
@@ -2111,10 +2200,13 @@ void Parser::ParseStatement()
 			}
 			else if (Accept(SymbolType::Break))
 			{
-				// We've hit a break statement
+				// We've hit a break statement.  Close any scopes opened inside the loop before
+				// jumping out, since the jump skips over their regular scope end instructions.
 				Expect(SymbolType::NewLine);
+				for (auto i = m_breakScopeDepth; i < m_variableStackFrame.GetScopeDepth(); ++i)
+					EmitOpcode(Opcode::ScopeEnd);
 				EmitOpcode(Opcode::Jump);
-				m_breakAddress = EmitAddressPlaceholder();
+				m_breakAddresses.push_back(EmitAddressPlaceholder());
 			}
 			else if (Accept(SymbolType::Wait))
 			{
@@ -2152,7 +2244,18 @@ void Parser::ParseStatement()
 				}
 				else
 				{
-					Error("Unexpected symbol after wait");
+					// Timed wait statement.  The unit is a plain name rather than a keyword, so it remains
+					// usable as a variable or function name elsewhere.
+					ParseExpression();
+					if (!Check(SymbolType::NameValue) || (m_currentSymbol->text != "seconds" && m_currentSymbol->text != "second"))
+					{
+						Error("Unexpected symbol after wait");
+						return;
+					}
+					NextSymbol();
+					if (!Expect(SymbolType::NewLine))
+						return;
+					EmitOpcode(Opcode::WaitTime);
 				}
 			}
 			else if (Accept(SymbolType::External))
@@ -2278,7 +2381,7 @@ void Parser::ParseScript()
 	ParseLibraryDeclaration();
 	while (m_currentSymbol != m_symbolList.end() && !m_error)
 		ParseStatement();
-	if (m_breakAddress)
+	if (!m_breakAddresses.empty())
 		Error("Illegal break");
 	EmitOpcode(Opcode::Exit);
 }
\ No newline at end of file
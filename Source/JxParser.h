@@ -59,6 +59,9 @@ namespace Jinx
 		void FrameBegin();
 		void FrameEnd();
 
+		// Record the variable slots of the current frame for the bytecode name table
+		void RecordFrameSlots();
+
 		// Begin or end current execution scope
 		void ScopeBegin();
 		void ScopeEnd();
@@ -79,10 +82,13 @@ namespace Jinx
 		void EmitCount(uint32_t count);
 		void EmitName(const String & name); 
 		void EmitOpcode(Opcode opcode);
+		void EmitSlot(const String & name);
 		void EmitValue(const Variant & value);
 		void EmitId(RuntimeID id);
 		void EmitIndex(int32_t index);
 		void EmitValueType(ValueType type);
+		void EmitConstantTable();
+		void EmitNameTable();
 
 		// Advance to next sumbol
 		void NextSymbol();
@@ -212,8 +218,11 @@ namespace Jinx
 		// Signal an error
 		bool m_error;
 
-		// Break jump backfill address
-		size_t m_breakAddress;
+		// Break jump backfill addresses
+		std::vector<size_t, Allocator<size_t>> m_breakAddresses;
+
+		// Scope depth at the start of the innermost loop, used to close scopes on break
+		size_t m_breakScopeDepth;
 
 		// Bytecode data buffer
 		BufferPtr m_bytecode;
@@ -233,11 +242,39 @@ namespace Jinx
 		// Keep track of variables currently in scope
 		VariableStackFrame m_variableStackFrame;
 
+		// Constant values written to the bytecode constant table
+		struct ConstantLess
+		{
+			bool operator()(const Variant & left, const Variant & right) const
+			{
+				if (left.GetType() != right.GetType())
+					return left.GetType() < right.GetType();
+				return left < right;
+			}
+		};
+		std::vector<Variant, Allocator<Variant>> m_constants;
+		std::map<Variant, uint32_t, ConstantLess, Allocator<std::pair<const Variant, uint32_t>>> m_constantIndices;
+
+		// Bytecode offset of the current frame's entry point
+		size_t m_frameOffset;
+
+		// Variable names and slots for each frame, written to the bytecode name table
+		struct FrameSlots
+		{
+			size_t offset;
+			VariableStackFrame::VariableSlots slots;
+		};
+		std::vector<FrameSlots, Allocator<FrameSlots>> m_nameTable;
+
 		// We're parsing a function that requires a return value
 		bool m_requireReturnValue;
 
 		// Validate that we've returned a value
 		bool m_returnedValue;
+
+		// Bytecode offsets of the last function call instruction and the end of its operands, if it returns a value
+		size_t m_callOffset;
+		size_t m_callEndOffset;
 	};
 
 };
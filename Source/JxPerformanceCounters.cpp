@@ -0,0 +1,99 @@
+/*
+The Jinx library is distributed under the MIT License (MIT)
+https://opensource.org/licenses/MIT
+See LICENSE.TXT or Jinx.h for license details.
+Copyright (c) 2016 James Boer
+*/
+
+#include "JxInternal.h"
+
+using namespace Jinx;
+
+
+thread_local PerformanceCounters::CacheEntry PerformanceCounters::s_cache[PerformanceCounters::CacheSize];
+std::atomic<uint64_t> PerformanceCounters::s_nextId(1);
+
+PerformanceCounters::PerformanceCounters() :
+	m_id(s_nextId++),
+	m_blocks(nullptr)
+{
+}
+
+PerformanceCounters::~PerformanceCounters()
+{
+	while (m_blocks)
+	{
+		Block * next = m_blocks->next;
+		JinxDelete(m_blocks);
+		m_blocks = next;
+	}
+}
+
+void PerformanceCounters::Add(const PerformanceStats & stats)
+{
+	Block * block = GetBlock();
+	Add(block, CompilationTimeNs, stats.compilationTimeNs);
+	Add(block, ExecutionTimeNs, stats.executionTimeNs);
+	Add(block, ScriptCompilationCount, stats.scriptCompilationCount);
+	Add(block, ScriptExecutionCount, stats.scriptExecutionCount);
+	Add(block, InstructionCount, stats.instructionCount);
+	Add(block, FunctionCallCount, stats.functionCallCount);
+	Add(block, NativeCallCount, stats.nativeCallCount);
+	Add(block, AllocationCount, stats.allocationCount);
+}
+
+PerformanceStats PerformanceCounters::Collect(bool reset)
+{
+	uint64_t totals[NumCounters] = {};
+	{
+		std::lock_guard<Mutex> lock(m_mutex);
+		for (Block * block = m_blocks; block; block = block->next)
+		{
+			for (size_t i = 0; i < NumCounters; ++i)
+			{
+				uint64_t count = block->counters[i].load(std::memory_order_relaxed);
+				totals[i] += count - block->baselines[i];
+				if (reset)
+					block->baselines[i] = count;
+			}
+		}
+	}
+	PerformanceStats stats;
+	stats.compilationTimeNs = totals[CompilationTimeNs];
+	stats.executionTimeNs = totals[ExecutionTimeNs];
+	stats.scriptCompilationCount = static_cast<uint32_t>(totals[ScriptCompilationCount]);
+	stats.scriptExecutionCount = static_cast<uint32_t>(totals[ScriptExecutionCount]);
+	stats.instructionCount = totals[InstructionCount];
+	stats.functionCallCount = totals[FunctionCallCount];
+	stats.nativeCallCount = totals[NativeCallCount];
+	stats.allocationCount = totals[AllocationCount];
+	return stats;
+}
+
+PerformanceCounters::Block * PerformanceCounters::FindBlock()
+{
+	// Threads find or add their block once per runtime, unless it's evicted from their cache
+	auto thread = std::this_thread::get_id();
+	std::lock_guard<Mutex> lock(m_mutex);
+	for (Block * block = m_blocks; block; block = block->next)
+	{
+		if (block->thread == thread)
+			return block;
+	}
+	Block * block = new (JinxAlloc(sizeof(Block))) Block();
+	block->thread = thread;
+	block->next = m_blocks;
+	m_blocks = block;
+	return block;
+}
+
+PerformanceCounters::Block * PerformanceCounters::GetBlock()
+{
+	auto & entry = s_cache[m_id % CacheSize];
+	if (entry.id != m_id)
+	{
+		entry.block = FindBlock();
+		entry.id = m_id;
+	}
+	return entry.block;
+}
@@ -0,0 +1,89 @@
+/*
+The Jinx library is distributed under the MIT License (MIT)
+https://opensource.org/licenses/MIT
+See LICENSE.TXT or Jinx.h for license details.
+Copyright (c) 2016 James Boer
+*/
+
+#pragma once
+#ifndef JX_PERFORMANCE_COUNTERS_H__
+#define JX_PERFORMANCE_COUNTERS_H__
+
+
+namespace Jinx
+{
+
+	// A runtime's performance counters.  Each thread adds to its own block of counters without locking
+	// or atomic read-modify-write operations, so threads executing scripts in parallel aren't serialized
+	// by telemetry.  Blocks are only summed when stats are collected, and resetting records each block's
+	// current totals as a baseline, so no thread ever writes to another thread's counters.
+	class PerformanceCounters
+	{
+	public:
+		// To add a counter, add it here and to PerformanceStats, and map the two in Add() and Collect()
+		enum Counter
+		{
+			CompilationTimeNs,
+			ExecutionTimeNs,
+			ScriptCompilationCount,
+			ScriptExecutionCount,
+			InstructionCount,
+			FunctionCallCount,
+			NativeCallCount,
+			AllocationCount,
+			NumCounters,
+		};
+
+		PerformanceCounters();
+		~PerformanceCounters();
+
+		// Add to the calling thread's counters
+		void Add(const PerformanceStats & stats);
+		void Add(Counter counter, uint64_t value) { Add(GetBlock(), counter, value); }
+
+		// Sum all threads' counters, optionally resetting them
+		PerformanceStats Collect(bool reset);
+
+	private:
+
+		struct Block
+		{
+			std::thread::id thread;
+			Block * next;
+			std::atomic<uint64_t> counters[NumCounters];
+			// Totals at the last reset, guarded by the mutex
+			uint64_t baselines[NumCounters];
+			// Keep other threads' blocks off this block's cache lines
+			uint8_t padding[64];
+		};
+
+		// Recently used blocks, cached by each thread.  Runtime IDs are never reused, so entries left
+		// by destroyed runtimes never match.
+		struct CacheEntry
+		{
+			uint64_t id;
+			Block * block;
+		};
+		static const size_t CacheSize = 4;
+
+		// Only the owning thread writes to a block, so a relaxed load and store is enough to add to it
+		static void Add(Block * block, Counter counter, uint64_t value)
+		{
+			auto & count = block->counters[counter];
+			count.store(count.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+		}
+
+		Block * GetBlock();
+		Block * FindBlock();
+
+		static thread_local CacheEntry s_cache[CacheSize];
+		static std::atomic<uint64_t> s_nextId;
+
+		const uint64_t m_id;
+		Mutex m_mutex;
+		Block * m_blocks;
+	};
+
+};
+
+#endif // JX_PERFORMANCE_COUNTERS_H__
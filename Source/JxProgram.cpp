@@ -0,0 +1,717 @@
+/*
+The Jinx library is distributed under the MIT License (MIT)
+https://opensource.org/licenses/MIT
+See LICENSE.TXT or Jinx.h for license details.
+Copyright (c) 2016 James Boer
+*/
+
+#include "JxInternal.h"
+
+using namespace Jinx;
+
+
+// Scope opened by ScopeBegin, restored by the matching ScopeEnd
+struct VerifyScope
+{
+	uint32_t depth;
+	uint32_t declaredCount;
+};
+
+// Minimum stack depth, open scopes, and declared variable slots before executing an instruction, relative to its
+// execution frame.  Paths such as loop exits can reach the same instruction with different stack depths and with
+// different variables declared, so merged states keep the smaller depths and all variables declared by any path.
+// Depths remain lower bounds, since assigning a variable declared by only some paths is counted as a pop.
+struct VerifyState
+{
+	VerifyState(uint32_t d, bool f) : depth(d), function(f) {}
+
+	// Merge the state of another path reaching the same instruction.  Returns false if the paths have
+	// different scopes or declaration orders.
+	bool Merge(const VerifyState & other, bool * changed)
+	{
+		if (function != other.function || scopes.size() != other.scopes.size())
+			return false;
+		*changed = false;
+		if (other.depth < depth)
+		{
+			depth = other.depth;
+			*changed = true;
+		}
+		for (size_t i = 0; i < scopes.size(); ++i)
+		{
+			if (other.scopes[i].declaredCount != scopes[i].declaredCount)
+				return false;
+			if (other.scopes[i].depth < scopes[i].depth)
+			{
+				scopes[i].depth = other.scopes[i].depth;
+				*changed = true;
+			}
+		}
+		if (!std::equal(declared.begin(), declared.begin() + std::min(declared.size(), other.declared.size()), other.declared.begin()))
+			return false;
+		if (other.declared.size() > declared.size())
+		{
+			declared = other.declared;
+			*changed = true;
+		}
+		return true;
+	}
+
+	// Is the variable slot declared by any path reaching this instruction?
+	bool IsDeclared(uint32_t slot) const
+	{
+		return std::find(declared.begin(), declared.end(), slot) != declared.end();
+	}
+
+	uint32_t depth;
+	bool function;
+	std::vector<VerifyScope, Allocator<VerifyScope>> scopes;
+	std::vector<uint32_t, Allocator<uint32_t>> declared;
+};
+
+Program::Program(BufferPtr bytecode, const void * const * dispatchTable, const void * const * verifiedDispatchTable) :
+	m_bytecode(bytecode),
+	m_valid(false),
+	m_verified(false),
+	m_nameTablesLoaded(false),
+	m_nameTableOffset(0)
+{
+	if (!m_bytecode || m_bytecode->Size() < sizeof(BytecodeHeader))
+		return;
+
+	// Read bytecode header
+	BytecodeHeader header;
+	BinaryReader reader(m_bytecode);
+	reader.Read(&header, sizeof(header));
+	if (header.signature != BytecodeSignature || header.majorVer != BytecodeMajorVersion || header.minorVer != BytecodeMinorVersion)
+		return;
+	if (header.tableOffset < sizeof(BytecodeHeader) || header.tableOffset >= m_bytecode->Size())
+		return;
+
+	// Decode the constant table
+	reader.Seek(header.tableOffset);
+	uint32_t constantCount = 0;
+	reader.Read(&constantCount);
+	m_constants.reserve(constantCount);
+	for (uint32_t i = 0; i < constantCount; ++i)
+	{
+		Variant value;
+		value.Read(reader);
+		m_constants.push_back(value);
+	}
+
+	// The name table follows the constant table
+	m_nameTableOffset = reader.Tell();
+
+	// Decode the executable bytecode between the header and the tables
+	reader.Seek(sizeof(BytecodeHeader));
+	m_valid = Decode(reader, header.tableOffset);
+	if (!m_valid)
+		return;
+
+	// Verified bytecode is executed by an interpreter that skips per-instruction checks
+	m_verified = Verify();
+	assert(!dispatchTable == !verifiedDispatchTable);
+	if (dispatchTable)
+		Thread(m_verified ? verifiedDispatchTable : dispatchTable);
+}
+
+bool Program::Decode(BinaryReader & reader, size_t tableOffset)
+{
+	m_instructions.reserve((tableOffset - sizeof(BytecodeHeader)) / 4);
+	m_offsets.reserve(m_instructions.capacity());
+	uint32_t callSiteCount = 0;
+	uint32_t propertySiteCount = 0;
+	std::vector<std::pair<uint32_t, uint32_t>, Allocator<std::pair<uint32_t, uint32_t>>> callCounts;
+	while (reader.Tell() < tableOffset)
+	{
+		m_offsets.push_back(reader.Tell());
+
+		// Read opcode instruction
+		uint8_t opByte;
+		reader.Read(&opByte);
+		if (opByte >= static_cast<uint32_t>(Opcode::NumOpcodes))
+		{
+			LogWriteLine("Invalid operation in bytecode");
+			return false;
+		}
+		Instruction inst;
+		inst.opcode = static_cast<Opcode>(opByte);
+
+		// Read opcode operands
+		switch (inst.opcode)
+		{
+			case Opcode::CallFunc:
+			case Opcode::TailCall:
+			{
+				// Tail calls return the called function's result
+				reader.Read(&inst.id);
+				uint32_t parameterCount;
+				reader.Read(&parameterCount);
+				uint32_t returnCount;
+				reader.Read(&returnCount);
+				if (returnCount > 1 || (inst.opcode == Opcode::TailCall && returnCount != 1))
+				{
+					LogWriteLine("Invalid function call in bytecode");
+					return false;
+				}
+				callCounts.push_back(std::make_pair(parameterCount, returnCount));
+				inst.operand = callSiteCount++;
+			}
+			break;
+			case Opcode::EraseProp:
+			case Opcode::ErasePropElem:
+			case Opcode::PushProp:
+			case Opcode::PushPropKeyVal:
+			case Opcode::SetProp:
+			case Opcode::SetPropKeyVal:
+			{
+				reader.Read(&inst.id);
+				inst.operand = propertySiteCount++;
+			}
+			break;
+			case Opcode::Cast:
+			{
+				uint8_t b;
+				reader.Read(&b);
+				if (b > static_cast<uint8_t>(ValueType::NumValueTypes))
+				{
+					LogWriteLine("Invalid value type in bytecode");
+					return false;
+				}
+				inst.type = ByteToValueType(b);
+			}
+			break;
+			case Opcode::Function:
+			{
+				FunctionSignature signature;
+				signature.Read(reader);
+				inst.operand = static_cast<uint32_t>(m_signatures.size());
+				inst.id = signature.GetId();
+				m_signatures.push_back(signature);
+			}
+			break;
+			case Opcode::Library:
+			{
+				String name;
+				reader.Read(&name);
+				inst.operand = static_cast<uint32_t>(m_libraryNames.size());
+				m_libraryNames.push_back(name);
+			}
+			break;
+			case Opcode::Property:
+			{
+				PropertyName propertyName;
+				propertyName.Read(reader);
+				inst.operand = static_cast<uint32_t>(m_propertyNames.size());
+				inst.id = propertyName.GetId();
+				m_propertyNames.push_back(propertyName);
+			}
+			break;
+			case Opcode::EraseVar:
+			case Opcode::EraseVarElem:
+			case Opcode::Jump:
+			case Opcode::JumpFalse:
+			case Opcode::JumpTrue:
+			case Opcode::PopCount:
+			case Opcode::PushColl:
+			case Opcode::PushList:
+			case Opcode::PushVar:
+			case Opcode::PushVarKey:
+			case Opcode::SetVar:
+			case Opcode::SetVarKey:
+			{
+				reader.Read(&inst.operand);
+			}
+			break;
+			case Opcode::PushVal:
+			{
+				reader.Read(&inst.operand);
+				if (inst.operand >= m_constants.size())
+				{
+					LogWriteLine("Invalid constant index in bytecode");
+					return false;
+				}
+			}
+			break;
+			case Opcode::SetIndex:
+			{
+				reader.Read(&inst.operand);
+				reader.Read(&inst.index);
+				uint8_t b;
+				reader.Read(&b);
+				if (b > static_cast<uint8_t>(ValueType::NumValueTypes))
+				{
+					LogWriteLine("Invalid value type in bytecode");
+					return false;
+				}
+				inst.type = ByteToValueType(b);
+			}
+			break;
+			default:
+			{
+			}
+			break;
+		}
+		m_instructions.push_back(inst);
+	}
+
+	// Bytecode must end by exiting, so execution can never run past the last instruction
+	if (m_instructions.empty() || m_instructions.back().opcode != Opcode::Exit)
+	{
+		LogWriteLine("Bytecode must end with an exit instruction");
+		return false;
+	}
+
+	// Allocate a function cache for each call site
+	std::vector<CallSite, Allocator<CallSite>> callSites(callSiteCount);
+	m_callSites.swap(callSites);
+	for (uint32_t i = 0; i < callSiteCount; ++i)
+	{
+		m_callSites[i].parameterCount = callCounts[i].first;
+		m_callSites[i].returnCount = callCounts[i].second;
+	}
+
+	// Allocate a property slot cache for each property access
+	std::vector<PropertySite, Allocator<PropertySite>> propertySites(propertySiteCount);
+	m_propertySites.swap(propertySites);
+
+	// Convert jump targets from bytecode offsets to instruction indices
+	for (auto & inst : m_instructions)
+	{
+		if (inst.opcode == Opcode::Jump || inst.opcode == Opcode::JumpFalse || inst.opcode == Opcode::JumpTrue)
+		{
+			if (!FindInstruction(inst.operand, &inst.operand))
+			{
+				LogWriteLine("Invalid jump target in bytecode");
+				return false;
+			}
+		}
+	}
+	FindWaitConditions();
+	return true;
+}
+
+void Program::FindWaitConditions()
+{
+	// Conditional waits are compiled as a condition expression, a conditional jump past the wait, the
+	// wait, and a jump back to the condition.  If the condition only reads properties, variables, and
+	// constants, the wait instruction is marked with the condition's range, so a waiting script can be
+	// suspended until a value the condition reads is changed.
+	const uint32_t count = static_cast<uint32_t>(m_instructions.size());
+	for (uint32_t i = 1; i + 1 < count; ++i)
+	{
+		auto & wait = m_instructions[i];
+		const auto & condJump = m_instructions[i - 1];
+		const auto & loopJump = m_instructions[i + 1];
+		if (wait.opcode != Opcode::Wait || loopJump.opcode != Opcode::Jump ||
+			(condJump.opcode != Opcode::JumpFalse && condJump.opcode != Opcode::JumpTrue) ||
+			condJump.operand != i + 2 || loopJump.operand >= i - 1)
+			continue;
+		bool pure = true;
+		for (uint32_t j = loopJump.operand; j < i - 1 && pure; ++j)
+		{
+			switch (m_instructions[j].opcode)
+			{
+				case Opcode::Add:
+				case Opcode::And:
+				case Opcode::Cast:
+				case Opcode::Divide:
+				case Opcode::Equals:
+				case Opcode::Greater:
+				case Opcode::GreaterEq:
+				case Opcode::Less:
+				case Opcode::LessEq:
+				case Opcode::Mod:
+				case Opcode::Multiply:
+				case Opcode::Not:
+				case Opcode::NotEquals:
+				case Opcode::Or:
+				case Opcode::PushProp:
+				case Opcode::PushVal:
+				case Opcode::PushVar:
+				case Opcode::Subtract:
+				case Opcode::Type:
+					break;
+				default:
+					pure = false;
+					break;
+			};
+		}
+		if (!pure)
+			continue;
+		wait.operand = loopJump.operand;
+		wait.index = static_cast<int32_t>(i - 1 - loopJump.operand);
+	}
+}
+
+bool Program::Verify() const
+{
+	// Execution is followed from the root frame and from each function's entry point.  The state at each
+	// branch target is merged with the state of every path reaching it, and followed again if it changes.
+	const size_t count = m_instructions.size();
+	std::vector<bool, Allocator<bool>> isTarget(count, false);
+	for (const auto & inst : m_instructions)
+	{
+		if (inst.opcode == Opcode::Jump || inst.opcode == Opcode::JumpFalse || inst.opcode == Opcode::JumpTrue)
+			isTarget[inst.operand] = true;
+	}
+	isTarget[0] = true;
+	std::map<size_t, VerifyState, std::less<size_t>, Allocator<std::pair<const size_t, VerifyState>>> targetStates;
+	std::vector<std::pair<size_t, VerifyState>, Allocator<std::pair<size_t, VerifyState>>> pending;
+	pending.push_back(std::make_pair(0, VerifyState(0, false)));
+	while (!pending.empty())
+	{
+		size_t i = pending.back().first;
+		VerifyState state = std::move(pending.back().second);
+		pending.pop_back();
+		for (bool end = false; !end; ++i)
+		{
+			if (i >= count)
+				return false;
+			if (isTarget[i])
+			{
+				auto itr = targetStates.find(i);
+				if (itr != targetStates.end())
+				{
+					bool changed;
+					if (!itr->second.Merge(state, &changed))
+						return false;
+					if (!changed)
+						break;
+					state = itr->second;
+				}
+				else
+				{
+					targetStates.insert(std::make_pair(i, state));
+				}
+			}
+
+			// Determine how many values the instruction requires, pops, and pushes
+			const auto & inst = m_instructions[i];
+			uint32_t required = 0;
+			uint32_t pops = 0;
+			uint32_t pushes = 0;
+			switch (inst.opcode)
+			{
+				case Opcode::Add:
+				case Opcode::And:
+				case Opcode::Decrement:
+				case Opcode::Divide:
+				case Opcode::Equals:
+				case Opcode::Greater:
+				case Opcode::GreaterEq:
+				case Opcode::Increment:
+				case Opcode::Less:
+				case Opcode::LessEq:
+				case Opcode::Mod:
+				case Opcode::Multiply:
+				case Opcode::NotEquals:
+				case Opcode::Or:
+				case Opcode::Subtract:
+				{
+					required = 2;
+					pops = 2;
+					pushes = 1;
+				}
+				break;
+				case Opcode::Cast:
+				case Opcode::Not:
+				case Opcode::PushPropKeyVal:
+				case Opcode::PushVarKey:
+				case Opcode::Type:
+				{
+					required = 1;
+				}
+				break;
+				case Opcode::CallFunc:
+				{
+					const CallSite & callSite = GetCallSite(inst.operand);
+					required = callSite.parameterCount;
+					pops = callSite.parameterCount;
+					pushes = callSite.returnCount;
+				}
+				break;
+				case Opcode::EraseProp:
+				case Opcode::EraseVar:
+				case Opcode::Library:
+				case Opcode::Property:
+				case Opcode::Wait:
+				{
+				}
+				break;
+				case Opcode::ErasePropElem:
+				case Opcode::EraseVarElem:
+				case Opcode::Pop:
+				case Opcode::SetProp:
+				case Opcode::WaitTime:
+				{
+					required = 1;
+					pops = 1;
+				}
+				break;
+				case Opcode::Exit:
+				{
+					end = true;
+				}
+				break;
+				case Opcode::Function:
+				{
+					// The function body begins after the jump instruction following this one
+					size_t entry = i + 2;
+					if (entry >= count)
+						return false;
+					isTarget[entry] = true;
+					uint32_t parameterCount = static_cast<uint32_t>(GetSignature(inst.operand).GetParameterCount());
+					pending.push_back(std::make_pair(entry, VerifyState(parameterCount, true)));
+				}
+				break;
+				case Opcode::Jump:
+				{
+					pending.push_back(std::make_pair(inst.operand, state));
+					end = true;
+				}
+				break;
+				case Opcode::JumpFalse:
+				case Opcode::JumpTrue:
+				{
+					required = 1;
+					pops = 1;
+					if (state.depth < required)
+						return false;
+					VerifyState branchState = state;
+					branchState.depth -= pops;
+					pending.push_back(std::make_pair(inst.operand, std::move(branchState)));
+				}
+				break;
+				case Opcode::LoopCount:
+				{
+					required = 3;
+					pushes = 1;
+				}
+				break;
+				case Opcode::LoopOver:
+				{
+					required = 2;
+					pushes = 1;
+				}
+				break;
+				case Opcode::PopCount:
+				{
+					required = inst.operand;
+					pops = inst.operand;
+				}
+				break;
+				case Opcode::PushColl:
+				{
+					if (inst.operand > UINT32_MAX / 2)
+						return false;
+					required = inst.operand * 2;
+					pops = inst.operand * 2;
+					pushes = 1;
+				}
+				break;
+				case Opcode::PushItr:
+				case Opcode::PushTop:
+				{
+					required = 1;
+					pushes = 1;
+				}
+				break;
+				case Opcode::PushList:
+				{
+					required = inst.operand;
+					pops = inst.operand;
+					pushes = 1;
+				}
+				break;
+				case Opcode::PushProp:
+				case Opcode::PushVal:
+				case Opcode::PushVar:
+				{
+					pushes = 1;
+				}
+				break;
+				case Opcode::Return:
+				{
+					if (!state.function)
+						return false;
+					end = true;
+				}
+				break;
+				case Opcode::ReturnValue:
+				{
+					if (!state.function)
+						return false;
+					required = 1;
+					end = true;
+				}
+				break;
+				case Opcode::TailCall:
+				{
+					if (!state.function)
+						return false;
+					required = GetCallSite(inst.operand).parameterCount;
+					end = true;
+				}
+				break;
+				case Opcode::ScopeBegin:
+				{
+					VerifyScope scope;
+					scope.depth = state.depth;
+					scope.declaredCount = static_cast<uint32_t>(state.declared.size());
+					state.scopes.push_back(scope);
+				}
+				break;
+				case Opcode::ScopeEnd:
+				{
+					if (state.scopes.empty() || state.depth < state.scopes.back().depth)
+						return false;
+					state.depth = state.scopes.back().depth;
+					state.declared.resize(state.scopes.back().declaredCount);
+					state.scopes.pop_back();
+				}
+				break;
+				case Opcode::SetIndex:
+				{
+					// Parameters are assigned to values already on the stack
+					if (inst.index >= 0)
+						return false;
+					required = static_cast<uint32_t>(-static_cast<int64_t>(inst.index));
+					if (!state.IsDeclared(inst.operand))
+						state.declared.push_back(inst.operand);
+				}
+				break;
+				case Opcode::SetPropKeyVal:
+				case Opcode::SetVarKey:
+				{
+					required = 2;
+					pops = 2;
+				}
+				break;
+				case Opcode::SetVar:
+				{
+					// Assigning an undeclared variable leaves the value on the stack as the new variable
+					required = 1;
+					if (state.IsDeclared(inst.operand))
+						pops = 1;
+					else
+						state.declared.push_back(inst.operand);
+				}
+				break;
+				default:
+				{
+					return false;
+				}
+			}
+			if (state.depth < required)
+				return false;
+			state.depth = state.depth - pops + pushes;
+		}
+	}
+	return true;
+}
+
+void Program::Thread(const void * const * dispatchTable)
+{
+	for (auto & inst : m_instructions)
+		inst.handler.store(dispatchTable[static_cast<size_t>(inst.opcode)], std::memory_order_relaxed);
+
+	// Fuse common instruction sequences into superinstructions
+	Fuse(dispatchTable);
+}
+
+static inline bool IsComparison(Opcode opcode)
+{
+	switch (opcode)
+	{
+		case Opcode::Equals:
+		case Opcode::Greater:
+		case Opcode::GreaterEq:
+		case Opcode::Less:
+		case Opcode::LessEq:
+		case Opcode::NotEquals:
+			return true;
+		default:
+			return false;
+	}
+}
+
+void Program::Fuse(const void * const * dispatchTable)
+{
+	// Fused handlers read the operands of the instructions following the first one in the sequence
+	const size_t count = m_instructions.size();
+	for (size_t i = 0; i < count; ++i)
+	{
+		auto & inst = m_instructions[i];
+		const Instruction * next = &inst + 1;
+		const size_t remaining = count - i - 1;
+		FusedOpcode fused;
+		if (inst.opcode == Opcode::PushVal && remaining >= 1 && next[0].opcode == Opcode::SetVar)
+		{
+			fused = FusedOpcode::SetVarFromVal;
+		}
+		else if (inst.opcode == Opcode::PushVar && remaining >= 3 && (next[0].opcode == Opcode::PushVar || next[0].opcode == Opcode::PushVal) &&
+			IsComparison(next[1].opcode) && (next[2].opcode == Opcode::JumpFalse || next[2].opcode == Opcode::JumpTrue))
+		{
+			fused = next[0].opcode == Opcode::PushVar ? FusedOpcode::CompareVarVarJump : FusedOpcode::CompareVarValJump;
+		}
+		else if (inst.opcode == Opcode::PushVar && remaining >= 3 && next[0].opcode == Opcode::PushVal &&
+			(next[1].opcode == Opcode::Add || next[1].opcode == Opcode::Increment) &&
+			next[2].opcode == Opcode::SetVar && next[2].operand == inst.operand)
+		{
+			fused = FusedOpcode::IncVarByConst;
+		}
+		else
+		{
+			continue;
+		}
+		inst.handler.store(dispatchTable[static_cast<size_t>(fused)], std::memory_order_relaxed);
+	}
+}
+
+bool Program::FindInstruction(size_t offset, uint32_t * index) const
+{
+	auto itr = std::lower_bound(m_offsets.begin(), m_offsets.end(), offset);
+	if (itr == m_offsets.end() || *itr != offset)
+		return false;
+	*index = static_cast<uint32_t>(itr - m_offsets.begin());
+	return true;
+}
+
+const Program::NameSlotMap & Program::GetNameTable(size_t entry) const
+{
+	std::lock_guard<Mutex> lock(m_nameTableMutex);
+	if (!m_nameTablesLoaded && m_valid)
+	{
+		BinaryReader reader(m_bytecode);
+		reader.Seek(m_nameTableOffset);
+		uint32_t frameCount = 0;
+		reader.Read(&frameCount);
+		for (uint32_t i = 0; i < frameCount; ++i)
+		{
+			uint32_t frameOffset;
+			reader.Read(&frameOffset);
+			uint32_t slotCount;
+			reader.Read(&slotCount);
+			NameSlotMap nameTable;
+			for (uint32_t j = 0; j < slotCount; ++j)
+			{
+				String name;
+				reader.Read(&name);
+				uint32_t slot;
+				reader.Read(&slot);
+				nameTable.insert(std::make_pair(name, slot));
+			}
+
+			// Frames are identified by the index of their first instruction
+			uint32_t frameEntry;
+			if (FindInstruction(frameOffset, &frameEntry))
+				m_nameTables[frameEntry] = nameTable;
+		}
+		m_nameTablesLoaded = true;
+	}
+
+	// Table entries are never removed, so references remain valid after releasing the lock
+	return m_nameTables[entry];
+}
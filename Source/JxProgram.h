@@ -0,0 +1,176 @@
+/*
+The Jinx library is distributed under the MIT License (MIT)
+https://opensource.org/licenses/MIT
+See LICENSE.TXT or Jinx.h for license details.
+Copyright (c) 2016 James Boer
+*/
+
+#pragma once
+#ifndef JX_PROGRAM_H__
+#define JX_PROGRAM_H__
+
+
+namespace Jinx
+{
+
+	class FunctionDefinition;
+
+	// Function resolved by a call site, reused while its generation matches the runtime's function generation
+	struct CallSite
+	{
+		CallSite() : function(nullptr), generation(0), parameterCount(0), returnCount(0) {}
+		std::atomic<const FunctionDefinition *> function;
+		std::atomic<uint32_t> generation;
+
+		// Number of values popped and pushed by the called function, as encoded in the bytecode
+		uint32_t parameterCount;
+		uint32_t returnCount;
+	};
+
+	// Property slot cache for an instruction accessing a property
+	struct PropertySite
+	{
+		PropertySite() : property(nullptr) {}
+		std::atomic<PropertySlot *> property;
+	};
+
+	// Superinstructions, each executing a common instruction sequence with a single dispatch.  The
+	// sequence's first instruction is rewritten to use the fused handler, but keeps its opcode and
+	// operands, and the remaining instructions are left in place.  Jumps into the middle of a
+	// sequence still work, and the interpreter can fall back to executing the original instructions.
+	enum class FusedOpcode
+	{
+		CompareVarValJump = static_cast<int>(Opcode::NumOpcodes),
+		CompareVarVarJump,
+		IncVarByConst,
+		SetVarFromVal,
+		NumFusedOpcodes,
+	};
+
+	// Pre-decoded instruction.  Operands are read from the bytecode once when the program is
+	// loaded, so the interpreter never has to parse the bytecode stream while executing.
+	struct Instruction
+	{
+		Instruction() : handler(nullptr), opcode(Opcode::Exit), type(ValueType::Null), operand(0), index(0), id(0) {}
+		Instruction(const Instruction & other) :
+			handler(other.handler.load(std::memory_order_relaxed)),
+			opcode(other.opcode),
+			type(other.type),
+			operand(other.operand),
+			index(other.index),
+			id(other.id)
+		{}
+
+		// Interpreter dispatch target for this instruction.  The interpreter may replace it with a
+		// handler specialized for observed operand types while other scripts are executing it.
+		mutable std::atomic<const void *> handler;
+
+		Opcode opcode;
+
+		// Value type used by Cast and SetIndex
+		ValueType type;
+
+		// Slot, count, constant index, instruction index, call or property site index, or table index, depending on opcode
+		uint32_t operand;
+
+		// Relative stack index used by SetIndex, or length of the condition preceding a conditional Wait
+		int32_t index;
+
+		// Function or property id
+		RuntimeID id;
+	};
+
+	static_assert(sizeof(Instruction) == 32, "Instruction should fit evenly in a cache line");
+
+	// Bytecode loaded for execution.  The bytecode and the tables following it are decoded once
+	// when the program is loaded, and are shared by all scripts and functions using it.
+	class Program
+	{
+	public:
+		typedef std::multimap<String, uint32_t, std::less<String>, Allocator<std::pair<const String, uint32_t>>> NameSlotMap;
+
+		// If dispatch tables are passed, each instruction's handler is initialized to the table entry for its
+		// opcode, and common instruction sequences are fused using the table entries for fused opcodes.  The
+		// verified table is used instead if the bytecode passes verification.
+		Program(BufferPtr bytecode, const void * const * dispatchTable = nullptr, const void * const * verifiedDispatchTable = nullptr);
+
+		// Is this valid bytecode?
+		bool IsValid() const { return m_valid; }
+
+		// Has the bytecode been verified to never underflow the stack, so it can execute without per-instruction checks?
+		bool IsVerified() const { return m_verified; }
+
+		// Get the bytecode buffer
+		const BufferPtr & GetBytecode() const { return m_bytecode; }
+
+		// Get decoded instructions.  The root frame begins at instruction zero.
+		inline const Instruction * GetInstructions() const { return m_instructions.data(); }
+		inline size_t GetInstructionCount() const { return m_instructions.size(); }
+
+		// Get a constant value by index
+		inline const Variant & GetConstant(uint32_t index) const { return m_constants[index]; }
+
+		// Get decoded function signatures, property names, and library names by instruction operand
+		inline const FunctionSignature & GetSignature(uint32_t index) const { return m_signatures[index]; }
+		inline const PropertyName & GetPropertyName(uint32_t index) const { return m_propertyNames[index]; }
+		inline const String & GetLibraryName(uint32_t index) const { return m_libraryNames[index]; }
+
+		// Get the function cache for a call site.  Call sites are shared by all scripts running the program.
+		inline CallSite & GetCallSite(uint32_t index) const { return m_callSites[index]; }
+
+		// Get the slot cache for a property access.  Property sites are shared by all scripts running the program.
+		inline PropertySite & GetPropertySite(uint32_t index) const { return m_propertySites[index]; }
+
+		// Get the variable name table for the frame beginning at the specified instruction index
+		const NameSlotMap & GetNameTable(size_t entry) const;
+
+	private:
+
+		typedef std::map<size_t, NameSlotMap, std::less<size_t>, Allocator<std::pair<const size_t, NameSlotMap>>> NameTableMap;
+
+		bool Decode(BinaryReader & reader, size_t tableOffset);
+		bool FindInstruction(size_t offset, uint32_t * index) const;
+		void FindWaitConditions();
+		bool Verify() const;
+		void Thread(const void * const * dispatchTable);
+		void Fuse(const void * const * dispatchTable);
+
+		// Bytecode buffer
+		BufferPtr m_bytecode;
+
+		// Is the bytecode valid?
+		bool m_valid;
+
+		// Is the bytecode verified?
+		bool m_verified;
+
+		// Decoded instructions, and the bytecode offset each was decoded from
+		std::vector<Instruction, Allocator<Instruction>> m_instructions;
+		std::vector<size_t, Allocator<size_t>> m_offsets;
+
+		// Constant values referenced by index from the bytecode
+		std::vector<Variant, Allocator<Variant>> m_constants;
+
+		// Variable-length operands referenced by index from instructions
+		std::vector<FunctionSignature, Allocator<FunctionSignature>> m_signatures;
+		std::vector<PropertyName, Allocator<PropertyName>> m_propertyNames;
+		std::vector<String, Allocator<String>> m_libraryNames;
+
+		// Resolved function caches, indexed by CallFunc and TailCall instruction operand
+		mutable std::vector<CallSite, Allocator<CallSite>> m_callSites;
+
+		// Resolved property slot caches, indexed by property access instruction operand
+		mutable std::vector<PropertySite, Allocator<PropertySite>> m_propertySites;
+
+		// Name tables are only needed for access by name, so they're built on first request
+		mutable Mutex m_nameTableMutex;
+		mutable NameTableMap m_nameTables;
+		mutable bool m_nameTablesLoaded;
+		size_t m_nameTableOffset;
+	};
+
+	typedef std::shared_ptr<Program> ProgramPtr;
+
+};
+
+#endif // JX_PROGRAM_H__
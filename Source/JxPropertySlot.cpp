@@ -0,0 +1,168 @@
+/*
+The Jinx library is distributed under the MIT License (MIT)
+https://opensource.org/licenses/MIT
+See LICENSE.TXT or Jinx.h for license details.
+Copyright (c) 2016 James Boer
+*/
+
+#include "JxInternal.h"
+
+using namespace Jinx;
+
+
+const size_t PropertySlot::MinWaiterPruneSize;
+
+PropertySlot::PropertySlot(const Variant & value) :
+	m_value(value),
+	m_sequence(0),
+	m_type(ValueType::Null),
+	m_scalarBits(0),
+	m_waiterPruneSize(MinWaiterPruneSize)
+{
+	Publish();
+}
+
+void PropertySlot::AddWaiter(const std::weak_ptr<Script> & script, uint32_t waitGeneration)
+{
+	std::lock_guard<Mutex> lock(m_mutex);
+
+	// Remove waiters which have been released, or have armed a newer wait since registering
+	if (m_waiters.size() >= m_waiterPruneSize)
+	{
+		auto itr = std::remove_if(m_waiters.begin(), m_waiters.end(), [](const Waiter & waiter)
+		{
+			auto s = waiter.script.lock();
+			return !s || !s->IsWaitGeneration(waiter.waitGeneration);
+		});
+		m_waiters.erase(itr, m_waiters.end());
+		m_waiterPruneSize = std::max(m_waiters.size() * 2, MinWaiterPruneSize);
+	}
+	m_waiters.push_back(Waiter{ script, waitGeneration });
+}
+
+void PropertySlot::ClearCollection()
+{
+	std::lock_guard<Mutex> lock(m_mutex);
+	if (m_value.IsCollection())
+	{
+		auto c = m_value.GetCollection();
+		for (auto & e : *c)
+		{
+			e.second.SetNull();
+		}
+	}
+}
+
+Variant PropertySlot::Get() const
+{
+	// Read scalar values without locking, unless a write is in progress
+	uint32_t sequence = m_sequence.load(std::memory_order_acquire);
+	if ((sequence & 1) == 0)
+	{
+		ValueType type = m_type.load(std::memory_order_relaxed);
+		uint64_t bits = m_scalarBits.load(std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (m_sequence.load(std::memory_order_relaxed) == sequence)
+		{
+			switch (type)
+			{
+				case ValueType::Null:
+					return Variant();
+				case ValueType::Boolean:
+					return Variant(bits != 0);
+				case ValueType::Integer:
+					return Variant(static_cast<int64_t>(bits));
+				case ValueType::Number:
+				{
+					double number;
+					memcpy(&number, &bits, sizeof(number));
+					return Variant(number);
+				}
+				default:
+					break;
+			};
+		}
+	}
+	std::lock_guard<Mutex> lock(m_mutex);
+	return m_value;
+}
+
+Variant PropertySlot::GetKeyValue(const Variant & key) const
+{
+	std::lock_guard<Mutex> lock(m_mutex);
+	if (!m_value.IsCollection())
+		return Variant();
+	auto collPtr = m_value.GetCollection();
+	auto vitr = collPtr->find(key);
+	if (vitr == collPtr->end())
+		return Variant();
+	return vitr->second;
+}
+
+void PropertySlot::Publish()
+{
+	uint64_t bits = 0;
+	switch (m_value.GetType())
+	{
+		case ValueType::Boolean:
+			bits = m_value.GetBoolean() ? 1 : 0;
+			break;
+		case ValueType::Integer:
+			bits = static_cast<uint64_t>(m_value.GetInteger());
+			break;
+		case ValueType::Number:
+		{
+			double number = m_value.GetNumber();
+			memcpy(&bits, &number, sizeof(bits));
+		}
+		break;
+		default:
+			break;
+	};
+	uint32_t sequence = m_sequence.load(std::memory_order_relaxed);
+	m_sequence.store(sequence + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	m_type.store(m_value.GetType(), std::memory_order_relaxed);
+	m_scalarBits.store(bits, std::memory_order_relaxed);
+	m_sequence.store(sequence + 2, std::memory_order_release);
+}
+
+void PropertySlot::Set(const Variant & value)
+{
+	WaiterList waiters;
+	{
+		std::lock_guard<Mutex> lock(m_mutex);
+		m_value = value;
+		Publish();
+		if (!m_waiters.empty())
+			waiters.swap(m_waiters);
+	}
+	WakeWaiters(waiters);
+}
+
+bool PropertySlot::SetKeyValue(const Variant & key, const Variant & value)
+{
+	WaiterList waiters;
+	{
+		std::lock_guard<Mutex> lock(m_mutex);
+		if (!m_value.IsCollection())
+			return false;
+		auto collPtr = m_value.GetCollection();
+		(*collPtr)[key] = value;
+		if (!m_waiters.empty())
+			waiters.swap(m_waiters);
+	}
+	WakeWaiters(waiters);
+	return true;
+}
+
+void PropertySlot::WakeWaiters(WaiterList & waiters)
+{
+	// Scripts are woken after unlocking, since waking may reschedule them
+	for (const auto & waiter : waiters)
+	{
+		auto script = waiter.script.lock();
+		if (script)
+			script->Wake(waiter.waitGeneration);
+	}
+}
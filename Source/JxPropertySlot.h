@@ -0,0 +1,73 @@
+/*
+The Jinx library is distributed under the MIT License (MIT)
+https://opensource.org/licenses/MIT
+See LICENSE.TXT or Jinx.h for license details.
+Copyright (c) 2016 James Boer
+*/
+
+#pragma once
+#ifndef JX_PROPERTY_SLOT_H__
+#define JX_PROPERTY_SLOT_H__
+
+
+namespace Jinx
+{
+
+	class Script;
+
+	// Storage for a runtime property value.  Slots are allocated when a property is first set, and are
+	// never moved or freed while the runtime exists, so instructions can cache a pointer to the slot.
+	// Each slot is guarded by its own mutex, so accesses to different properties don't contend.  Null,
+	// boolean, integer, and number values are also published with a sequence lock, and are read
+	// without locking or writing to shared memory, so properties read by every script don't contend.
+	class PropertySlot
+	{
+	public:
+		PropertySlot(const Variant & value);
+
+		Variant Get() const;
+		ValueType GetType() const { return m_type.load(std::memory_order_acquire); }
+		Variant GetKeyValue(const Variant & key) const;
+		void Set(const Variant & value);
+		bool SetKeyValue(const Variant & key, const Variant & value);
+
+		// Clear collection values, breaking potential circular references
+		void ClearCollection();
+
+		// Wake a script with the specified wait generation the next time the property is set
+		void AddWaiter(const std::weak_ptr<Script> & script, uint32_t waitGeneration);
+
+	private:
+
+		static const size_t MinWaiterPruneSize = 16;
+
+		struct Waiter
+		{
+			std::weak_ptr<Script> script;
+			uint32_t waitGeneration;
+		};
+
+		typedef std::vector<Waiter, Allocator<Waiter>> WaiterList;
+
+		// Wake scripts removed from the waiter list after setting the value
+		static void WakeWaiters(WaiterList & waiters);
+
+		// Copy a scalar value to the lock-free fields.  Must be called with the mutex locked.
+		void Publish();
+
+		mutable Mutex m_mutex;
+		Variant m_value;
+
+		// Incremented before and after each write, so it's odd while a write is in progress
+		std::atomic<uint32_t> m_sequence;
+		std::atomic<ValueType> m_type;
+		std::atomic<uint64_t> m_scalarBits;
+
+		// Scripts suspended until the property is set.  Stale entries are pruned when the list grows.
+		WaiterList m_waiters;
+		size_t m_waiterPruneSize;
+	};
+
+};
+
+#endif // JX_PROPERTY_SLOT_H__
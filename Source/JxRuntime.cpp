@@ -9,32 +9,27 @@ Copyright (c) 2016 James Boer
 
 using namespace Jinx;
 
-Runtime::~Runtime()
+Runtime::Runtime(BlockHeap * heap, size_t scriptArenaSize) :
+	m_heap(heap),
+	m_scriptArenaSize(scriptArenaSize),
+	m_functionGeneration(1),
+	m_scheduler(this)
 {
-	// Clear potential circular references by explicitly destroying collection values
-	for (auto & s : m_propertyMap)
-	{
-		if (s.second.IsCollection())
-		{
-			auto c = s.second.GetCollection();
-			for (auto & e : *c)
-			{
-				e.second.SetNull();
-			}
-		}
-	}
 }
 
-void Runtime::AddPerformanceParams(uint64_t timeNs, uint64_t instCount)
+Runtime::~Runtime()
 {
-	std::lock_guard<Mutex> lock(m_perfMutex);
-	m_perfStats.executionTimeNs += timeNs;
-	m_perfStats.instructionCount += instCount;
-	m_perfStats.scriptExecutionCount++;
+	// Clear potential circular references by explicitly destroying collection values
+	m_propertyMap.ForEach([](RuntimeID, PropertySlot & property) { property.ClearCollection(); });
+
+	// The heap is destroyed once the runtime's remaining memory, including the runtime itself, is freed
+	ReleaseHeap(m_heap);
 }
 
 BufferPtr Runtime::Compile(BufferPtr scriptBuffer, String uniqueName, std::initializer_list<String> libraries)
 {
+	HeapScope scope(m_heap);
+
 	// Mark script execution start time
 	auto begin = std::chrono::high_resolution_clock::now();
 
@@ -62,10 +57,10 @@ BufferPtr Runtime::Compile(BufferPtr scriptBuffer, String uniqueName, std::initi
 
 	// Track accumulated script compilation time and count
 	auto end = std::chrono::high_resolution_clock::now();
-	uint64_t compilationTimeNs = std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count();
-	std::lock_guard<Mutex> lock(m_perfMutex);
-	m_perfStats.scriptCompilationCount++;
-	m_perfStats.compilationTimeNs += compilationTimeNs;
+	PerformanceStats stats;
+	stats.compilationTimeNs = std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count();
+	stats.scriptCompilationCount = 1;
+	m_perfCounters.Add(stats);
 
 	// Return the bytecode
 	return parser.GetBytecode();
@@ -73,6 +68,7 @@ BufferPtr Runtime::Compile(BufferPtr scriptBuffer, String uniqueName, std::initi
 
 BufferPtr Runtime::Compile(const char * scriptText, String uniqueName, std::initializer_list<String> libraries)
 {
+	HeapScope scope(m_heap);
 	auto scriptBuffer = CreateBuffer();
 	scriptBuffer->Write(scriptText, strlen(scriptText) + 1);
 	return Compile(scriptBuffer, uniqueName, libraries);
@@ -80,11 +76,14 @@ BufferPtr Runtime::Compile(const char * scriptText, String uniqueName, std::init
 
 ScriptPtr Runtime::CreateScript(BufferPtr bytecode)
 {
+	HeapScope scope(m_heap);
 	return std::allocate_shared<Script>(Allocator<Script>(), shared_from_this(), std::static_pointer_cast<Buffer>(bytecode));
 }
 
 ScriptPtr Runtime::CreateScript(const char * scriptText, String uniqueName, std::initializer_list<String> libraries)
 {
+	HeapScope scope(m_heap);
+
 	// Compile script text to bytecode
 	auto bytecode = Compile(scriptText, uniqueName, libraries);
 	if (!bytecode)
@@ -96,6 +95,8 @@ ScriptPtr Runtime::CreateScript(const char * scriptText, String uniqueName, std:
 
 ScriptPtr Runtime::ExecuteScript(const char * scriptcode, String uniqueName, std::initializer_list<String> libraries)
 {
+	HeapScope scope(m_heap);
+
 	// Compile the text to bytecode
 	auto bytecode = Compile(scriptcode, uniqueName, libraries);
 	if (!bytecode)
@@ -115,170 +116,201 @@ ScriptPtr Runtime::ExecuteScript(const char * scriptcode, String uniqueName, std
 
 FunctionDefinitionPtr Runtime::FindFunction(RuntimeID id) const
 {
-	std::lock_guard<Mutex> lock(m_functionMutex);
-	auto itr = m_functionMap.find(id);
-	if (itr == m_functionMap.end())
+	auto functionDef = m_functionMap.Find(id);
+	if (!functionDef)
+		return nullptr;
+	return *functionDef;
+}
+
+const FunctionDefinition * Runtime::FindFunction(CallSite & callSite, RuntimeID id) const
+{
+	// Use the call site's cached function if no functions have been registered since it was resolved
+	uint32_t generation = m_functionGeneration.load(std::memory_order_acquire);
+	if (callSite.generation.load(std::memory_order_acquire) == generation)
+		return callSite.function.load(std::memory_order_relaxed);
+
+	// Function definitions are owned by the function map and never removed, so it's safe to cache a raw pointer
+	auto functionDef = FindFunction(id);
+	if (!functionDef)
 		return nullptr;
-	return itr->second;
+	callSite.function.store(functionDef.get(), std::memory_order_relaxed);
+	callSite.generation.store(generation, std::memory_order_release);
+	return functionDef.get();
+}
+
+PropertySlot * Runtime::FindProperty(PropertySite & propertySite, RuntimeID id) const
+{
+	// Property slots are never moved or removed, so a slot can be cached once it's found
+	auto property = propertySite.property.load(std::memory_order_acquire);
+	if (property)
+		return property;
+	property = m_propertyMap.Find(id);
+	if (property)
+		propertySite.property.store(property, std::memory_order_release);
+	return property;
+}
+
+bool Runtime::ExecuteScripts(ScriptPtr * scripts, size_t count)
+{
+	// Executing scripts in memory order avoids cache misses when loading each script's state, which
+	// dominates the cost of executing small scripts.  Null entries are placed last.
+	auto scriptLess = [](const IScript * left, const IScript * right)
+	{
+		if (!left || !right)
+			return left && !right;
+		return left < right;
+	};
+
+	// Time the batch and record performance stats once, instead of for each script
+	PerformanceStats stats;
+	bool result = true;
+	bool ordered = true;
+	auto begin = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < count; ++i)
+	{
+		auto script = static_cast<Script *>(scripts[i].get());
+		if (!script)
+			continue;
+		if (i > 0 && scriptLess(script, scripts[i - 1].get()))
+			ordered = false;
+		if (!script->ExecuteUntil(TimePoint::max(), &stats))
+			result = false;
+	}
+	if (stats.scriptExecutionCount)
+	{
+		auto end = std::chrono::steady_clock::now();
+		stats.executionTimeNs = std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count();
+		AddPerformanceStats(stats);
+	}
+
+	// Sort batches out of order once, so batches executed repeatedly don't pay for sorting each time
+	if (!ordered)
+		std::sort(scripts, scripts + count, [&](const ScriptPtr & left, const ScriptPtr & right) { return scriptLess(left.get(), right.get()); });
+	return result;
 }
 
 PerformanceStats Runtime::GetScriptPerformanceStats(bool resetStats)
 {
-	std::lock_guard<Mutex> lock(m_perfMutex);
-	PerformanceStats s = m_perfStats;
-	if (resetStats)
-		m_perfStats = PerformanceStats();
-	return s;
+	return m_perfCounters.Collect(resetStats);
 }
 
 Variant Runtime::GetProperty(RuntimeID id) const
 {
-	std::lock_guard<Mutex> lock(m_propertyMutex);
-	auto itr = m_propertyMap.find(id);
-	if (itr == m_propertyMap.end())
+	auto property = m_propertyMap.Find(id);
+	if (!property)
 		return Variant();
-	return itr->second;
+	return property->Get();
 }
 
-Variant Runtime::GetPropertyKeyValue(RuntimeID id, const Variant & key)
+LibraryPtr Runtime::GetLibrary(const String & name)
 {
-	std::lock_guard<Mutex> lock(m_propertyMutex);
-	auto itr = m_propertyMap.find(id);
-	if (itr == m_propertyMap.end())
-		return Variant();
-	auto & var = itr->second;
-	if (!var.IsCollection())
-		return Variant();
-	auto collPtr = var.GetCollection();
-	auto vitr = collPtr->find(key);
-	if (vitr == collPtr->end())
-		return Variant();
-	return vitr->second;
+	auto library = m_libraryMap.Find(name);
+	if (library)
+		return *library;
+	HeapScope scope(m_heap);
+
+	// If another thread creates the same library first, its library is returned instead
+	auto newLibrary = std::allocate_shared<Library>(Allocator<Library>(), shared_from_this(), name);
+	return *m_libraryMap.Insert(name, newLibrary).first;
 }
 
-LibraryPtr Runtime::GetLibrary(const String & name)
+ProgramPtr Runtime::LoadProgram(BufferPtr bytecode, const void * const * dispatchTable, const void * const * verifiedDispatchTable)
 {
-	std::lock_guard<Mutex> lock(m_libraryMutex);
-	auto itr = m_libraryMap.find(name);
-	if (itr == m_libraryMap.end())
+	// Scripts created from the same bytecode share a single decoded program
+	std::lock_guard<Mutex> lock(m_programMutex);
+	auto itr = m_programMap.find(bytecode.get());
+	if (itr != m_programMap.end())
+	{
+		auto program = itr->second.lock();
+		if (program)
+			return program;
+	}
+
+	// Purge programs which are no longer referenced by any script or function
+	for (auto pitr = m_programMap.begin(); pitr != m_programMap.end();)
 	{
-		auto library = std::allocate_shared<Library>(Allocator<Library>(), shared_from_this(), name);
-		m_libraryMap.insert(std::make_pair(name, library));
-		return library;
+		if (pitr->second.expired())
+			pitr = m_programMap.erase(pitr);
+		else
+			++pitr;
 	}
-	return itr->second;
+
+	auto program = std::allocate_shared<Program>(Allocator<Program>(), bytecode, dispatchTable, verifiedDispatchTable);
+	m_programMap[bytecode.get()] = program;
+	return program;
 }
 
 bool Runtime::LibraryExists(const String & name) const
 {
-	std::lock_guard<Mutex> lock(m_libraryMutex);
-	return m_libraryMap.find(name) != m_libraryMap.end();
+	return m_libraryMap.Find(name) != nullptr;
 }
 
 void Runtime::LogBytecode(const BufferPtr & buffer) const
 {
 	LogWriteLine("\nBytecode:\n====================");
 	const size_t columnWidth = 16;
-	BinaryReader reader(buffer);
-	BytecodeHeader header;
-	reader.Read(&header, sizeof(header));
-	while (reader.Tell() < buffer->Size())
+	Program program(buffer);
+	if (!program.IsValid())
 	{
-		// Read opcode instruction
-		uint8_t opByte;
-		reader.Read(&opByte);
-		if (opByte >= static_cast<uint32_t>(Opcode::NumOpcodes))
-		{
-			LogWriteLine("Invalid operation in bytecode");
-			return;
-		}
-		Opcode opcode = static_cast<Opcode>(opByte);
-
-		const char * opcodeName = GetOpcodeText(opcode);
+		LogWriteLine("Invalid bytecode");
+		return;
+	}
+	for (size_t i = 0; i < program.GetInstructionCount(); ++i)
+	{
+		const auto & inst = program.GetInstructions()[i];
+		const char * opcodeName = GetOpcodeText(inst.opcode);
 		size_t opcodeNameLength = strlen(opcodeName);
 		LogWrite(opcodeName);
 
 		// Advance to column offset
 		assert(opcodeNameLength < columnWidth);
-		for (size_t i = 0; i < (columnWidth - opcodeNameLength); ++i)
+		for (size_t j = 0; j < (columnWidth - opcodeNameLength); ++j)
 			LogWrite(" ");
 
-		// Read and log opcode arguments
-		switch (opcode)
+		// Log decoded opcode arguments
+		switch (inst.opcode)
 		{
 			case Opcode::CallFunc:
-			case Opcode::EraseProp:
-			case Opcode::ErasePropElem:
-			case Opcode::PushProp:
-			case Opcode::PushPropKeyVal:
-			case Opcode::SetProp:
-			case Opcode::SetPropKeyVal:
+			case Opcode::TailCall:
 			{
-				RuntimeID id;
-				reader.Read(&id);
+				const auto & callSite = program.GetCallSite(inst.operand);
+				LogWrite("%i %i", callSite.parameterCount, callSite.returnCount);
 			}
 			break;
 			case Opcode::Cast:
 			{
-				uint8_t b;
-				reader.Read(&b);
-				auto type = ByteToValueType(b);
-				LogWrite("%s", GetValueTypeName(type));
+				LogWrite("%s", GetValueTypeName(inst.type));
 			}
 			break;
-			case Opcode::EraseVar:
-			case Opcode::EraseVarElem:
 			case Opcode::Library:
-			case Opcode::PushVar:
-			case Opcode::PushVarKey:
-			case Opcode::SetVar:
-			case Opcode::SetVarKey:
-			{
-				String name;
-				reader.Read(&name);
-				LogWrite("%s", name.c_str());
-			}
-			break;
-			case Opcode::Function:
 			{
-				FunctionSignature signature;
-				signature.Read(reader);
-			}
-			break;
-			case Opcode::Property:
-			{
-				PropertyName propertyName;
-				propertyName.Read(reader);
+				LogWrite("%s", program.GetLibraryName(inst.operand).c_str());
 			}
 			break;
+			case Opcode::EraseVar:
+			case Opcode::EraseVarElem:
 			case Opcode::Jump:
 			case Opcode::JumpFalse:
 			case Opcode::JumpTrue:
 			case Opcode::PopCount:
 			case Opcode::PushColl:
 			case Opcode::PushList:
+			case Opcode::PushVar:
+			case Opcode::PushVarKey:
+			case Opcode::SetVar:
+			case Opcode::SetVarKey:
 			{
-				uint32_t count;
-				reader.Read(&count);
-				LogWrite("%i", count);
+				LogWrite("%i", inst.operand);
 			}
 			break;
 			case Opcode::PushVal:
 			{
-				Variant val;
-				val.Read(reader);
-				LogWrite("%s", val.GetString().c_str());
+				LogWrite("%s", program.GetConstant(inst.operand).GetString().c_str());
 			}
 			break;
 			case Opcode::SetIndex:
 			{
-				String name;
-				reader.Read(&name);
-				int32_t stackIndex;
-				reader.Read(&stackIndex);
-				ValueType type;
-				reader.Read<ValueType, uint8_t>(&type);
-				LogWrite("%s %i %s", name.c_str(), stackIndex, GetValueTypeName(type));
+				LogWrite("%i %i %s", inst.operand, inst.index, GetValueTypeName(inst.type));
 			}
 			break;
 			default:
@@ -355,47 +387,61 @@ void Runtime::LogSymbols(const SymbolList & symbolList) const
 
 bool Runtime::PropertyExists(RuntimeID id) const
 {
-	std::lock_guard<Mutex> lock(m_propertyMutex);
-	return m_propertyMap.find(id) != m_propertyMap.end();
+	return m_propertyMap.Find(id) != nullptr;
 }
 
-void Runtime::RegisterFunction(const FunctionSignature & signature, BufferPtr bytecode, size_t offset)
+void Runtime::RegisterFunction(const FunctionSignature & signature, ProgramPtr program, size_t entry)
 {
-	std::lock_guard<Mutex> lock(m_functionMutex);
-	auto functionDefPtr = std::allocate_shared<FunctionDefinition>(Allocator<FunctionDefinition>(), signature, bytecode, offset);
-	m_functionMap.insert(std::make_pair(signature.GetId(), functionDefPtr));
+	if (m_functionMap.Find(signature.GetId()))
+		return;
+	auto functionDefPtr = std::allocate_shared<FunctionDefinition>(Allocator<FunctionDefinition>(), signature, program, entry);
+	if (m_functionMap.Insert(signature.GetId(), functionDefPtr).second)
+		m_functionGeneration.fetch_add(1, std::memory_order_release);
 }
 
 void Runtime::RegisterFunction(const FunctionSignature & signature, FunctionCallback function)
 {
-	std::lock_guard<Mutex> lock(m_functionMutex);
+	if (m_functionMap.Find(signature.GetId()))
+		return;
 	auto functionDefPtr = std::allocate_shared<FunctionDefinition>(Allocator<FunctionDefinition>(), signature, function);
-	m_functionMap.insert(std::make_pair(signature.GetId(), functionDefPtr));
+	if (m_functionMap.Insert(signature.GetId(), functionDefPtr).second)
+		m_functionGeneration.fetch_add(1, std::memory_order_release);
 }
 
-void Runtime::SetProperty(RuntimeID id, const Variant & value)
+void Runtime::RegisterFunction(const FunctionSignature & signature, AsyncFunctionCallback function)
 {
-	std::lock_guard<Mutex> lock(m_propertyMutex);
-	m_propertyMap[id] = value;
+	if (m_functionMap.Find(signature.GetId()))
+		return;
+	auto functionDefPtr = std::allocate_shared<FunctionDefinition>(Allocator<FunctionDefinition>(), signature, function);
+	if (m_functionMap.Insert(signature.GetId(), functionDefPtr).second)
+		m_functionGeneration.fetch_add(1, std::memory_order_release);
 }
 
-bool Runtime::SetPropertyKeyValue(RuntimeID id, const Variant & key, const Variant & value)
+void Runtime::SetProperty(RuntimeID id, const Variant & value)
 {
-	std::lock_guard<Mutex> lock(m_propertyMutex);
-	auto itr = m_propertyMap.find(id);
-	if (itr == m_propertyMap.end())
-		return false;
-	auto & variant = itr->second;
-	if (!variant.IsCollection())
-		return false;
-	auto collPtr = variant.GetCollection();
-	(*collPtr)[key] = value;
-	return true;
+	auto property = m_propertyMap.Find(id);
+	if (!property)
+	{
+		auto result = m_propertyMap.Insert(id, value);
+		if (result.second)
+			return;
+		property = result.first;
+	}
+	property->Set(value);
 }
 
 RuntimePtr Jinx::CreateRuntime()
 {
-	auto runtime = std::allocate_shared<Runtime>(Allocator<Runtime>());
+	return CreateRuntime(RuntimeParams());
+}
+
+RuntimePtr Jinx::CreateRuntime(const RuntimeParams & params)
+{
+	// The runtime itself is allocated from its heap, so the heap outlives it
+	BlockHeap * heap = params.privateHeap ? CreateHeap(params) : nullptr;
+	HeapScope scope(heap);
+	size_t scriptArenaSize = params.scriptArenaSize == std::numeric_limits<size_t>::max() ? ScriptArenaSize() : params.scriptArenaSize;
+	auto runtime = std::allocate_shared<Runtime>(Allocator<Runtime>(), heap, scriptArenaSize);
 	RegisterLibCore(runtime);
 	return runtime;
 }
@@ -16,6 +16,7 @@ namespace Jinx
 	class Runtime : public IRuntime, public std::enable_shared_from_this<Runtime>
 	{
 	public:
+		Runtime(BlockHeap * heap, size_t scriptArenaSize);
 		virtual ~Runtime();
 
 		// IRuntime interface
@@ -23,41 +24,62 @@ namespace Jinx
 		ScriptPtr CreateScript(BufferPtr bytecode) override;
 		ScriptPtr CreateScript(const char * scriptText, String uniqueName, std::initializer_list<String> libraries) override;
 		ScriptPtr ExecuteScript(const char * scriptcode, String uniqueName, std::initializer_list<String> libraries) override;
+		bool ExecuteScripts(ScriptPtr * scripts, size_t count) override;
 		LibraryPtr GetLibrary(const String & name) override;
 
 		// Internal interface
 		BufferPtr Compile(BufferPtr scriptBuffer, String uniqueName, std::initializer_list<String> libraries);
 		inline LibraryIPtr GetLibraryInternal(const String & name) { return std::static_pointer_cast<Library>(GetLibrary(name)); }
 		FunctionDefinitionPtr FindFunction(RuntimeID id) const;
+		const FunctionDefinition * FindFunction(CallSite & callSite, RuntimeID id) const;
 		bool LibraryExists(const String & name) const;
-		void RegisterFunction(const FunctionSignature & signature, BufferPtr bytecode, size_t offset);
+		ProgramPtr LoadProgram(BufferPtr bytecode, const void * const * dispatchTable, const void * const * verifiedDispatchTable);
+		void RegisterFunction(const FunctionSignature & signature, ProgramPtr program, size_t entry);
 		void RegisterFunction(const FunctionSignature & signature, FunctionCallback function);
+		void RegisterFunction(const FunctionSignature & signature, AsyncFunctionCallback function);
+		PropertySlot * FindProperty(RuntimeID id) const { return m_propertyMap.Find(id); }
+		PropertySlot * FindProperty(PropertySite & propertySite, RuntimeID id) const;
 		Variant GetProperty(RuntimeID id) const;
-		Variant GetPropertyKeyValue(RuntimeID id, const Variant & key);
 		bool PropertyExists(RuntimeID id) const;
 		void SetProperty(RuntimeID id, const Variant & value);
-		bool SetPropertyKeyValue(RuntimeID id, const Variant & key, const Variant & value);
 		PerformanceStats GetScriptPerformanceStats(bool resetStats = true) override;
-		void AddPerformanceParams(uint64_t timeNs, uint64_t instCount);
+		MemoryStats GetMemoryStats() const override { return Jinx::GetMemoryStats(m_heap); }
+		void RegisterScript(ScriptPtr script) override { HeapScope scope(m_heap); m_scheduler.RegisterScript(script); }
+		void UnregisterScript(ScriptPtr script) override { HeapScope scope(m_heap); m_scheduler.UnregisterScript(script); }
+		SchedulerStats RunTick(uint64_t maxTickTimeNs = 0) override { HeapScope scope(m_heap); return m_scheduler.RunTick(maxTickTimeNs); }
+		void UpdateClock(double time) override { HeapScope scope(m_heap); m_timerWheel.Advance(time); }
+		BlockHeap * GetHeap() const { return m_heap; }
+		size_t GetScriptArenaSize() const { return m_scriptArenaSize; }
+		void RescheduleScript(ScriptPtr script) { m_scheduler.RescheduleScript(script); }
+		void AddTimer(const std::weak_ptr<Script> & script, uint32_t waitGeneration, double seconds) { m_timerWheel.AddTimer(script, waitGeneration, seconds); }
+		void AddPerformanceStats(const PerformanceStats & stats) { m_perfCounters.Add(stats); }
 
 	private:
 
-		typedef std::map<String, LibraryIPtr, std::less<String>, Allocator<std::pair<String, LibraryIPtr>>> LibraryMap;
-		typedef std::map<RuntimeID, FunctionDefinitionPtr, std::less<RuntimeID>, Allocator<std::pair<RuntimeID, FunctionDefinitionPtr>>> FunctionMap;
-		typedef std::map<RuntimeID, Variant, std::less<RuntimeID>, Allocator<std::pair<RuntimeID, Variant>>> PropertyMap;
+		// Libraries, functions, and properties are never removed, and are looked up without locking
+		typedef ConcurrentMap<String, LibraryIPtr> LibraryMap;
+		typedef ConcurrentMap<RuntimeID, FunctionDefinitionPtr> FunctionMap;
+		typedef ConcurrentMap<RuntimeID, PropertySlot> PropertyMap;
+		typedef std::map<const Buffer *, std::weak_ptr<Program>, std::less<const Buffer *>, Allocator<std::pair<const Buffer *, std::weak_ptr<Program>>>> ProgramMap;
 		void LogBytecode(const BufferPtr & buffer) const;
 		void LogSymbols(const SymbolList & symbolList) const;
 
 	private:
 
-		mutable Mutex m_libraryMutex;
+		// Private heap the runtime allocates from, or null for the global heap
+		BlockHeap * m_heap;
+
+		// Size of each script's arena
+		size_t m_scriptArenaSize;
 		LibraryMap m_libraryMap;
-		mutable Mutex m_functionMutex;
 		FunctionMap m_functionMap;
-		mutable Mutex m_propertyMutex;
+		std::atomic<uint32_t> m_functionGeneration;
 		PropertyMap m_propertyMap;
-		Mutex m_perfMutex;
-		PerformanceStats m_perfStats;
+		Mutex m_programMutex;
+		ProgramMap m_programMap;
+		PerformanceCounters m_perfCounters;
+		Scheduler m_scheduler;
+		TimerWheel m_timerWheel;
 	};
 
 
@@ -0,0 +1,271 @@
+/*
+The Jinx library is distributed under the MIT License (MIT)
+https://opensource.org/licenses/MIT
+See LICENSE.TXT or Jinx.h for license details.
+Copyright (c) 2016 James Boer
+*/
+
+#include "JxInternal.h"
+
+using namespace Jinx;
+
+Scheduler::Scheduler(Runtime * runtime) :
+	m_runtime(runtime),
+	m_pendingUnregistered(false),
+	m_updateCount(0),
+	m_stealCount(0),
+	m_tickGeneration(0),
+	m_tickThreadCount(0),
+	m_activeThreads(0),
+	m_shutdown(false)
+{
+	static_assert(sizeof(WorkQueue) == CacheLineSize, "Work queues should each fill a cache line");
+}
+
+Scheduler::~Scheduler()
+{
+	{
+		std::lock_guard<Mutex> lock(m_threadMutex);
+		m_shutdown = true;
+	}
+	m_tickBegin.notify_all();
+	for (auto & thread : m_threads)
+		thread.join();
+}
+
+void Scheduler::RegisterScript(ScriptPtr script)
+{
+	if (!script)
+		return;
+	std::lock_guard<Mutex> lock(m_pendingMutex);
+	auto s = std::static_pointer_cast<Script>(script);
+	if (s->IsScheduled())
+		return;
+	s->SetScheduled(true);
+	m_pendingRegistered.push_back(script);
+}
+
+void Scheduler::RescheduleScript(ScriptPtr script)
+{
+	std::lock_guard<Mutex> lock(m_pendingMutex);
+	if (std::static_pointer_cast<Script>(script)->IsScheduled())
+		m_pendingRegistered.push_back(script);
+}
+
+void Scheduler::UnregisterScript(ScriptPtr script)
+{
+	if (!script)
+		return;
+	std::lock_guard<Mutex> lock(m_pendingMutex);
+	std::static_pointer_cast<Script>(script)->SetScheduled(false);
+	m_pendingUnregistered = true;
+}
+
+void Scheduler::Unschedule(const ScriptWPtr & script)
+{
+	// Scripts the scheduler drops after finishing or failing are no longer registered, so they can be
+	// registered again.  Must be called with the pending mutex locked.
+	auto s = std::static_pointer_cast<Script>(script.lock());
+	if (s)
+		s->SetScheduled(false);
+}
+
+void Scheduler::UpdateScripts()
+{
+	std::lock_guard<Mutex> lock(m_pendingMutex);
+	if (m_pendingRegistered.empty() && !m_pendingUnregistered)
+		return;
+	m_scripts.insert(m_scripts.end(), m_pendingRegistered.begin(), m_pendingRegistered.end());
+	m_pendingRegistered.clear();
+	m_pendingUnregistered = false;
+
+	// Keep scripts by whether they're registered once all pending calls are made, regardless of the
+	// order of the calls, and keep scripts registered more than once only once, so no script is
+	// executed by two threads in the same tick
+	++m_updateCount;
+	auto itr = std::remove_if(m_scripts.begin(), m_scripts.end(), [this](const ScriptWPtr & script)
+	{
+		auto s = std::static_pointer_cast<Script>(script.lock());
+		return !s || !s->IsScheduled() || !s->MarkScheduled(m_updateCount);
+	});
+	m_scripts.erase(itr, m_scripts.end());
+}
+
+void Scheduler::StartThreads(size_t count)
+{
+	m_threads.reserve(count);
+	for (size_t i = 0; i < count; ++i)
+		m_threads.push_back(std::thread(&Scheduler::WorkerThread, this, i + 1));
+}
+
+void Scheduler::WorkerThread(size_t index)
+{
+	uint64_t generation = 0;
+	while (true)
+	{
+		// Wait for the next tick to begin
+		size_t threadCount;
+		{
+			std::lock_guard<Mutex> lock(m_threadMutex);
+			while (m_tickGeneration == generation && !m_shutdown)
+				m_tickBegin.wait(m_threadMutex);
+			if (m_shutdown)
+				return;
+			generation = m_tickGeneration;
+			threadCount = m_tickThreadCount;
+		}
+
+		// Threads beyond the number needed for small ticks don't execute scripts
+		if (index < threadCount)
+			ExecuteQueues(index, threadCount);
+
+		std::lock_guard<Mutex> lock(m_threadMutex);
+		if (--m_activeThreads == 0)
+			m_tickEnd.notify_all();
+	}
+}
+
+void Scheduler::ExecuteQueues(size_t index, size_t threadCount)
+{
+	// Execute this thread's own queue, then steal remaining batches from other threads' queues
+	PerformanceStats stats;
+	auto begin = std::chrono::steady_clock::now();
+	ExecuteQueue(m_queues[index], &stats);
+	uint32_t steals = 0;
+	for (size_t i = 1; i < threadCount; ++i)
+		steals += static_cast<uint32_t>(ExecuteQueue(m_queues[(index + i) % threadCount], &stats));
+	if (steals)
+		m_stealCount += steals;
+
+	// Each thread records its performance stats once per tick
+	if (stats.scriptExecutionCount)
+	{
+		auto end = std::chrono::steady_clock::now();
+		stats.executionTimeNs = std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count();
+		m_runtime->AddPerformanceStats(stats);
+	}
+}
+
+size_t Scheduler::ExecuteQueue(WorkQueue & queue, PerformanceStats * stats)
+{
+	size_t batches = 0;
+	while (true)
+	{
+		size_t begin = queue.next.fetch_add(BatchSize, std::memory_order_relaxed);
+		if (begin >= queue.end)
+			return batches;
+		size_t end = std::min(begin + BatchSize, queue.end);
+		for (size_t i = begin; i < end; ++i)
+		{
+			auto script = std::static_pointer_cast<Script>(m_scripts[i].lock());
+			if (!script)
+				m_results[i] = ScriptResult::Released;
+			else if (m_tickDeadline != TimePoint::max() && std::chrono::steady_clock::now() >= m_tickDeadline)
+				m_results[i] = ScriptResult::Deferred;
+			else if (!script->ExecuteUntil(m_tickDeadline, stats))
+				m_results[i] = ScriptResult::Error;
+			else if (script->IsFinished())
+				m_results[i] = ScriptResult::Finished;
+			else if (script->Detach())
+				m_results[i] = ScriptResult::Suspended;
+		}
+		++batches;
+	}
+}
+
+SchedulerStats Scheduler::RunTick(uint64_t maxTickTimeNs)
+{
+	auto begin = std::chrono::steady_clock::now();
+	m_tickDeadline = maxTickTimeNs ? begin + std::chrono::nanoseconds(maxTickTimeNs) : TimePoint::max();
+
+	UpdateScripts();
+	size_t scriptCount = m_scripts.size();
+	m_results.assign(scriptCount, ScriptResult::Running);
+
+	// Use one thread per batch of scripts, up to the configured thread count
+	size_t maxThreads = SchedulerThreads() ? SchedulerThreads() : std::max(std::thread::hardware_concurrency(), 1u);
+	size_t threadCount = std::max<size_t>(std::min<size_t>(maxThreads, scriptCount / BatchSize), 1);
+
+	// Divide scripts evenly between the threads' queues
+	if (m_queues.size() < threadCount)
+	{
+		std::vector<WorkQueue, Allocator<WorkQueue>> queues(threadCount);
+		m_queues.swap(queues);
+	}
+	for (size_t i = 0; i < threadCount; ++i)
+	{
+		m_queues[i].next.store(scriptCount * i / threadCount, std::memory_order_relaxed);
+		m_queues[i].end = scriptCount * (i + 1) / threadCount;
+	}
+	m_stealCount = 0;
+
+	// Wake the worker threads, execute scripts on this thread, and wait for the workers to finish
+	if (threadCount > 1)
+	{
+		if (m_threads.size() < maxThreads - 1)
+			StartThreads(maxThreads - 1 - m_threads.size());
+		{
+			std::lock_guard<Mutex> lock(m_threadMutex);
+			m_tickThreadCount = threadCount;
+			m_activeThreads = m_threads.size();
+			++m_tickGeneration;
+		}
+		m_tickBegin.notify_all();
+	}
+	ExecuteQueues(0, threadCount);
+	if (threadCount > 1)
+	{
+		std::lock_guard<Mutex> lock(m_threadMutex);
+		while (m_activeThreads)
+			m_tickEnd.wait(m_threadMutex);
+	}
+
+	// Unregister scripts that finished, failed, or were released, drop suspended scripts until they're woken,
+	// and move deferred scripts to the front, so they're executed first in the next tick
+	SchedulerStats stats;
+	size_t remaining = 0;
+	size_t releasedCount = 0;
+	std::lock_guard<Mutex> lock(m_pendingMutex);
+	for (size_t i = 0; i < scriptCount; ++i)
+	{
+		switch (m_results[i])
+		{
+			case ScriptResult::Running:
+				if (remaining != i)
+					m_scripts[remaining] = std::move(m_scripts[i]);
+				++remaining;
+				break;
+			case ScriptResult::Finished:
+				++stats.finishedCount;
+				Unschedule(m_scripts[i]);
+				break;
+			case ScriptResult::Error:
+				++stats.errorCount;
+				Unschedule(m_scripts[i]);
+				break;
+			case ScriptResult::Released:
+				++releasedCount;
+				break;
+			case ScriptResult::Suspended:
+				++stats.suspendedCount;
+				break;
+			case ScriptResult::Deferred:
+				++stats.deferredCount;
+				m_deferred.push_back(std::move(m_scripts[i]));
+				break;
+		}
+	}
+	m_scripts.resize(remaining);
+	if (!m_deferred.empty())
+	{
+		m_scripts.insert(m_scripts.begin(), m_deferred.begin(), m_deferred.end());
+		m_deferred.clear();
+	}
+
+	auto end = std::chrono::steady_clock::now();
+	stats.scriptCount = static_cast<uint32_t>(scriptCount - releasedCount - stats.deferredCount);
+	stats.threadCount = static_cast<uint32_t>(threadCount);
+	stats.stealCount = m_stealCount;
+	stats.tickTimeNs = std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count();
+	return stats;
+}
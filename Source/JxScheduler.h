@@ -0,0 +1,104 @@
+/*
+The Jinx library is distributed under the MIT License (MIT)
+https://opensource.org/licenses/MIT
+See LICENSE.TXT or Jinx.h for license details.
+Copyright (c) 2016 James Boer
+*/
+
+#pragma once
+#ifndef JX_SCHEDULER_H__
+#define JX_SCHEDULER_H__
+
+
+namespace Jinx
+{
+
+	// Executes registered scripts once per tick on a work-stealing thread pool.  Each thread begins
+	// the tick with an equal share of the scripts in its own queue, and threads finishing their own
+	// queue take the remaining batches from other threads' queues.
+	class Scheduler
+	{
+	public:
+		Scheduler(Runtime * runtime);
+		~Scheduler();
+
+		void RegisterScript(ScriptPtr script);
+		void UnregisterScript(ScriptPtr script);
+
+		// Register a woken script again if it's still registered with the scheduler.  Scripts registered
+		// more than once are executed once each tick.
+		void RescheduleScript(ScriptPtr script);
+		SchedulerStats RunTick(uint64_t maxTickTimeNs);
+
+	private:
+
+		// Scripts are taken from queues in batches, large enough to keep contention between threads low
+		static const size_t BatchSize = 16;
+
+		// Separates per-thread data that's frequently written into different cache lines
+		static const size_t CacheLineSize = 64;
+
+		// Result of executing a script during a tick
+		enum class ScriptResult : uint8_t
+		{
+			Running,
+			Finished,
+			Error,
+			Released,
+			Suspended,
+			Deferred,
+		};
+
+		// Range of script indices remaining in a thread's queue for the current tick
+		struct WorkQueue
+		{
+			std::atomic<size_t> next;
+			size_t end;
+			uint8_t padding[CacheLineSize - sizeof(std::atomic<size_t>) - sizeof(size_t)];
+		};
+
+		typedef std::weak_ptr<IScript> ScriptWPtr;
+
+		void Unschedule(const ScriptWPtr & script);
+		void UpdateScripts();
+		void StartThreads(size_t count);
+		void WorkerThread(size_t index);
+		void ExecuteQueues(size_t index, size_t threadCount);
+		size_t ExecuteQueue(WorkQueue & queue, PerformanceStats * stats);
+
+		// Runtime owning the scheduler, which performance stats are recorded in
+		Runtime * m_runtime;
+
+		// Scripts registered since the last tick, and whether any scripts were unregistered
+		Mutex m_pendingMutex;
+		std::vector<ScriptWPtr, Allocator<ScriptWPtr>> m_pendingRegistered;
+		bool m_pendingUnregistered;
+		uint64_t m_updateCount;
+
+		// Scripts executed each tick, and the result of executing each script in the current tick.  The
+		// scheduler doesn't keep scripts alive, so scripts released by the client are dropped.
+		std::vector<ScriptWPtr, Allocator<ScriptWPtr>> m_scripts;
+		std::vector<ScriptResult, Allocator<ScriptResult>> m_results;
+
+		// Time the current tick ends, and scripts deferred to the next tick when it passes
+		TimePoint m_tickDeadline;
+		std::vector<ScriptWPtr, Allocator<ScriptWPtr>> m_deferred;
+
+		// Work queue for each thread executing the current tick
+		std::vector<WorkQueue, Allocator<WorkQueue>> m_queues;
+		std::atomic<uint32_t> m_stealCount;
+
+		// Worker threads, started when first needed.  The thread calling RunTick() also executes scripts.
+		std::vector<std::thread, Allocator<std::thread>> m_threads;
+		Mutex m_threadMutex;
+		ConditionVariable m_tickBegin;
+		ConditionVariable m_tickEnd;
+		uint64_t m_tickGeneration;
+		size_t m_tickThreadCount;
+		size_t m_activeThreads;
+		bool m_shutdown;
+	};
+
+};
+
+#endif // JX_SCHEDULER_H__
@@ -10,22 +10,52 @@ Copyright (c) 2016 James Boer
 using namespace Jinx;
 
 
+const size_t Script::InvalidIndex;
+
 Script::Script(RuntimeIPtr runtime, BufferPtr bytecode) :
 	m_runtime(runtime),
+	m_arena(runtime->GetScriptArenaSize()),
+	m_execution(ArenaAllocator<ExecutionFrame>(&m_arena)),
+	m_scopes(ArenaAllocator<ScopeFrame>(&m_arena)),
+	m_slots(ArenaAllocator<size_t>(&m_arena)),
+	m_declared(ArenaAllocator<size_t>(&m_arena)),
+	m_stack(ArenaAllocator<Variant>(&m_arena)),
 	m_finished(false),
-	m_error(false)
+	m_error(false),
+	m_switchInterpreter(false),
+	m_maxExecutionTimeNs(MaxExecutionTimeNs()),
+	m_functionCallCount(0),
+	m_nativeCallCount(0),
+	m_waitState(WaitState::Running),
+	m_waitGeneration(0),
+	m_armedWait(nullptr),
+	m_waitProperties(ArenaAllocator<PropertySlot *>(&m_arena)),
+	m_asyncReturn(false),
+	m_asyncTailCall(false),
+	m_scheduled(false),
+	m_scheduledUpdate(0)
 {
-	m_execution.reserve(6);
-	m_execution.push_back(ExecutionFrame(bytecode));
+	// Load the decoded program, threaded with the dispatch table of the interpreter matching its
+	// verification, and begin execution at the first instruction
+	const void * const * dispatchTable = nullptr;
+	ExecuteInstructions<true>(nullptr, &dispatchTable);
+	const void * const * verifiedDispatchTable = nullptr;
+	ExecuteInstructions<false>(nullptr, &verifiedDispatchTable);
+	m_program = m_runtime->LoadProgram(bytecode, dispatchTable, verifiedDispatchTable);
+
+	// Preallocate frame stacks, which are reused by each function call
+	m_execution.reserve(8);
+	m_scopes.reserve(16);
+	m_slots.reserve(32);
+	m_declared.reserve(32);
+	m_stack.reserve(16);
+	PushFrame(m_program.get(), 0, 0);
 
 	// Assume default unnamed library unless explicitly overridden
 	m_library = m_runtime->GetLibraryInternal("");
 
-	// Read bytecode header
-	BytecodeHeader header;
-	auto & reader = m_execution.back().reader;
-	reader.Read(&header, sizeof(header));
-	if (header.signature != BytecodeSignature || header.majorVer != BytecodeMajorVersion || header.minorVer != BytecodeMinorVersion)
+	// Validate bytecode
+	if (!m_program->IsValid())
 	{
 		Error("Invalid bytecode");
 	}
@@ -45,6 +75,48 @@ Script::~Script()
 			}
 		}
 	}
+	for (auto & v : m_hostVariables)
+	{
+		if (v.second.IsCollection())
+		{
+			for (auto & e : *v.second.GetCollection())
+				e.second.SetNull();
+		}
+	}
+}
+
+void Script::ArmWait(const Program * program, const Instruction * inst)
+{
+	// Find the properties the condition reads.  Collections can be modified without setting the property
+	// or variable holding them, so conditions reading collections can't be tracked.
+	m_armedWait = nullptr;
+	m_waitProperties.clear();
+	const Instruction * begin = program->GetInstructions() + inst->operand;
+	for (const Instruction * i = begin; i != begin + inst->index; ++i)
+	{
+		if (i->opcode == Opcode::PushProp)
+		{
+			auto property = m_runtime->FindProperty(program->GetPropertySite(i->operand), i->id);
+			if (!property || property->GetType() == ValueType::Collection || property->GetType() == ValueType::CollectionItr)
+				return;
+			m_waitProperties.push_back(property);
+		}
+		else if (i->opcode == Opcode::PushVar)
+		{
+			size_t index;
+			if (!GetSlotIndex(i->operand, &index) || m_stack[index].IsCollection() || m_stack[index].IsCollectionItr())
+				return;
+		}
+	}
+
+	// Arm the wait before registering with the properties, so any change from here on wakes the script
+	uint32_t generation = m_waitGeneration.load(std::memory_order_relaxed) + 1;
+	m_waitGeneration.store(generation, std::memory_order_release);
+	m_waitState.store(WaitState::Armed, std::memory_order_release);
+	std::weak_ptr<Script> script = shared_from_this();
+	for (auto property : m_waitProperties)
+		property->AddWaiter(script, generation);
+	m_armedWait = inst;
 }
 
 void Script::Error(const char * message)
@@ -55,187 +127,446 @@ void Script::Error(const char * message)
 }
 
 bool Script::Execute()
+{
+	// Suspended scripts return without reading the clock
+	if (!m_error && m_waitState.load(std::memory_order_acquire) >= WaitState::Suspended)
+		return true;
+
+	// Track accumulated script execution time
+	PerformanceStats stats;
+	auto begin = std::chrono::steady_clock::now();
+	bool result = ExecuteUntil(TimePoint::max(), &stats);
+	if (stats.scriptExecutionCount)
+	{
+		auto end = std::chrono::steady_clock::now();
+		stats.executionTimeNs = std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count();
+		m_runtime->AddPerformanceStats(stats);
+	}
+	return result;
+}
+
+bool Script::ExecuteUntil(TimePoint deadline, PerformanceStats * stats)
 {
 	// Don't continue executing if we've encountered an error
 	if (m_error)
 		return false;
 
+	// Allocate from the runtime's heap, whichever thread executes the script
+	HeapScope scope(m_runtime->GetHeap());
+
 	// Make sure we have bytecode
-	if (!m_execution.back().bytecode)
+	if (!m_program->GetBytecode())
 	{
 		Error("No bytecode to execute");
 		return false;
 	}
 
+	// Suspended scripts don't execute until a value their wait condition reads changes
+	if (m_waitState.load(std::memory_order_acquire) >= WaitState::Suspended)
+		return true;
+
+	// Scripts suspended in an asynchronous call continue once the call is complete
+	if (m_asyncCall && !ResumeAsyncCall())
+		return true;
+
 	// Auto reset if finished
 	if (m_finished)
 	{
 		m_finished = false;
-		m_execution.back().reader.Seek(sizeof(BytecodeHeader));
+		m_execution.back().ip = m_program->GetInstructions();
 	}
 
-	// Mark script execution start time
-	auto begin = std::chrono::high_resolution_clock::now();
+	// Mark the time to yield at, reading the clock only if the script has its own time limit
+	m_deadline = deadline;
+	if (m_maxExecutionTimeNs)
+		m_deadline = std::min(m_deadline, std::chrono::steady_clock::now() + std::chrono::nanoseconds(m_maxExecutionTimeNs));
 
+	// Each frame executes with the interpreter matching its program's verification
 	uint32_t tickInstCount = 0;
-	uint32_t maxInstCount = MaxInstructions();
-
-	Opcode opcode;
+	uint64_t allocCount = GetThreadAllocationCount();
+	bool result;
 	do
 	{
-		// Read opcode instruction
-		uint8_t opByte;
-		m_execution.back().reader.Read(&opByte);
-		if (opByte >= static_cast<uint32_t>(Opcode::NumOpcodes))
+		m_switchInterpreter = false;
+		result = m_execution.back().program->IsVerified() ?
+			ExecuteInstructions<false>(&tickInstCount) : ExecuteInstructions<true>(&tickInstCount);
+	}
+	while (result && m_switchInterpreter);
+
+	stats->instructionCount += tickInstCount;
+	stats->functionCallCount += m_functionCallCount;
+	stats->nativeCallCount += m_nativeCallCount;
+	stats->allocationCount += GetThreadAllocationCount() - allocCount;
+	++stats->scriptExecutionCount;
+	m_functionCallCount = 0;
+	m_nativeCallCount = 0;
+	return result;
+}
+
+// With computed goto, each handler jumps directly to the next instruction's handler address, stored
+// in the instruction when the program was decoded.  Otherwise, the instruction stores a handler
+// index, and handlers return to a switch statement.
+#ifdef JINX_USE_COMPUTED_GOTO
+#define JX_OPCODE(op) Opcode_##op:
+#define JX_FUSED_OPCODE(op) Fused_##op:
+#define JX_QUICK_OPCODE(op) Quick_##op:
+#define JX_NEXT() do { JX_FETCH(); goto *inst->handler.load(std::memory_order_relaxed); } while (false)
+#else
+#define JX_OPCODE(op) case static_cast<uintptr_t>(Opcode::op):
+#define JX_FUSED_OPCODE(op) case static_cast<uintptr_t>(FusedOpcode::op):
+#define JX_QUICK_OPCODE(op) case static_cast<uintptr_t>(QuickOpcode::op):
+#define JX_NEXT() break
+#endif
+
+// Generic handlers are also jumped to directly when a quickened handler's type guard fails
+#define JX_GENERIC_OPCODE(op) JX_QUICK_OPCODE(op##Generic) Generic_##op:
+
+// Rewrite the current instruction to use the specified quickened handler
+#define JX_QUICKEN(op) inst->handler.store(s_dispatchTable[static_cast<size_t>(QuickOpcode::op)], std::memory_order_relaxed)
+
+// Instructions that begin fused sequences can also be jumped to directly by fused handlers
+#define JX_UNFUSED_OPCODE(op) JX_OPCODE(op) Unfused_##op:
+
+// Permanently rewrite a fused instruction to its original handler, then execute the original sequence
+#define JX_UNFUSE(op) \
+	do { \
+		inst->handler.store(s_dispatchTable[static_cast<size_t>(Opcode::op)], std::memory_order_relaxed); \
+		goto Unfused_##op; \
+	} while (false)
+
+// Skip the remaining instructions of a fused sequence, counting them as executed
+#define JX_SKIP_FUSED(count) \
+	ip += count; \
+	tickInstCount += count
+
+// Fetch the next instruction, stopping without consuming it if the instruction limit is reached
+#define JX_FETCH() \
+	if (tickInstCount >= maxInstCount) \
+		goto MaxInstructions; \
+	++tickInstCount; \
+	inst = ip++
+
+// At loop jumps and calls, yield if the time limit has passed.  Time-limited scripts only read the
+// clock after executing a number of instructions, or after calling a native function.
+#define JX_CHECK_TIME() \
+	do { \
+		if (tickInstCount >= nextTimeCheck) \
+		{ \
+			if (std::chrono::steady_clock::now() >= m_deadline) \
+				goto TimeLimit; \
+			nextTimeCheck = tickInstCount + TimeCheckInterval; \
+		} \
+	} while (false)
+
+// Reference the top two stack values as binary operands, which are operated on in place
+#define JX_BINARY_OPERANDS() \
+	if (Checked && m_stack.size() < 2) \
+	{ \
+		Error("Stack underflow"); \
+		return false; \
+	} \
+	auto & op1 = m_stack[m_stack.size() - 2]; \
+	auto & op2 = m_stack.back()
+
+// Reload cached instruction state after changing execution frames
+#define JX_LOAD_FRAME() \
+	program = m_execution.back().program; \
+	code = program->GetInstructions(); \
+	ip = m_execution.back().ip
+
+// Stop executing after changing execution frames if the new frame's program requires the other interpreter
+#define JX_CHECK_INTERPRETER() \
+	if (program->IsVerified() == Checked) \
+	{ \
+		m_switchInterpreter = true; \
+		*instCount = tickInstCount; \
+		return true; \
+	}
+
+template <bool Checked>
+bool Script::ExecuteInstructions(uint32_t * instCount, const void * const ** dispatchTable)
+{
+#ifdef JINX_USE_COMPUTED_GOTO
+	// Handler addresses, indexed by opcode, followed by fused and quickened opcodes
+	static const void * const s_dispatchTable[] =
+	{
+		&&Opcode_Add,
+		&&Opcode_And,
+		&&Opcode_CallFunc,
+		&&Opcode_Cast,
+		&&Opcode_Decrement,
+		&&Opcode_Divide,
+		&&Opcode_Equals,
+		&&Opcode_EraseProp,
+		&&Opcode_ErasePropElem,
+		&&Opcode_EraseVar,
+		&&Opcode_EraseVarElem,
+		&&Opcode_Exit,
+		&&Opcode_Function,
+		&&Opcode_Greater,
+		&&Opcode_GreaterEq,
+		&&Opcode_Increment,
+		&&Opcode_Jump,
+		&&Opcode_JumpFalse,
+		&&Opcode_JumpTrue,
+		&&Opcode_Less,
+		&&Opcode_LessEq,
+		&&Opcode_Library,
+		&&Opcode_LoopCount,
+		&&Opcode_LoopOver,
+		&&Opcode_Mod,
+		&&Opcode_Multiply,
+		&&Opcode_Not,
+		&&Opcode_NotEquals,
+		&&Opcode_Or,
+		&&Opcode_Pop,
+		&&Opcode_PopCount,
+		&&Opcode_Property,
+		&&Opcode_PushColl,
+		&&Opcode_PushItr,
+		&&Opcode_PushList,
+		&&Opcode_PushProp,
+		&&Opcode_PushPropKeyVal,
+		&&Opcode_PushTop,
+		&&Opcode_PushVar,
+		&&Opcode_PushVarKey,
+		&&Opcode_PushVal,
+		&&Opcode_Return,
+		&&Opcode_ReturnValue,
+		&&Opcode_ScopeBegin,
+		&&Opcode_ScopeEnd,
+		&&Opcode_SetIndex,
+		&&Opcode_SetProp,
+		&&Opcode_SetPropKeyVal,
+		&&Opcode_SetVar,
+		&&Opcode_SetVarKey,
+		&&Opcode_Subtract,
+		&&Opcode_TailCall,
+		&&Opcode_Type,
+		&&Opcode_Wait,
+		&&Opcode_WaitTime,
+		&&Fused_CompareVarValJump,
+		&&Fused_CompareVarVarJump,
+		&&Fused_IncVarByConst,
+		&&Fused_SetVarFromVal,
+		&&Quick_AddInteger,
+		&&Quick_AddNumber,
+		&&Quick_AddGeneric,
+		&&Quick_EqualsInteger,
+		&&Quick_EqualsNumber,
+		&&Quick_EqualsString,
+		&&Quick_EqualsGeneric,
+		&&Quick_IncrementInteger,
+		&&Quick_IncrementNumber,
+		&&Quick_IncrementGeneric,
+		&&Quick_LessInteger,
+		&&Quick_LessNumber,
+		&&Quick_LessGeneric,
+		&&Quick_SubtractInteger,
+		&&Quick_SubtractNumber,
+		&&Quick_SubtractGeneric,
+	};
+
+	static_assert(countof(s_dispatchTable) == static_cast<size_t>(QuickOpcode::NumQuickOpcodes), "Dispatch table doesn't match opcode count");
+#else
+	// Handler indices, stored in instructions in place of handler addresses
+	struct HandlerIndices
+	{
+		HandlerIndices()
 		{
-			Error("Invalid operation in bytecode");
-			return false;
+			for (size_t i = 0; i < countof(handlers); ++i)
+				handlers[i] = reinterpret_cast<const void *>(i);
 		}
-		opcode = static_cast<Opcode>(opByte);
-		++tickInstCount;
-		if (tickInstCount >= maxInstCount)
+		const void * handlers[static_cast<size_t>(QuickOpcode::NumQuickOpcodes)];
+	};
+	static const HandlerIndices s_handlerIndices;
+	static const void * const * s_dispatchTable = s_handlerIndices.handlers;
+#endif
+
+	if (dispatchTable)
+	{
+		*dispatchTable = s_dispatchTable;
+		return true;
+	}
+
+	assert(instCount);
+	uint32_t tickInstCount = *instCount;
+	const uint32_t maxInstCount = MaxInstructions();
+	const bool timeLimited = m_deadline != TimePoint::max();
+	uint32_t nextTimeCheck = timeLimited ? tickInstCount : UINT32_MAX;
+
+	// The current frame's program and instruction pointer are cached in locals while executing
+	const Program * program;
+	const Instruction * code;
+	const Instruction * ip;
+	const Instruction * inst;
+	JX_LOAD_FRAME();
+
+#ifdef JINX_USE_COMPUTED_GOTO
+	JX_NEXT();
+#else
+	for (;;)
+	{
+		JX_FETCH();
+		switch (reinterpret_cast<uintptr_t>(inst->handler.load(std::memory_order_relaxed)))
 		{
-			if (ErrorOnMaxInstrunction())
+#endif
+			JX_OPCODE(Add)
 			{
-				Error("Exceeded max instruction count");
-				return false;
+				JX_BINARY_OPERANDS();
+				if (op1.m_type == ValueType::Integer && op2.m_type == ValueType::Integer)
+					JX_QUICKEN(AddInteger);
+				else if (op1.m_type == ValueType::Number && op2.m_type == ValueType::Number)
+					JX_QUICKEN(AddNumber);
+				else
+					JX_QUICKEN(AddGeneric);
+				goto Generic_Add;
 			}
-			return true;
-		}
-
-		// Execute the current opcode
-		switch (opcode)
-		{
-			case Opcode::Add:
+			JX_GENERIC_OPCODE(Add)
 			{
-				auto op2 = Pop();
-				auto op1 = Pop();
-				auto result = op1 + op2;
-				if (result.IsNull())
+				JX_BINARY_OPERANDS();
+				if (op1.IsString())
+					op1 += op2;
+				else
+					op1 = op1 + op2;
+				m_stack.pop_back();
+				if (op1.IsNull())
 				{
 					Error("Invalid variable for addition");
 					return false;
 				}
-				Push(result);
 			}
-			break;
-			case Opcode::And:
+			JX_NEXT();
+			JX_QUICK_OPCODE(AddInteger)
 			{
-				auto op2 = Pop();
-				auto op1 = Pop();
-				auto result = op1.GetBoolean() && op2.GetBoolean();
-				Push(result);
+				JX_BINARY_OPERANDS();
+				if (op1.m_type != ValueType::Integer || op2.m_type != ValueType::Integer)
+				{
+					JX_QUICKEN(AddGeneric);
+					goto Generic_Add;
+				}
+				op1.m_integer += op2.m_integer;
+				m_stack.pop_back();
 			}
-			break;
-			case Opcode::CallFunc:
+			JX_NEXT();
+			JX_QUICK_OPCODE(AddNumber)
 			{
-				RuntimeID id;
-				m_execution.back().reader.Read(&id, sizeof(id));
-				auto functionDef = m_runtime->FindFunction(id);
+				JX_BINARY_OPERANDS();
+				if (op1.m_type != ValueType::Number || op2.m_type != ValueType::Number)
+				{
+					JX_QUICKEN(AddGeneric);
+					goto Generic_Add;
+				}
+				op1.m_number += op2.m_number;
+				m_stack.pop_back();
+			}
+			JX_NEXT();
+			JX_OPCODE(And)
+			{
+				JX_BINARY_OPERANDS();
+				op1 = op1.GetBoolean() && op2.GetBoolean();
+				m_stack.pop_back();
+			}
+			JX_NEXT();
+			JX_OPCODE(CallFunc)
+			{
+				auto functionDef = GetCallFunction(program, inst);
 				if (!functionDef)
+					return false;
+				if (Checked && m_stack.size() < functionDef->GetParameterCount())
 				{
-					Error("Could not find function definition");
+					Error("Stack underflow");
 					return false;
 				}
 				// Check to see if this is a bytecode function
-				if (functionDef->GetBytecode())
+				if (functionDef->GetProgram())
 				{
-					m_execution.push_back(ExecutionFrame(functionDef->GetBytecode()));
-					m_execution.back().reader.Seek(functionDef->GetOffset());
+					m_execution.back().ip = ip;
+					PushFrame(functionDef->GetProgram().get(), functionDef->GetEntry(), functionDef->GetParameterCount());
+					++m_functionCallCount;
+					JX_LOAD_FRAME();
 				}
 				// Otherwise, call a native function callback
-				else if (functionDef->GetCallback())
+				else
 				{
-					Parameters params;
-					size_t numParams = functionDef->GetParameterCount();
-					for (size_t i = 0; i < numParams; ++i)
+					if (!CallNative(functionDef))
+						return false;
+					if (m_asyncCall)
 					{
-						size_t index = m_stack.size() - (numParams - i);
-						auto param = m_stack[index];
-						params.push_back(param);
+						m_execution.back().ip = ip;
+						*instCount = tickInstCount;
+						return true;
 					}
-					for (size_t i = 0; i < numParams; ++i)
-						m_stack.pop_back();			
-					Variant retVal = functionDef->GetCallback()(shared_from_this(), params);
-					if (functionDef->HasReturnParameter())
-						Push(retVal);
+					if (timeLimited)
+						nextTimeCheck = tickInstCount;
 				}
-				else
-				{
-					Error("Error in function definition");
-					return false;
-				}
-				m_execution.back().stackTop = m_stack.size() - functionDef->GetParameterCount();
+				JX_CHECK_TIME();
+				JX_CHECK_INTERPRETER();
 			}
-			break;
-			case Opcode::Cast:
+			JX_NEXT();
+			JX_OPCODE(Cast)
 			{
-				uint8_t b;
-				m_execution.back().reader.Read(&b);
-				auto type = ByteToValueType(b);
 				assert(!m_stack.empty());
-				m_stack.back().ConvertTo(type);
+				m_stack.back().ConvertTo(inst->type);
 			}
-			break;
-			case Opcode::Decrement:
+			JX_NEXT();
+			JX_OPCODE(Decrement)
 			{
-				auto op1 = Pop();
-				auto op2 = Pop();
-				op2 -= op1;
-				Push(op2);
+				JX_BINARY_OPERANDS();
+				op1 -= op2;
+				m_stack.pop_back();
 			}
-			break;
-			case Opcode::EraseProp:
+			JX_NEXT();
+			JX_OPCODE(EraseProp)
 			{
-				RuntimeID propId;
-				m_execution.back().reader.Read(&propId);
-				auto var = m_runtime->GetProperty(propId);
+				auto property = m_runtime->FindProperty(program->GetPropertySite(inst->operand), inst->id);
+				auto var = property ? property->Get() : Variant();
 				if (var.IsCollectionItr())
 				{
 					auto itr = var.GetCollectionItr().first;
 					auto coll = var.GetCollectionItr().second;
 					if (itr != coll->end())
 						itr = coll->erase(itr);
-					m_runtime->SetProperty(propId, std::make_pair(itr, coll));
+					property->Set(std::make_pair(itr, coll));
 				}
 			}
-			break;
-			case Opcode::ErasePropElem:
+			JX_NEXT();
+			JX_OPCODE(ErasePropElem)
 			{
-				RuntimeID propId;
-				m_execution.back().reader.Read(&propId);
-				auto var = m_runtime->GetProperty(propId);
-				if (var.IsCollectionItr())
+				auto property = m_runtime->FindProperty(program->GetPropertySite(inst->operand), inst->id);
+				auto var = property ? property->Get() : Variant();
+				auto key = Pop<Checked>();
+				if (var.IsCollection())
 				{
-					auto itr = var.GetCollectionItr().first;
-					auto coll = var.GetCollectionItr().second;
+					if (!key.IsKeyType())
+					{
+						Error("Invalid key type");
+						return false;
+					}
+					auto coll = var.GetCollection();
+					auto itr = coll->find(key);
 					if (itr != coll->end())
-						itr = coll->erase(itr);
-					m_runtime->SetProperty(propId, std::make_pair(itr, coll));
+						coll->erase(itr);
 				}
 			}
-			break;
-			case Opcode::EraseVar:
+			JX_NEXT();
+			JX_OPCODE(EraseVar)
 			{
-				String name;
-				m_execution.back().reader.Read(&name);
-				auto var = GetVariable(name);
+				auto var = GetSlot(inst->operand);
 				if (var.IsCollectionItr())
 				{
 					auto itr = var.GetCollectionItr().first;
 					auto coll = var.GetCollectionItr().second;
 					if (itr != coll->end())
 						itr = coll->erase(itr);
-					SetVariableInternal(name, std::make_pair(itr, coll));
+					SetSlot(inst->operand, std::make_pair(itr, coll));
 				}
 			}
-			break;
-			case Opcode::EraseVarElem:
+			JX_NEXT();
+			JX_OPCODE(EraseVarElem)
 			{
-				String name;
-				m_execution.back().reader.Read(&name);
-				auto var = GetVariable(name);
-				auto key = Pop();
+				auto var = GetSlot(inst->operand);
+				auto key = Pop<Checked>();
 				if (var.IsCollection())
 				{
 					if (!key.IsKeyType())
@@ -249,130 +580,244 @@ bool Script::Execute()
 						coll->erase(itr);
 				}
 			}
-			break;
-			case Opcode::Divide:
+			JX_NEXT();
+			JX_OPCODE(Divide)
 			{
-				auto op2 = Pop();
-				auto op1 = Pop();
+				JX_BINARY_OPERANDS();
 				if (op2.GetNumber() == 0.0)
 				{
 					Error("Divide by zero");
 					return false;
 				}
-				auto result = op1 / op2;
-				if (result.IsNull())
+				op1 = op1 / op2;
+				m_stack.pop_back();
+				if (op1.IsNull())
 				{
 					Error("Invalid variable for division");
 					return false;
 				}
-				Push(result);
 			}
-			break;
-			case Opcode::Equals:
+			JX_NEXT();
+			JX_OPCODE(Equals)
+			{
+				JX_BINARY_OPERANDS();
+				if (op1.m_type == ValueType::Integer && op2.m_type == ValueType::Integer)
+					JX_QUICKEN(EqualsInteger);
+				else if (op1.m_type == ValueType::Number && op2.m_type == ValueType::Number)
+					JX_QUICKEN(EqualsNumber);
+				else if (op1.m_type == ValueType::String && op2.m_type == ValueType::String)
+					JX_QUICKEN(EqualsString);
+				else
+					JX_QUICKEN(EqualsGeneric);
+				goto Generic_Equals;
+			}
+			JX_GENERIC_OPCODE(Equals)
 			{
-				auto op2 = Pop();
-				auto op1 = Pop();
-				auto result = op1 == op2;
-				Push(result);
+				JX_BINARY_OPERANDS();
+				op1 = op1 == op2;
+				m_stack.pop_back();
 			}
-			break;
-			case Opcode::Exit:
+			JX_NEXT();
+			JX_QUICK_OPCODE(EqualsInteger)
+			{
+				JX_BINARY_OPERANDS();
+				if (op1.m_type != ValueType::Integer || op2.m_type != ValueType::Integer)
+				{
+					JX_QUICKEN(EqualsGeneric);
+					goto Generic_Equals;
+				}
+				op1.m_boolean = op1.m_integer == op2.m_integer;
+				op1.m_type = ValueType::Boolean;
+				m_stack.pop_back();
+			}
+			JX_NEXT();
+			JX_QUICK_OPCODE(EqualsNumber)
+			{
+				JX_BINARY_OPERANDS();
+				if (op1.m_type != ValueType::Number || op2.m_type != ValueType::Number)
+				{
+					JX_QUICKEN(EqualsGeneric);
+					goto Generic_Equals;
+				}
+				op1.m_boolean = op1.m_number == op2.m_number;
+				op1.m_type = ValueType::Boolean;
+				m_stack.pop_back();
+			}
+			JX_NEXT();
+			JX_QUICK_OPCODE(EqualsString)
+			{
+				JX_BINARY_OPERANDS();
+				if (op1.m_type != ValueType::String || op2.m_type != ValueType::String)
+				{
+					JX_QUICKEN(EqualsGeneric);
+					goto Generic_Equals;
+				}
+				op1.SetBoolean(op1.m_string == op2.m_string);
+				m_stack.pop_back();
+			}
+			JX_NEXT();
+			JX_OPCODE(Exit)
 			{
 				m_finished = true;
+				m_execution.back().ip = ip;
+				*instCount = tickInstCount;
+				return true;
 			}
-			break;
-			case Opcode::Function:
+			JX_OPCODE(Function)
 			{
-				FunctionSignature signature;	
-				signature.Read(m_execution.back().reader);
+				const auto & signature = program->GetSignature(inst->operand);
 				if (signature.GetVisibility() != VisibilityType::Local)
 					m_library->Functions().Register(signature, false);
-				// Note: we add 5 bytes to the current position to skip over the jump command and offset value
-				m_runtime->RegisterFunction(signature, m_execution.back().bytecode, m_execution.back().reader.Tell() + 5);
+				// Note: the function body begins after the jump instruction following this one.  Functions
+				// are only defined at the root level, so this is always the script's own program.
+				assert(program == m_program.get());
+				m_runtime->RegisterFunction(signature, m_program, (inst - code) + 2);
 			}
-			break;
-			case Opcode::Greater:
+			JX_NEXT();
+			JX_OPCODE(Greater)
 			{
-				auto op2 = Pop();
-				auto op1 = Pop();
-				auto result = op1 > op2;
-				Push(result);
+				JX_BINARY_OPERANDS();
+				op1 = op1 > op2;
+				m_stack.pop_back();
 			}
-			break;
-			case Opcode::GreaterEq:
+			JX_NEXT();
+			JX_OPCODE(GreaterEq)
 			{
-				auto op2 = Pop();
-				auto op1 = Pop();
-				auto result = op1 >= op2;
-				Push(result);
+				JX_BINARY_OPERANDS();
+				op1 = op1 >= op2;
+				m_stack.pop_back();
 			}
-			break;
-			case Opcode::Increment:
+			JX_NEXT();
+			JX_OPCODE(Increment)
 			{
-				auto op1 = Pop();
-				auto op2 = Pop();
-				op2 += op1;
-				Push(op2);
+				JX_BINARY_OPERANDS();
+				if (op1.m_type == ValueType::Integer && op2.m_type == ValueType::Integer)
+					JX_QUICKEN(IncrementInteger);
+				else if (op1.m_type == ValueType::Number && op2.m_type == ValueType::Number)
+					JX_QUICKEN(IncrementNumber);
+				else
+					JX_QUICKEN(IncrementGeneric);
+				goto Generic_Increment;
 			}
-			break;
-			case Opcode::Jump:
+			JX_GENERIC_OPCODE(Increment)
 			{
-				uint32_t jumpIndex;
-				m_execution.back().reader.Read(&jumpIndex);
-				m_execution.back().reader.Seek(jumpIndex);
+				JX_BINARY_OPERANDS();
+				op1 += op2;
+				m_stack.pop_back();
 			}
-			break;
-			case Opcode::JumpFalse:
+			JX_NEXT();
+			JX_QUICK_OPCODE(IncrementInteger)
+			{
+				JX_BINARY_OPERANDS();
+				if (op1.m_type != ValueType::Integer || op2.m_type != ValueType::Integer)
+				{
+					JX_QUICKEN(IncrementGeneric);
+					goto Generic_Increment;
+				}
+				op1.m_integer += op2.m_integer;
+				m_stack.pop_back();
+			}
+			JX_NEXT();
+			JX_QUICK_OPCODE(IncrementNumber)
 			{
-				uint32_t jumpIndex;
-				m_execution.back().reader.Read(&jumpIndex);
-				auto op1 = Pop();
+				JX_BINARY_OPERANDS();
+				if (op1.m_type != ValueType::Number || op2.m_type != ValueType::Number)
+				{
+					JX_QUICKEN(IncrementGeneric);
+					goto Generic_Increment;
+				}
+				op1.m_number += op2.m_number;
+				m_stack.pop_back();
+			}
+			JX_NEXT();
+			JX_OPCODE(Jump)
+			{
+				ip = code + inst->operand;
+				JX_CHECK_TIME();
+			}
+			JX_NEXT();
+			JX_OPCODE(JumpFalse)
+			{
+				auto op1 = Pop<Checked>();
 				if (op1.GetBoolean() == false)
 				{
-					m_execution.back().reader.Seek(jumpIndex);
+					ip = code + inst->operand;
+					JX_CHECK_TIME();
 				}
 			}
-			break;
-			case Opcode::JumpTrue:
+			JX_NEXT();
+			JX_OPCODE(JumpTrue)
 			{
-				uint32_t jumpIndex;
-				m_execution.back().reader.Read(&jumpIndex);
-				auto op1 = Pop();
+				auto op1 = Pop<Checked>();
 				if (op1.GetBoolean() == true)
 				{
-					m_execution.back().reader.Seek(jumpIndex);
+					ip = code + inst->operand;
+					JX_CHECK_TIME();
 				}
 			}
-			break;
-			case Opcode::Less:
+			JX_NEXT();
+			JX_OPCODE(Less)
 			{
-				auto op2 = Pop();
-				auto op1 = Pop();
-				auto result = op1 < op2;
-				Push(result);
+				JX_BINARY_OPERANDS();
+				if (op1.m_type == ValueType::Integer && op2.m_type == ValueType::Integer)
+					JX_QUICKEN(LessInteger);
+				else if (op1.m_type == ValueType::Number && op2.m_type == ValueType::Number)
+					JX_QUICKEN(LessNumber);
+				else
+					JX_QUICKEN(LessGeneric);
+				goto Generic_Less;
 			}
-			break;
-			case Opcode::LessEq:
+			JX_GENERIC_OPCODE(Less)
 			{
-				auto op2 = Pop();
-				auto op1 = Pop();
-				auto result = op1 <= op2;
-				Push(result);
+				JX_BINARY_OPERANDS();
+				op1 = op1 < op2;
+				m_stack.pop_back();
 			}
-			break;
-			case Opcode::Library:
+			JX_NEXT();
+			JX_QUICK_OPCODE(LessInteger)
 			{
-				String libraryName;
-				m_execution.back().reader.Read(&libraryName);
-				m_library = m_runtime->GetLibraryInternal(libraryName);
+				JX_BINARY_OPERANDS();
+				if (op1.m_type != ValueType::Integer || op2.m_type != ValueType::Integer)
+				{
+					JX_QUICKEN(LessGeneric);
+					goto Generic_Less;
+				}
+				op1.m_boolean = op1.m_integer < op2.m_integer;
+				op1.m_type = ValueType::Boolean;
+				m_stack.pop_back();
 			}
-			break;
-			case Opcode::LoopCount:
+			JX_NEXT();
+			JX_QUICK_OPCODE(LessNumber)
+			{
+				JX_BINARY_OPERANDS();
+				if (op1.m_type != ValueType::Number || op2.m_type != ValueType::Number)
+				{
+					JX_QUICKEN(LessGeneric);
+					goto Generic_Less;
+				}
+				op1.m_boolean = op1.m_number < op2.m_number;
+				op1.m_type = ValueType::Boolean;
+				m_stack.pop_back();
+			}
+			JX_NEXT();
+			JX_OPCODE(LessEq)
+			{
+				JX_BINARY_OPERANDS();
+				op1 = op1 <= op2;
+				m_stack.pop_back();
+			}
+			JX_NEXT();
+			JX_OPCODE(Library)
+			{
+				m_library = m_runtime->GetLibraryInternal(program->GetLibraryName(inst->operand));
+			}
+			JX_NEXT();
+			JX_OPCODE(LoopCount)
 			{
 				assert(m_stack.size() >= 3);
 				auto top = m_stack.size() - 1;
-				auto op1 = m_stack[top - 2];
-				auto op2 = m_stack[top - 1];
+				auto & op1 = m_stack[top - 2];
+				const auto & op2 = m_stack[top - 1];
 				auto op3 = m_stack[top];
 				if (op3.IsNull())
 				{
@@ -382,7 +827,6 @@ bool Script::Execute()
 						op3 = 1;
 				}
 				op1 += op3;
-				m_stack[top - 2] = op1;
 				auto incVal = op3.GetNumber();
 				if (incVal > 0)
 					Push(op1 <= op2);
@@ -394,153 +838,149 @@ bool Script::Execute()
 					return false;
 				}
 			}
-			break;
-			case Opcode::LoopOver:
+			JX_NEXT();
+			JX_OPCODE(LoopOver)
 			{
 				assert(m_stack.size() >= 3);
 				auto top = m_stack.size() - 1;
-				auto itr = m_stack[top];
+				auto & itr = m_stack[top];
 				assert(itr.IsCollectionItr());
-				auto coll = m_stack[top - 1];
+				const auto & coll = m_stack[top - 1];
 				assert(coll.IsCollection() && coll.GetCollection());
-				bool finished = itr.GetCollectionItr().first == coll.GetCollection()->end();
+				auto end = coll.GetCollection()->end();
+				bool finished = itr.GetCollectionItr().first == end;
 				if (!finished)
 				{
 					++itr;
-					finished = itr.GetCollectionItr().first == coll.GetCollection()->end();
+					finished = itr.GetCollectionItr().first == end;
 				}
-				m_stack[top] = itr;
 				Push(finished);
 			}
-			break;
-			case Opcode::Mod:
+			JX_NEXT();
+			JX_OPCODE(Mod)
 			{
-				auto op2 = Pop();
-				auto op1 = Pop();
+				JX_BINARY_OPERANDS();
 				if (op2.GetNumber() == 0.0)
 				{
 					Error("Mod by zero");
 					return false;
 				}
-				auto result = op1 % op2;
-				if (result.IsNull())
+				op1 = op1 % op2;
+				m_stack.pop_back();
+				if (op1.IsNull())
 				{
 					Error("Invalid variable for mod");
 					return false;
 				}
-				Push(result);
 			}
-			break;
-			case Opcode::Multiply:
+			JX_NEXT();
+			JX_OPCODE(Multiply)
 			{
-				auto op2 = Pop();
-				auto op1 = Pop();
-				auto result = op1 * op2;
-				if (result.IsNull())
+				JX_BINARY_OPERANDS();
+				op1 = op1 * op2;
+				m_stack.pop_back();
+				if (op1.IsNull())
 				{
 					Error("Invalid variable for mod");
 					return false;
 				}
-				Push(result);
 			}
-			break;
-			case Opcode::Not:
+			JX_NEXT();
+			JX_OPCODE(Not)
 			{
-				auto op1 = Pop();
-				auto result = !op1.GetBoolean();
-				Push(result);
+				if (Checked && m_stack.empty())
+				{
+					Error("Stack underflow");
+					return false;
+				}
+				auto & op1 = m_stack.back();
+				op1 = !op1.GetBoolean();
 			}
-			break;
-			case Opcode::NotEquals:
+			JX_NEXT();
+			JX_OPCODE(NotEquals)
 			{
-				auto op2 = Pop();
-				auto op1 = Pop();
-				auto result = op1 != op2;
-				Push(result);
+				JX_BINARY_OPERANDS();
+				op1 = op1 != op2;
+				m_stack.pop_back();
 			}
-			break;
-			case Opcode::Or:
+			JX_NEXT();
+			JX_OPCODE(Or)
 			{
-				auto op2 = Pop();
-				auto op1 = Pop();
-				auto result = op1.GetBoolean() || op2.GetBoolean();
-				Push(result);
+				JX_BINARY_OPERANDS();
+				op1 = op1.GetBoolean() || op2.GetBoolean();
+				m_stack.pop_back();
 			}
-			break;
-			case Opcode::Pop:
+			JX_NEXT();
+			JX_OPCODE(Pop)
 			{
-				Pop();
+				if (Checked && m_stack.empty())
+				{
+					Error("Stack underflow");
+					return false;
+				}
+				m_stack.pop_back();
 			}
-			break;
-			case Opcode::PopCount:
+			JX_NEXT();
+			JX_OPCODE(PopCount)
 			{
-				uint32_t count;
-				m_execution.back().reader.Read(&count);
-				for (uint32_t i = 0; i < count; ++i)
-					Pop();
+				if (Checked && inst->operand > m_stack.size())
+				{
+					Error("Stack underflow");
+					return false;
+				}
+				m_stack.resize(m_stack.size() - inst->operand);
 			}
-			break;
-			case Opcode::Property:
+			JX_NEXT();
+			JX_OPCODE(Property)
 			{
-				PropertyName propertyName;
-				propertyName.Read(m_execution.back().reader);
+				const auto & propertyName = program->GetPropertyName(inst->operand);
 				m_library->RegisterPropertyName(propertyName, false);
 				m_runtime->SetProperty(propertyName.GetId(), propertyName.GetDefaultValue());
 			}
-			break;
-			case Opcode::PushColl:
+			JX_NEXT();
+			JX_OPCODE(PushColl)
 			{
-				uint32_t count;
-				m_execution.back().reader.Read(&count);
-				Variant collection(CreateCollection());
+				uint32_t count = inst->operand;
+				auto collection = CreateCollection();
 				for (uint32_t i = 0; i < count; ++i)
 				{
 					size_t offset = (count - i) * 2;
-					if (offset > m_stack.size())
+					if (Checked && offset > m_stack.size())
 					{
 						Error("Collection data error");
 						return false;
 					}
 					size_t index = m_stack.size() - offset;
-					if ((index + 1) > m_stack.size())
-					{
-						Error("Error in collection data");
-						return false;
-					}
-					Variant key = m_stack[index];
-					if (!key.IsKeyType())
+					if (!m_stack[index].IsKeyType())
 					{
 						Error("Invalid key type");
 						return false;
 					}
-					Variant value = m_stack[index + 1];
-					collection.GetCollection()->insert(std::make_pair(key, value));
+					collection->insert(std::make_pair(std::move(m_stack[index]), std::move(m_stack[index + 1])));
 				}
-				for (uint32_t i = 0; i < count * 2; ++i)
-					m_stack.pop_back();
-				Push(collection);
+				m_stack.resize(m_stack.size() - count * 2);
+				Push(std::move(collection));
 			}
-			break;
-			case Opcode::PushItr:
+			JX_NEXT();
+			JX_OPCODE(PushItr)
 			{
 				assert(m_stack.size() >= 1);
 				auto top = m_stack.size() - 1;
-				auto coll = m_stack[top];
-				if (!coll.IsCollection())
+				if (!m_stack[top].IsCollection())
 				{
 					Error("Expected collection type");
 					return false;
 				}
-				Variant itr = std::make_pair(coll.GetCollection()->begin(), coll.GetCollection());
-				Push(itr);
+				auto coll = m_stack[top].GetCollection();
+				auto begin = coll->begin();
+				Push(std::make_pair(begin, std::move(coll)));
 			}
-			break;
-			case Opcode::PushList:
+			JX_NEXT();
+			JX_OPCODE(PushList)
 			{
-				uint32_t count;
-				m_execution.back().reader.Read(&count);
-				Variant collection(CreateCollection());
-				if (count > m_stack.size())
+				uint32_t count = inst->operand;
+				auto collection = CreateCollection();
+				if (Checked && count > m_stack.size())
 				{
 					Error("Push list error");
 					return false;
@@ -548,53 +988,45 @@ bool Script::Execute()
 				for (uint32_t i = 0; i < count; ++i)
 				{
 					size_t index = m_stack.size() - (count - i);
-					Variant value = m_stack[index];
-					Variant key(static_cast<int64_t>(i) + 1);
-					collection.GetCollection()->insert(std::make_pair(key, value));
+					collection->insert(std::make_pair(Variant(static_cast<int64_t>(i) + 1), std::move(m_stack[index])));
 				}
-				for (uint32_t i = 0; i < count; ++i)
-					m_stack.pop_back();
-				Push(collection);
+				m_stack.resize(m_stack.size() - count);
+				Push(std::move(collection));
 			}
-			break;
-			case Opcode::PushProp:
+			JX_NEXT();
+			JX_OPCODE(PushProp)
 			{
-				uint64_t id;
-				m_execution.back().reader.Read(&id);
-				auto val = m_runtime->GetProperty(id);
-				Push(val);
+				auto property = m_runtime->FindProperty(program->GetPropertySite(inst->operand), inst->id);
+				Push(property ? property->Get() : Variant());
 			}
-			break;
-			case Opcode::PushPropKeyVal:
+			JX_NEXT();
+			JX_OPCODE(PushPropKeyVal)
 			{
-				uint64_t id;
-				m_execution.back().reader.Read(&id);
-				auto key = Pop();
-				auto var = m_runtime->GetPropertyKeyValue(id, key);
-				Push(var);
+				if (Checked && m_stack.empty())
+				{
+					Error("Stack underflow");
+					return false;
+				}
+				auto property = m_runtime->FindProperty(program->GetPropertySite(inst->operand), inst->id);
+				auto & top = m_stack.back();
+				top = property ? property->GetKeyValue(top) : Variant();
 			}
-			break;
-			case Opcode::PushTop:
+			JX_NEXT();
+			JX_OPCODE(PushTop)
 			{
 				assert(m_stack.size() >= 1);
-				auto op = m_stack[m_stack.size() - 1];
-				Push(op);
+				m_stack.push_back(m_stack.back());
 			}
-			break;
-			case Opcode::PushVar:
+			JX_NEXT();
+			JX_UNFUSED_OPCODE(PushVar)
 			{
-				String name;
-				m_execution.back().reader.Read(&name);
-				auto var = GetVariable(name);
-				Push(var);
+				Push(GetSlot(inst->operand));
 			}
-			break;
-			case Opcode::PushVarKey:
+			JX_NEXT();
+			JX_OPCODE(PushVarKey)
 			{
-				String name;
-				m_execution.back().reader.Read(&name);
-				auto var = GetVariable(name);
-				auto key = Pop();
+				auto var = GetSlot(inst->operand);
+				auto key = Pop<Checked>();
 				if (!var.IsCollection())
 				{
 					Error("Expected collection when accessing by key");
@@ -613,150 +1045,299 @@ bool Script::Execute()
 					}
 				}
 			}
-			break;
-			case Opcode::PushVal:
+			JX_NEXT();
+			JX_OPCODE(PushVal)
 			{
-				Variant val;
-				val.Read(m_execution.back().reader);
-				Push(val);
+				Push(program->GetConstant(inst->operand));
 			}
-			break;
-			case Opcode::Return:
+			JX_NEXT();
+			JX_OPCODE(Return)
 			{
-				assert(!m_execution.empty());
-				size_t targetSize = m_execution.back().stackTop;
-				m_execution.pop_back();
-				assert(!m_execution.empty());
-				while (m_stack.size() > targetSize)
-					m_stack.pop_back();
+				if (Checked && m_execution.size() < 2)
+				{
+					Error("Invalid return");
+					return false;
+				}
+				PopFrame();
+				JX_LOAD_FRAME();
+				JX_CHECK_INTERPRETER();
 			}
-			break;
-			case Opcode::ReturnValue:
-			{
-				auto val = Pop();
-				assert(!m_execution.empty());
-				size_t targetSize = m_execution.back().stackTop;
-				m_execution.pop_back();
-				assert(!m_execution.empty());
-				while (m_stack.size() > targetSize)
-					m_stack.pop_back();
-				Push(val);
+			JX_NEXT();
+			JX_OPCODE(ReturnValue)
+			{
+				if (Checked && (m_stack.empty() || m_execution.size() < 2))
+				{
+					Error("Invalid return");
+					return false;
+				}
+				auto val = Pop<Checked>();
+				PopFrame();
+				Push(std::move(val));
+				JX_LOAD_FRAME();
+				JX_CHECK_INTERPRETER();
 			}
-			break;
-			case Opcode::ScopeBegin:
+			JX_NEXT();
+			JX_OPCODE(ScopeBegin)
 			{
-				ScopeFrame frame;
-				frame.stackTop = m_stack.size();
-				m_execution.back().names.push_back(frame);
+				ScopeFrame scope;
+				scope.stackTop = m_stack.size();
+				scope.declaredTop = m_declared.size();
+				m_scopes.push_back(scope);
 			}
-			break;
-			case Opcode::ScopeEnd:
+			JX_NEXT();
+			JX_OPCODE(ScopeEnd)
 			{
-				auto stackTop = m_execution.back().names.back().stackTop;
-				m_execution.back().names.pop_back();
-				while (m_stack.size() > stackTop)
+				if (Checked && m_scopes.size() <= m_execution.back().scopeBase)
+				{
+					Error("Scope underflow");
+					return false;
+				}
+				assert(m_scopes.size() > m_execution.back().scopeBase);
+				auto scope = m_scopes.back();
+				m_scopes.pop_back();
+				for (size_t i = scope.declaredTop; i < m_declared.size(); ++i)
+					m_slots[m_declared[i]] = InvalidIndex;
+				m_declared.resize(scope.declaredTop);
+				while (m_stack.size() > scope.stackTop)
 					m_stack.pop_back();
 			}
-			break;
-			case Opcode::SetIndex:
+			JX_NEXT();
+			JX_OPCODE(SetIndex)
 			{
 				assert(!m_stack.empty());
-				String name;
-				m_execution.back().reader.Read(&name);
-				int32_t stackIndex;
-				m_execution.back().reader.Read(&stackIndex);
-				ValueType type;
-				m_execution.back().reader.Read<ValueType, uint8_t>(&type);
-				size_t index = m_stack.size() + stackIndex;
-				if (type != ValueType::Any)
-				{
-					if (!m_stack[index].ConvertTo(type))
+				size_t index = m_stack.size() + inst->index;
+				if (inst->type != ValueType::Any)
+				{
+					if (!m_stack[index].ConvertTo(inst->type))
 					{
 						Error("Invalid function parameter cast");
 						return false;
 					}
 				}
-				SetVariableAtIndex(name, index);
+				SetSlotIndex(inst->operand, index);
 			}
-			break;
-			case Opcode::SetProp:
+			JX_NEXT();
+			JX_OPCODE(SetProp)
 			{
-				RuntimeID id;
-				m_execution.back().reader.Read(&id);
-				Variant val = Pop();
-				m_runtime->SetProperty(id, val);
+				// Properties not yet declared are added to the runtime when first set
+				auto property = m_runtime->FindProperty(program->GetPropertySite(inst->operand), inst->id);
+				if (property)
+					property->Set(Pop<Checked>());
+				else
+					m_runtime->SetProperty(inst->id, Pop<Checked>());
 			}
-			break;
-			case Opcode::SetPropKeyVal:
+			JX_NEXT();
+			JX_OPCODE(SetPropKeyVal)
 			{
-				RuntimeID id;
-				m_execution.back().reader.Read(&id);
-				Variant val = Pop();
-				Variant key = Pop();
+				Variant val = Pop<Checked>();
+				Variant key = Pop<Checked>();
 				if (!key.IsKeyType())
 				{
 					Error("Invalid key type");
-					break;
+					JX_NEXT();
 				}
-				if (!m_runtime->SetPropertyKeyValue(id, key, val))
+				auto property = m_runtime->FindProperty(program->GetPropertySite(inst->operand), inst->id);
+				if (!property || !property->SetKeyValue(key, val))
 				{
 					Error("Expected collection when accessing by key");
-					break;
+					JX_NEXT();
 				}
 			}
-			break;
-			case Opcode::SetVar:
+			JX_NEXT();
+			JX_OPCODE(SetVar)
 			{
-				String name;
-				m_execution.back().reader.Read(&name);
-				Variant val = Pop();
-				SetVariableInternal(name, val);
+				SetSlot(inst->operand, Pop<Checked>());
 			}
-			break;
-			case Opcode::SetVarKey:
+			JX_NEXT();
+			JX_OPCODE(SetVarKey)
 			{
-				String name;
-				m_execution.back().reader.Read(&name);
-				Variant val = Pop();
-				Variant key = Pop();
+				Variant val = Pop<Checked>();
+				Variant key = Pop<Checked>();
 				if (!key.IsKeyType())
 				{
 					Error("Invalid key type");
-					break;
+					JX_NEXT();
 				}
-				Variant prop = GetVariable(name);
+				Variant prop = GetSlot(inst->operand);
 				if (!prop.IsCollection())
 				{
 					Error("Expected collection when accessing by key");
-					break;
+					JX_NEXT();
 				}
 				auto collection = prop.GetCollection();
-				(*collection)[key] = val;
+				(*collection)[std::move(key)] = std::move(val);
 			}
-			break;
-			case Opcode::Subtract:
+			JX_NEXT();
+			JX_OPCODE(Subtract)
+			{
+				JX_BINARY_OPERANDS();
+				if (op1.m_type == ValueType::Integer && op2.m_type == ValueType::Integer)
+					JX_QUICKEN(SubtractInteger);
+				else if (op1.m_type == ValueType::Number && op2.m_type == ValueType::Number)
+					JX_QUICKEN(SubtractNumber);
+				else
+					JX_QUICKEN(SubtractGeneric);
+				goto Generic_Subtract;
+			}
+			JX_GENERIC_OPCODE(Subtract)
 			{
-				auto op2 = Pop();
-				auto op1 = Pop();
-				auto result = op1 - op2;
-				if (result.IsNull())
+				JX_BINARY_OPERANDS();
+				op1 = op1 - op2;
+				m_stack.pop_back();
+				if (op1.IsNull())
 				{
 					Error("Invalid variable for subraction");
 					return false;
 				}
-				Push(result);
 			}
-			break;
-			case Opcode::Type:
+			JX_NEXT();
+			JX_QUICK_OPCODE(SubtractInteger)
 			{
-				auto val = Pop();
-				Push(val.GetType());
+				JX_BINARY_OPERANDS();
+				if (op1.m_type != ValueType::Integer || op2.m_type != ValueType::Integer)
+				{
+					JX_QUICKEN(SubtractGeneric);
+					goto Generic_Subtract;
+				}
+				op1.m_integer -= op2.m_integer;
+				m_stack.pop_back();
 			}
-			break;
-			case Opcode::Wait:
+			JX_NEXT();
+			JX_QUICK_OPCODE(SubtractNumber)
 			{
+				JX_BINARY_OPERANDS();
+				if (op1.m_type != ValueType::Number || op2.m_type != ValueType::Number)
+				{
+					JX_QUICKEN(SubtractGeneric);
+					goto Generic_Subtract;
+				}
+				op1.m_number -= op2.m_number;
+				m_stack.pop_back();
 			}
-			break;
+			JX_NEXT();
+			JX_OPCODE(TailCall)
+			{
+				// Calls returning a function's result reuse the calling function's frame
+				auto functionDef = GetCallFunction(program, inst);
+				if (!functionDef)
+					return false;
+				if (Checked && (m_stack.size() < functionDef->GetParameterCount() || m_execution.size() < 2))
+				{
+					Error("Invalid tail call");
+					return false;
+				}
+				if (functionDef->GetProgram())
+				{
+					ReplaceFrame(functionDef->GetProgram().get(), functionDef->GetEntry(), functionDef->GetParameterCount());
+					++m_functionCallCount;
+				}
+				// Native functions return immediately, so their result is returned from the current frame
+				else
+				{
+					if (!CallNative(functionDef))
+						return false;
+					if (m_asyncCall)
+					{
+						m_asyncTailCall = true;
+						*instCount = tickInstCount;
+						return true;
+					}
+					auto val = Pop<Checked>();
+					PopFrame();
+					Push(std::move(val));
+					if (timeLimited)
+						nextTimeCheck = tickInstCount;
+				}
+				JX_LOAD_FRAME();
+				JX_CHECK_TIME();
+				JX_CHECK_INTERPRETER();
+			}
+			JX_NEXT();
+			JX_OPCODE(Type)
+			{
+				if (Checked && m_stack.empty())
+				{
+					Error("Stack underflow");
+					return false;
+				}
+				auto & val = m_stack.back();
+				val = val.GetType();
+			}
+			JX_NEXT();
+			JX_OPCODE(Wait)
+			{
+				m_execution.back().ip = ip;
+				*instCount = tickInstCount;
+				if (inst->index)
+					WaitCondition(program, inst);
+				return true;
+			}
+			JX_OPCODE(WaitTime)
+			{
+				auto seconds = Pop<Checked>();
+				if (!seconds.IsInteger() && !seconds.IsNumber())
+				{
+					Error("Wait time must be an integer or number");
+					return false;
+				}
+				m_execution.back().ip = ip;
+				*instCount = tickInstCount;
+				if (seconds.GetNumber() > 0.0)
+					WaitTime(seconds.GetNumber());
+				return true;
+			}
+			JX_FUSED_OPCODE(CompareVarValJump)
+			{
+				// PushVar, PushVal, comparison, JumpFalse or JumpTrue
+				size_t index;
+				bool result;
+				if (!GetSlotIndex(inst->operand, &index) ||
+					!CompareNumeric(m_stack[index], program->GetConstant(ip[0].operand), ip[1].opcode, &result))
+					JX_UNFUSE(PushVar);
+				tickInstCount += 3;
+				ip = (result == (ip[2].opcode == Opcode::JumpTrue)) ? code + ip[2].operand : ip + 3;
+				JX_CHECK_TIME();
+			}
+			JX_NEXT();
+			JX_FUSED_OPCODE(CompareVarVarJump)
+			{
+				// PushVar, PushVar, comparison, JumpFalse or JumpTrue
+				size_t index1;
+				size_t index2;
+				bool result;
+				if (!GetSlotIndex(inst->operand, &index1) || !GetSlotIndex(ip[0].operand, &index2) ||
+					!CompareNumeric(m_stack[index1], m_stack[index2], ip[1].opcode, &result))
+					JX_UNFUSE(PushVar);
+				tickInstCount += 3;
+				ip = (result == (ip[2].opcode == Opcode::JumpTrue)) ? code + ip[2].operand : ip + 3;
+				JX_CHECK_TIME();
+			}
+			JX_NEXT();
+			JX_FUSED_OPCODE(IncVarByConst)
+			{
+				// PushVar, PushVal, Add or Increment, SetVar to the same variable
+				size_t index;
+				if (!GetSlotIndex(inst->operand, &index))
+					JX_UNFUSE(PushVar);
+				auto & var = m_stack[index];
+				const auto & val = program->GetConstant(ip[0].operand);
+				if (var.m_type == ValueType::Integer && val.m_type == ValueType::Integer)
+					var.m_integer += val.m_integer;
+				else if (var.m_type == ValueType::Number && val.m_type == ValueType::Number)
+					var.m_number += val.m_number;
+				else
+					JX_UNFUSE(PushVar);
+				JX_SKIP_FUSED(3);
+			}
+			JX_NEXT();
+			JX_FUSED_OPCODE(SetVarFromVal)
+			{
+				// PushVal, SetVar
+				SetSlot(ip[0].operand, Variant(program->GetConstant(inst->operand)));
+				JX_SKIP_FUSED(1);
+			}
+			JX_NEXT();
+#ifndef JINX_USE_COMPUTED_GOTO
 			default:
 			{
 				Error("Unknown opcode");
@@ -764,41 +1345,129 @@ bool Script::Execute()
 			}
 			break;
 		}
+	}
+#endif
 
-	} 
-	while (opcode != Opcode::Exit && opcode != Opcode::Wait);
+MaxInstructions:
+	if (ErrorOnMaxInstrunction())
+	{
+		Error("Exceeded max instruction count");
+		return false;
+	}
+TimeLimit:
+	m_execution.back().ip = ip;
+	*instCount = tickInstCount;
+	return true;
+}
 
-	// Track accumulated script execution time
-	auto end = std::chrono::high_resolution_clock::now();
-	uint64_t executionTimeNs = std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count();
-	m_runtime->AddPerformanceParams(executionTimeNs, tickInstCount);
+#undef JX_OPCODE
+#undef JX_FUSED_OPCODE
+#undef JX_QUICK_OPCODE
+#undef JX_GENERIC_OPCODE
+#undef JX_QUICKEN
+#undef JX_UNFUSED_OPCODE
+#undef JX_UNFUSE
+#undef JX_SKIP_FUSED
+#undef JX_NEXT
+#undef JX_FETCH
+#undef JX_CHECK_TIME
+#undef JX_BINARY_OPERANDS
+#undef JX_LOAD_FRAME
+#undef JX_CHECK_INTERPRETER
 
+template<typename T>
+static inline bool CompareValues(T left, T right, Opcode opcode, bool * result)
+{
+	switch (opcode)
+	{
+		case Opcode::Equals:
+			*result = left == right;
+			break;
+		case Opcode::Greater:
+			*result = left > right;
+			break;
+		case Opcode::GreaterEq:
+			*result = left >= right;
+			break;
+		case Opcode::Less:
+			*result = left < right;
+			break;
+		case Opcode::LessEq:
+			*result = left <= right;
+			break;
+		case Opcode::NotEquals:
+			*result = left != right;
+			break;
+		default:
+			return false;
+	}
 	return true;
 }
 
+bool Script::CompareNumeric(const Variant & left, const Variant & right, Opcode opcode, bool * result)
+{
+	if (left.m_type == ValueType::Integer && right.m_type == ValueType::Integer)
+		return CompareValues(left.m_integer, right.m_integer, opcode, result);
+	if (left.m_type == ValueType::Number && right.m_type == ValueType::Number)
+		return CompareValues(left.m_number, right.m_number, opcode, result);
+	return false;
+}
+
+bool Script::Detach()
+{
+	WaitState suspended = WaitState::Suspended;
+	return m_waitState.compare_exchange_strong(suspended, WaitState::Detached, std::memory_order_acq_rel);
+}
+
 Variant Script::GetVariable(const String & name) const
 {
+	HeapScope scope(m_runtime->GetHeap());
 	return GetVariableInternal(FoldCase(name));
 }
 
 Variant Script::GetVariableInternal(const String & name) const
 {
-	auto & names = m_execution.back().names;
-	for (auto ritr = names.rbegin(); ritr != names.rend(); ++ritr)
+	// Find the most recently declared slot with this name that's currently in scope
+	const auto & frame = m_execution.back();
+	const auto & nameTable = frame.program->GetNameTable(frame.entry);
+	auto range = nameTable.equal_range(name);
+	if (range.first == range.second)
+	{
+		auto itr = m_hostVariables.find(name);
+		return itr == m_hostVariables.end() ? Variant() : itr->second;
+	}
+	bool found = false;
+	size_t index = 0;
+	for (auto itr = range.first; itr != range.second; ++itr)
 	{
-		auto itr = ritr->nameMap.find(name);
-		if (itr != ritr->nameMap.end())
+		size_t slotIndex;
+		if (GetSlotIndex(itr->second, &slotIndex) && (!found || slotIndex > index))
 		{
-			auto index = itr->second;
-			if (index >= m_stack.size())
-			{
-				LogWriteLine("Attempted to access stack at invalid index");
-				return Variant();
-			}
-			return m_stack[itr->second];
+			index = slotIndex;
+			found = true;
 		}
 	}
-	return Variant();
+	if (!found)
+		return Variant();
+	return m_stack[index];
+}
+
+bool Script::GetSlotIndex(uint32_t slot, size_t * index) const
+{
+	// Slots past the end of the current frame are never assigned, since no frames are above it
+	size_t slotIndex = m_execution.back().slotBase + slot;
+	if (slotIndex >= m_slots.size() || m_slots[slotIndex] >= m_stack.size())
+		return false;
+	*index = m_slots[slotIndex];
+	return true;
+}
+
+Variant Script::GetSlot(uint32_t slot) const
+{
+	size_t index;
+	if (!GetSlotIndex(slot, &index))
+		return Variant();
+	return m_stack[index];
 }
 
 bool Script::IsFinished() const
@@ -806,56 +1475,273 @@ bool Script::IsFinished() const
 	return m_finished || m_error;
 }
 
+void Script::PopFrame()
+{
+	assert(m_execution.size() > 1);
+	const auto & frame = m_execution.back();
+	for (size_t i = frame.declaredBase; i < m_declared.size(); ++i)
+		m_slots[m_declared[i]] = InvalidIndex;
+	m_declared.resize(frame.declaredBase);
+	m_scopes.resize(frame.scopeBase);
+	while (m_stack.size() > frame.stackTop)
+		m_stack.pop_back();
+	m_execution.pop_back();
+}
+
+const FunctionDefinition * Script::GetCallFunction(const Program * program, const Instruction * inst)
+{
+	auto & callSite = program->GetCallSite(inst->operand);
+	auto functionDef = m_runtime->FindFunction(callSite, inst->id);
+	if (!functionDef)
+	{
+		Error("Could not find function definition");
+		return nullptr;
+	}
+	// Verified programs rely on the call's stack effects matching the function's
+	if (functionDef->GetParameterCount() != callSite.parameterCount ||
+		functionDef->HasReturnParameter() != (callSite.returnCount != 0))
+	{
+		Error("Function signature doesn't match call");
+		return nullptr;
+	}
+	return functionDef;
+}
+
+bool Script::CallNative(const FunctionDefinition * functionDef)
+{
+	auto callback = functionDef->GetCallback();
+	if (!callback && !functionDef->GetAsyncCallback())
+	{
+		Error("Error in function definition");
+		return false;
+	}
+	Parameters params;
+	size_t numParams = functionDef->GetParameterCount();
+	params.reserve(numParams);
+	for (size_t i = 0; i < numParams; ++i)
+	{
+		size_t index = m_stack.size() - (numParams - i);
+		params.push_back(std::move(m_stack[index]));
+	}
+	for (size_t i = 0; i < numParams; ++i)
+		m_stack.pop_back();
+	++m_nativeCallCount;
+	const auto & asyncCallback = functionDef->GetAsyncCallback();
+	if (asyncCallback)
+	{
+		// Suspend the script before calling, since the call may be completed on another thread at any time
+		m_armedWait = nullptr;
+		uint32_t generation = m_waitGeneration.load(std::memory_order_relaxed) + 1;
+		m_waitGeneration.store(generation, std::memory_order_release);
+		m_waitState.store(WaitState::Suspended, std::memory_order_release);
+		m_asyncCall = std::allocate_shared<AsyncCall>(Allocator<AsyncCall>(), shared_from_this(), generation);
+		m_asyncReturn = functionDef->HasReturnParameter();
+		asyncCallback(shared_from_this(), params, m_asyncCall);
+
+		// Continue executing if the call completed immediately
+		if (m_asyncCall->IsComplete())
+		{
+			if (m_asyncReturn)
+				Push(m_asyncCall->GetResult());
+			m_asyncCall.reset();
+		}
+		return true;
+	}
+	Variant retVal = callback(shared_from_this(), params);
+	if (functionDef->HasReturnParameter())
+		Push(std::move(retVal));
+	return true;
+}
+
+template <bool Checked>
 Variant Script::Pop()
 {
-	if (m_stack.empty())
+	if (Checked && m_stack.empty())
 	{
 		Error("Stack underflow");
 		return Variant();
 	}
-	auto var = m_stack.back();
+	auto var = std::move(m_stack.back());
 	m_stack.pop_back();
 	return var;
 }
 
+void Script::PushFrame(const Program * program, size_t entry, size_t parameterCount)
+{
+	// Each frame's slots begin after the slots used so far by the frame calling it
+	ExecutionFrame frame;
+	frame.program = program;
+	frame.ip = program->GetInstructions() + entry;
+	frame.entry = entry;
+	frame.scopeBase = m_scopes.size();
+	frame.slotBase = m_execution.empty() ? 0 : m_execution.back().slotBase + m_execution.back().slotCount;
+	frame.slotCount = 0;
+	frame.declaredBase = m_declared.size();
+	frame.stackTop = m_stack.size() - parameterCount;
+	m_execution.push_back(frame);
+}
+
+void Script::ReplaceFrame(const Program * program, size_t entry, size_t parameterCount)
+{
+	// End the current frame's scopes and variables
+	auto & frame = m_execution.back();
+	for (size_t i = frame.declaredBase; i < m_declared.size(); ++i)
+		m_slots[m_declared[i]] = InvalidIndex;
+	m_declared.resize(frame.declaredBase);
+	m_scopes.resize(frame.scopeBase);
+
+	// Move the parameters down to the frame's stack top, replacing the frame's variables and temporaries
+	size_t parameterBase = m_stack.size() - parameterCount;
+	if (parameterBase != frame.stackTop)
+	{
+		for (size_t i = 0; i < parameterCount; ++i)
+			m_stack[frame.stackTop + i] = std::move(m_stack[parameterBase + i]);
+		while (m_stack.size() > frame.stackTop + parameterCount)
+			m_stack.pop_back();
+	}
+
+	// Begin executing the called function in the same frame
+	frame.program = program;
+	frame.ip = program->GetInstructions() + entry;
+	frame.entry = entry;
+	frame.slotCount = 0;
+}
+
+bool Script::ResumeAsyncCall()
+{
+	if (!m_asyncCall->IsComplete())
+		return false;
+	if (m_asyncReturn)
+		Push(m_asyncCall->GetResult());
+	m_asyncCall.reset();
+
+	// A call in tail position returns its result from the calling frame
+	if (m_asyncTailCall)
+	{
+		m_asyncTailCall = false;
+		auto val = Pop<true>();
+		PopFrame();
+		Push(std::move(val));
+	}
+	return true;
+}
+
 void Script::Push(const Variant & value)
 {
 	m_stack.push_back(value);
 }
 
+void Script::Push(Variant && value)
+{
+	m_stack.push_back(std::move(value));
+}
+
+void Script::SetScheduled(bool scheduled)
+{
+	m_scheduled.store(scheduled, std::memory_order_relaxed);
+
+	// A script detached by the scheduler and registered again is detached again when next executed
+	WaitState detached = WaitState::Detached;
+	if (scheduled)
+		m_waitState.compare_exchange_strong(detached, WaitState::Suspended, std::memory_order_acq_rel);
+}
+
+void Script::SetSlot(uint32_t slot, Variant && value)
+{
+	// Assign the variable if it's in scope, otherwise create a new variable on the top of the stack
+	size_t index;
+	if (GetSlotIndex(slot, &index))
+	{
+		m_stack[index] = std::move(value);
+		return;
+	}
+	SetSlotIndex(slot, m_stack.size());
+	m_stack.push_back(std::move(value));
+}
+
+void Script::SetSlotIndex(uint32_t slot, size_t index)
+{
+	auto & frame = m_execution.back();
+	if (slot >= frame.slotCount)
+	{
+		frame.slotCount = slot + 1;
+		if (frame.slotBase + frame.slotCount > m_slots.size())
+			m_slots.resize(frame.slotBase + frame.slotCount, InvalidIndex);
+	}
+	size_t slotIndex = frame.slotBase + slot;
+	m_slots[slotIndex] = index;
+	m_declared.push_back(slotIndex);
+}
+
 void Script::SetVariable(const String & name, const Variant & value)
 {
+	HeapScope scope(m_runtime->GetHeap());
 	SetVariableInternal(FoldCase(name), value);
+
+	// The variable may be read by the condition the script is waiting on
+	if (m_armedWait)
+		Wake(m_waitGeneration.load(std::memory_order_acquire));
 }
 
 void Script::SetVariableInternal(const String & name, const Variant & value)
 {
-	// Search down the variable stack for the variable
-	auto & names = m_execution.back().names;
-	for (auto ritr = names.rbegin(); ritr != names.rend(); ++ritr)
+	// Assign the most recently declared slot with this name that's currently in scope
+	const auto & frame = m_execution.back();
+	const auto & nameTable = frame.program->GetNameTable(frame.entry);
+	auto range = nameTable.equal_range(name);
+	if (range.first == range.second)
 	{
-		auto itr = ritr->nameMap.find(name);
-		if (itr != ritr->nameMap.end())
+		// Names the script never uses are kept for the host to read back
+		m_hostVariables[name] = value;
+		return;
+	}
+	bool found = false;
+	size_t index = 0;
+	for (auto itr = range.first; itr != range.second; ++itr)
+	{
+		size_t slotIndex;
+		if (GetSlotIndex(itr->second, &slotIndex) && (!found || slotIndex > index))
 		{
-			auto index = itr->second;
-			if (index >= m_stack.size())
-			{
-				LogWriteLine("Attempted to access stack at invalid index");
-				return;
-			}
-			m_stack[itr->second] = value;
-			return;
+			index = slotIndex;
+			found = true;
 		}
 	}
+	if (found)
+	{
+		m_stack[index] = value;
+		return;
+	}
 
-	// If we don't find the name, create a new variable on the top of the stack
-	names.back().nameMap.insert(std::make_pair(name, m_stack.size()));
-	m_stack.push_back(value);
+	// If the variable isn't in scope yet, such as with an external variable, create it now
+	SetSlot(range.first->second, Variant(value));
 }
 
-void Script::SetVariableAtIndex(const String & name, size_t index)
+void Script::WaitCondition(const Program * program, const Instruction * inst)
 {
-	assert(index < m_stack.size());
-	m_execution.back().names.back().nameMap.insert(std::make_pair(name, index));
+	// Suspend the script if it reaches the wait it armed without being woken
+	if (m_armedWait == inst)
+	{
+		WaitState armed = WaitState::Armed;
+		if (m_waitState.compare_exchange_strong(armed, WaitState::Suspended, std::memory_order_acq_rel))
+			return;
+	}
+	ArmWait(program, inst);
 }
 
+void Script::WaitTime(double seconds)
+{
+	// Suspend the script until the runtime's clock reaches the end of the wait
+	m_armedWait = nullptr;
+	uint32_t generation = m_waitGeneration.load(std::memory_order_relaxed) + 1;
+	m_waitGeneration.store(generation, std::memory_order_release);
+	m_waitState.store(WaitState::Suspended, std::memory_order_release);
+	m_runtime->AddTimer(shared_from_this(), generation, seconds);
+}
+
+void Script::Wake(uint32_t waitGeneration)
+{
+	if (waitGeneration != m_waitGeneration.load(std::memory_order_acquire))
+		return;
+	if (m_waitState.exchange(WaitState::Running, std::memory_order_acq_rel) == WaitState::Detached)
+		m_runtime->RescheduleScript(shared_from_this());
+}
@@ -9,6 +9,12 @@ Copyright (c) 2016 James Boer
 #ifndef JX_SCRIPT_H__
 #define JX_SCRIPT_H__
 
+// Direct-threaded dispatch relies on the labels-as-values extension supported by GCC and Clang.
+// Define JINX_DISABLE_COMPUTED_GOTO to use the portable switch-based dispatch loop instead.
+#if (defined(__GNUC__) || defined(__clang__)) && !defined(JINX_DISABLE_COMPUTED_GOTO)
+#define JINX_USE_COMPUTED_GOTO
+#endif
+
 
 namespace Jinx
 {
@@ -21,64 +27,200 @@ namespace Jinx
 
 		bool Execute() override;
 		bool IsFinished() const override;
+		void SetMaxExecutionTime(uint64_t timeNs) override { m_maxExecutionTimeNs = timeNs; }
+
+		// Execute the script, yielding when either the script's own time limit or the specified deadline passes.
+		// The caller times execution, and execution counts are added to the stats, so callers
+		// executing many scripts record performance stats once.
+		bool ExecuteUntil(TimePoint deadline, PerformanceStats * stats);
 
 		Variant GetVariable(const String & name) const override;
 		void SetVariable(const String & name, const Variant & value) override;
 
 		LibraryPtr GetLibrary() const override { return m_library; }
 
+		// Wake a script suspended by a wait armed with the specified generation
+		void Wake(uint32_t waitGeneration);
+		bool IsWaitGeneration(uint32_t waitGeneration) const { return m_waitGeneration.load(std::memory_order_acquire) == waitGeneration; }
+
+		// Used by the scheduler to track scripts it executes.  Detach() returns true if the script is
+		// suspended, in which case the scheduler drops it and it's rescheduled when woken.
+		bool IsScheduled() const { return m_scheduled.load(std::memory_order_relaxed); }
+		void SetScheduled(bool scheduled);
+		bool Detach();
+
+		// Mark the script as kept by the scheduler's update, returning false if it already was
+		bool MarkScheduled(uint64_t update)
+		{
+			if (m_scheduledUpdate == update)
+				return false;
+			m_scheduledUpdate = update;
+			return true;
+		}
+
 	private:
 		void Error(const char * message);
 
-		Variant GetVariableInternal(const String & name) const;
+		// Executes instructions until the script finishes, waits, or reaches the instruction limit, or until
+		// a call or return switches to a frame requiring the other interpreter.  Verified programs are executed
+		// by the unchecked interpreter, which skips stack checks the verifier has already proven unnecessary.
+		// If a dispatch table pointer is passed, the interpreter's handler table is returned instead.
+		template <bool Checked>
+		bool ExecuteInstructions(uint32_t * instCount, const void * const ** dispatchTable = nullptr);
+
+		template <bool Checked>
 		Variant Pop();
 		void Push(const Variant & value);
-		void SetVariableAtIndex(const String & name, size_t index);
+		void Push(Variant && value);
+
+		// Push a frame beginning at the specified instruction, with parameters already on the stack
+		void PushFrame(const Program * program, size_t entry, size_t parameterCount);
+
+		// Pop the current frame, ending its scopes and clearing its variables from the stack
+		void PopFrame();
+
+		// Reuse the current frame for a function called in tail position, with parameters on the stack
+		void ReplaceFrame(const Program * program, size_t entry, size_t parameterCount);
+
+		// Resolve the function called by a CallFunc or TailCall instruction, or return null on error
+		const FunctionDefinition * GetCallFunction(const Program * program, const Instruction * inst);
+
+		// Call a native function with parameters on the stack, pushing its return value if it has one.  An
+		// asynchronous function that doesn't complete immediately leaves the call pending, and suspends the script.
+		bool CallNative(const FunctionDefinition * functionDef);
+
+		// Push the result of a completed asynchronous call, returning false if it's still pending
+		bool ResumeAsyncCall();
+
+		// Variable access by slot index within the current execution frame
+		bool GetSlotIndex(uint32_t slot, size_t * index) const;
+		Variant GetSlot(uint32_t slot) const;
+		void SetSlot(uint32_t slot, Variant && value);
+		void SetSlotIndex(uint32_t slot, size_t index);
+
+		// Compares two integer or number values using a comparison opcode.  Returns false
+		// if the values can't be compared directly.
+		static bool CompareNumeric(const Variant & left, const Variant & right, Opcode opcode, bool * result);
+
+		// Suspend the script at a wait whose condition only reads properties, variables, and constants
+		void WaitCondition(const Program * program, const Instruction * inst);
+		void ArmWait(const Program * program, const Instruction * inst);
+
+		// Suspend the script until the runtime's clock advances by the specified number of seconds
+		void WaitTime(double seconds);
+
+		// Variable access by name, using the bytecode name table
+		Variant GetVariableInternal(const String & name) const;
 		void SetVariableInternal(const String & name, const Variant & value);
 
 	private:
-		typedef std::map<String, size_t, std::less<String>, Allocator<std::pair<String, size_t>>> NameIndexMap;
+
+		// Type-specialized handlers which generic instructions are rewritten to after the interpreter
+		// observes their operand types.  These only exist in decoded programs, not in bytecode.
+		enum class QuickOpcode
+		{
+			AddInteger = static_cast<int>(FusedOpcode::NumFusedOpcodes),
+			AddNumber,
+			AddGeneric,
+			EqualsInteger,
+			EqualsNumber,
+			EqualsString,
+			EqualsGeneric,
+			IncrementInteger,
+			IncrementNumber,
+			IncrementGeneric,
+			LessInteger,
+			LessNumber,
+			LessGeneric,
+			SubtractInteger,
+			SubtractNumber,
+			SubtractGeneric,
+			NumQuickOpcodes,
+		};
+
+		// A script reaching a wait whose condition only reads properties, variables, and constants arms
+		// the wait, registering to be woken when a property the condition reads is set, and evaluates the
+		// condition once more on the next execution.  If it reaches the same wait without being woken,
+		// the script is suspended, and executing it does nothing until it's woken.  A suspended script
+		// detached from the scheduler is rescheduled when woken.
+		enum class WaitState : uint8_t
+		{
+			Running,
+			Armed,
+			Suspended,
+			Detached,
+		};
+
+		// Number of instructions executed between reading the clock in time-limited scripts
+		static const uint32_t TimeCheckInterval = 128;
+
+		// Indicates a variable slot is not currently assigned to a stack index
+		static const size_t InvalidIndex = SIZE_MAX;
 
 		// Pointer to runtime object
 		RuntimeIPtr m_runtime;
 
-		// Name table frame for local names
+		// Scope frame tracks the stack and declared slots to clear to when the scope ends
 		struct ScopeFrame
 		{
-			NameIndexMap nameMap;
 			size_t stackTop;
+			size_t declaredTop;
 		};
 
-		// Execution frame allows jumping to remote code (function calls) and returning
+		// Execution frame allows jumping to remote code (function calls) and returning.  Frames only
+		// index into the script's shared scope, slot, and declaration stacks, so pushing and popping
+		// them never allocates.
 		struct ExecutionFrame
 		{
-			ExecutionFrame(BufferPtr bc) : bytecode(bc), reader(bc)
-			{
-				ScopeFrame frame;
-				frame.stackTop = 0;
-				names.reserve(8);
-				names.push_back(frame);
-			}
+			// Program containing the frame's decoded instructions.  Programs outlive the frames using
+			// them, since the script holds its own program, and function definitions hold theirs.
+			const Program * program;
 
-			// Buffer containing script bytecode
-			BufferPtr bytecode;
+			// Next instruction to execute in this frame
+			const Instruction * ip;
 
-			// Binary reader - sequentially extracts data from bytecode buffer.  The reader's
-			// current internal position acts as the current frame's instruction pointer.
-			BinaryReader reader;
+			// Instruction index of the frame's entry point, used to find the frame's name table
+			size_t entry;
 
-			// Name lookup map
-			std::vector<ScopeFrame, Allocator<ScopeFrame>> names;
+			// Index of the frame's first scope in the scope stack
+			size_t scopeBase;
+
+			// Index of the frame's first variable slot in the slot stack, and the number of slots used so far
+			size_t slotBase;
+			size_t slotCount;
+
+			// Index of the frame's first declaration in the declared slot stack
+			size_t declaredBase;
 
 			// Top of the stack to clear to when this frame is popped
 			size_t stackTop;
 		};
 
+		// Program executed by the root frame
+		ProgramPtr m_program;
+
+		// Arena holding the script's stacks, which never leave the script.  Declared before the stacks,
+		// so it's destroyed after them.
+		Arena m_arena;
+
 		// Execution frame stack
-		std::vector<ExecutionFrame, Allocator<ExecutionFrame>> m_execution;
+		std::vector<ExecutionFrame, ArenaAllocator<ExecutionFrame>> m_execution;
+
+		// Scope stack, shared by all execution frames
+		std::vector<ScopeFrame, ArenaAllocator<ScopeFrame>> m_scopes;
+
+		// Stack index of each frame's variable slots, or InvalidIndex if the variable is not in scope
+		std::vector<size_t, ArenaAllocator<size_t>> m_slots;
+
+		// Slot stack indices assigned in the order they were declared, cleared as scopes and frames end
+		std::vector<size_t, ArenaAllocator<size_t>> m_declared;
 
 		// Runtime stack
-		std::vector<Variant, Allocator<Variant>> m_stack;
+		std::vector<Variant, ArenaAllocator<Variant>> m_stack;
+
+		// Variables set by the host with names the script never uses, so they have no slot
+		typedef std::map<String, Variant, std::less<String>, Allocator<std::pair<const String, Variant>>> HostVariableMap;
+		HostVariableMap m_hostVariables;
 
 		// Current library
 		LibraryIPtr m_library;
@@ -88,6 +230,35 @@ namespace Jinx
 
 		// Runtime error
 		bool m_error;
+
+		// Execution stopped to switch between the checked and unchecked interpreters
+		bool m_switchInterpreter;
+
+		// Maximum execution time of each call, and the time the current call yields at
+		uint64_t m_maxExecutionTimeNs;
+		TimePoint m_deadline;
+
+		// Calls made while executing, added to performance stats once execution stops
+		uint32_t m_functionCallCount;
+		uint32_t m_nativeCallCount;
+
+		// Wait state, and the generation of the most recently armed wait, used to ignore stale wakes
+		std::atomic<WaitState> m_waitState;
+		std::atomic<uint32_t> m_waitGeneration;
+		const Instruction * m_armedWait;
+		std::vector<PropertySlot *, ArenaAllocator<PropertySlot *>> m_waitProperties;
+
+		// Pending asynchronous native function call, whether it returns a value, and whether it was
+		// called in tail position, returning its result from the current frame when resumed
+		AsyncCallIPtr m_asyncCall;
+		bool m_asyncReturn;
+		bool m_asyncTailCall;
+
+		// Is the script registered with the runtime's scheduler?
+		std::atomic<bool> m_scheduled;
+
+		// Last scheduler update the script was kept by, only accessed by the thread running ticks
+		uint64_t m_scheduledUpdate;
 	};
 };
 
@@ -0,0 +1,120 @@
+/*
+The Jinx library is distributed under the MIT License (MIT)
+https://opensource.org/licenses/MIT
+See LICENSE.TXT or Jinx.h for license details.
+Copyright (c) 2016 James Boer
+*/
+
+#include "JxInternal.h"
+
+using namespace Jinx;
+
+
+TimerWheel::TimerWheel() :
+	m_currentTick(0),
+	m_slots(nullptr)
+{
+	for (auto & count : m_levelCounts)
+		count = 0;
+}
+
+TimerWheel::~TimerWheel()
+{
+	if (m_slots)
+	{
+		m_slots->~Slots();
+		JinxFree(m_slots);
+	}
+}
+
+void TimerWheel::AddTimer(const std::weak_ptr<Script> & script, uint32_t waitGeneration, double seconds)
+{
+	// Timers last at least one tick, so a script never wakes in the same clock update it slept in
+	uint64_t ticks = std::max<uint64_t>(static_cast<uint64_t>(std::llround(seconds * TicksPerSecond)), 1);
+	TimerList expired;
+	std::lock_guard<Mutex> lock(m_mutex);
+	if (!m_slots)
+		m_slots = new (JinxAlloc(sizeof(Slots))) Slots();
+	Insert(Timer{ script, waitGeneration, m_currentTick + ticks }, expired);
+}
+
+void TimerWheel::Advance(double time)
+{
+	uint64_t target = time > 0.0 ? static_cast<uint64_t>(std::llround(time * TicksPerSecond)) : 0;
+	TimerList expired;
+	{
+		std::lock_guard<Mutex> lock(m_mutex);
+		while (m_currentTick < target)
+		{
+			// Skip ahead to the next tick where the lowest level with timers reaches a new slot
+			uint32_t level = 0;
+			while (level < LevelCount && m_levelCounts[level] == 0)
+				++level;
+			if (level == LevelCount)
+			{
+				m_currentTick = target;
+				break;
+			}
+			uint32_t shift = level * LevelBits;
+			uint64_t next = ((m_currentTick >> shift) + 1) << shift;
+			if (next > target)
+			{
+				m_currentTick = target;
+				break;
+			}
+			m_currentTick = next;
+
+			// Move timers down from each upper level reaching a new slot, then expire the lowest slot
+			for (uint32_t l = LevelCount - 1; l > 0; --l)
+			{
+				if ((m_currentTick & ((1ull << (l * LevelBits)) - 1)) == 0)
+					Cascade(l, expired);
+			}
+			Cascade(0, expired);
+		}
+	}
+
+	// Scripts are woken after unlocking, since waking may reschedule them
+	for (const auto & timer : expired)
+	{
+		auto script = timer.script.lock();
+		if (script)
+			script->Wake(timer.waitGeneration);
+	}
+}
+
+void TimerWheel::Cascade(uint32_t level, TimerList & expired)
+{
+	auto & slot = m_slots->lists[level][(m_currentTick >> (level * LevelBits)) & SlotMask];
+	if (slot.empty())
+		return;
+	TimerList timers;
+	timers.swap(slot);
+	m_levelCounts[level] -= timers.size();
+	for (auto & timer : timers)
+		Insert(std::move(timer), expired);
+}
+
+void TimerWheel::Insert(Timer && timer, TimerList & expired)
+{
+	if (timer.deadline <= m_currentTick)
+	{
+		expired.push_back(std::move(timer));
+		return;
+	}
+	for (uint32_t level = 0; level < LevelCount; ++level)
+	{
+		uint32_t shift = level * LevelBits;
+		if ((timer.deadline >> shift) - (m_currentTick >> shift) < SlotCount)
+		{
+			m_slots->lists[level][(timer.deadline >> shift) & SlotMask].push_back(std::move(timer));
+			++m_levelCounts[level];
+			return;
+		}
+	}
+
+	// Deadlines beyond the top level's span wait in its last slot to be reached, and are placed again from there
+	uint32_t shift = (LevelCount - 1) * LevelBits;
+	m_slots->lists[LevelCount - 1][((m_currentTick >> shift) - 1) & SlotMask].push_back(std::move(timer));
+	++m_levelCounts[LevelCount - 1];
+}
@@ -0,0 +1,77 @@
+/*
+The Jinx library is distributed under the MIT License (MIT)
+https://opensource.org/licenses/MIT
+See LICENSE.TXT or Jinx.h for license details.
+Copyright (c) 2016 James Boer
+*/
+
+#pragma once
+#ifndef JX_TIMER_WHEEL_H__
+#define JX_TIMER_WHEEL_H__
+
+
+namespace Jinx
+{
+
+	class Script;
+
+	// Hierarchical timer wheel, waking scripts suspended by timed waits.  Each level has a ring of slots,
+	// with each slot spanning a full revolution of the level below.  Timers are placed in the lowest
+	// level that reaches their deadline, and move down a level as the clock reaches their slot, so adding
+	// a timer and advancing the clock a tick take constant time regardless of how many scripts are
+	// sleeping.  Ranges of time with no pending timers are skipped when advancing the clock.
+	class TimerWheel
+	{
+	public:
+		TimerWheel();
+		~TimerWheel();
+
+		TimerWheel(const TimerWheel &) = delete;
+		TimerWheel & operator = (const TimerWheel &) = delete;
+
+		// Wake the script after the specified number of seconds, unless it arms a newer wait first
+		void AddTimer(const std::weak_ptr<Script> & script, uint32_t waitGeneration, double seconds);
+
+		// Advance the clock to the specified time in seconds, waking scripts with expired timers
+		void Advance(double time);
+
+	private:
+
+		static const uint64_t TicksPerSecond = 1000;
+		static const uint32_t LevelBits = 8;
+		static const uint32_t LevelCount = 4;
+		static const uint64_t SlotCount = 1ull << LevelBits;
+		static const uint64_t SlotMask = SlotCount - 1;
+
+		struct Timer
+		{
+			std::weak_ptr<Script> script;
+			uint32_t waitGeneration;
+			uint64_t deadline;
+		};
+
+		typedef std::vector<Timer, Allocator<Timer>> TimerList;
+
+		struct Slots
+		{
+			TimerList lists[LevelCount][SlotCount];
+		};
+
+		// Place a timer in the wheel, or in the expired list if its deadline has been reached.  Must be
+		// called with the mutex locked.
+		void Insert(Timer && timer, TimerList & expired);
+
+		// Re-insert the timers in a level's current slot.  Must be called with the mutex locked.
+		void Cascade(uint32_t level, TimerList & expired);
+
+		Mutex m_mutex;
+		uint64_t m_currentTick;
+		size_t m_levelCounts[LevelCount];
+
+		// Slots are allocated when the first timer is added, since most runtimes never use timed waits
+		Slots * m_slots;
+	};
+
+};
+
+#endif // JX_TIMER_WHEEL_H__
@@ -29,7 +29,7 @@ void VariableStackFrame::CalculateMaxVariableParts()
 		// Check each variable within each set
 		for (auto itr2 = itr->begin(); itr2 != itr->end(); ++itr2)
 		{
-			size_t varParts = GetNamePartCount(*itr2);
+			size_t varParts = GetNamePartCount(itr2->first);
 			if (varParts > maxVarParts)
 				maxVarParts = varParts;
 		}
@@ -78,9 +78,12 @@ bool VariableStackFrame::VariableAssign(const String & name)
 			return true;
 	}
 
-	// If we don't find the name, create a new variable on the top of the stack
+	// If we don't find the name, create a new variable on the top of the stack.  Each variable
+	// receives its own slot within the frame, which the runtime uses instead of the name.
+	uint32_t slot = static_cast<uint32_t>(frame.slots.size());
 	auto & variableSet = frame.stack.back();
-	variableSet.insert(name);
+	variableSet.insert(std::make_pair(name, slot));
+	frame.slots.push_back(std::make_pair(name, slot));
 
 	// Adjust the max variable parts value if necessary
 	size_t varParts = GetNamePartCount(name);
@@ -107,6 +110,38 @@ bool VariableStackFrame::VariableExists(const String & name) const
 	return false;
 }
 
+bool VariableStackFrame::GetVariableSlot(const String & name, uint32_t * slot) const
+{
+	assert(slot);
+
+	// Sanity check
+	if (m_frames.empty())
+		return false;
+
+	// Find the innermost variable with this name in the current frame
+	const FrameData & frame = m_frames.back();
+	for (auto ritr = frame.stack.rbegin(); ritr != frame.stack.rend(); ++ritr)
+	{
+		auto itr = ritr->find(name);
+		if (itr != ritr->end())
+		{
+			*slot = itr->second;
+			return true;
+		}
+	}
+	return false;
+}
+
+size_t VariableStackFrame::GetScopeDepth() const
+{
+	return m_frames.back().stack.size();
+}
+
+const VariableStackFrame::VariableSlots & VariableStackFrame::GetFrameSlots() const
+{
+	return m_frames.back().slots;
+}
+
 void VariableStackFrame::FrameBegin()
 {
 	m_frames.push_back(FrameData());
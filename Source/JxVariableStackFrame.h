@@ -27,6 +27,18 @@ namespace Jinx
 		bool VariableAssign(const String & name);
 		bool VariableExists(const String & name) const;
 
+		// Retrieve the frame slot index assigned to a variable in the current scope
+		bool GetVariableSlot(const String & name, uint32_t * slot) const;
+
+		// Retrieve the number of open scopes in the current frame
+		size_t GetScopeDepth() const;
+
+		// Variable names and slot indices assigned within a frame
+		typedef std::vector<std::pair<String, uint32_t>, Allocator<std::pair<String, uint32_t>>> VariableSlots;
+
+		// Retrieve all variables assigned within the current frame
+		const VariableSlots & GetFrameSlots() const;
+
 		// Begin or end a new execution frame, like with a function
 		void FrameBegin();
 		bool FrameEnd();
@@ -48,12 +60,13 @@ namespace Jinx
 
 		void CalculateMaxVariableParts();
 
-		typedef std::set<String, std::less<String>, Allocator<String>> VariableSet;
+		typedef std::map<String, uint32_t, std::less<String>, Allocator<std::pair<const String, uint32_t>>> VariableSet;
 		typedef std::vector<VariableSet, Allocator<VariableSet>> VariableStack;
 		struct FrameData
 		{
 			FrameData() : maxVariableParts(0) {}
 			VariableStack stack;
+			VariableSlots slots;
 			size_t maxVariableParts;
 		};
 		typedef std::vector<FrameData, Allocator<FrameData>> VariableFrames;
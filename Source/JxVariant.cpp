@@ -57,6 +57,12 @@ Variant::Variant(const Variant & copy)
 	};
 }
 
+Variant::Variant(Variant && other) noexcept :
+	m_type(ValueType::Null)
+{
+	MoveFrom(other);
+}
+
 Variant::~Variant()
 {
 	Destroy();
@@ -64,6 +70,16 @@ Variant::~Variant()
 
 Variant & Variant::operator= (const Variant & copy)
 {
+	if (this == &copy)
+		return *this;
+
+	// Reuse existing string storage when assigning one string to another
+	if (m_type == ValueType::String && copy.m_type == ValueType::String)
+	{
+		m_string = copy.m_string;
+		return *this;
+	}
+
 	Destroy();
 	m_type = copy.m_type;
 	switch (m_type)
@@ -111,6 +127,16 @@ Variant & Variant::operator= (const Variant & copy)
 	return *this;
 }
 
+Variant & Variant::operator= (Variant && other) noexcept
+{
+	if (this != &other)
+	{
+		Destroy();
+		MoveFrom(other);
+	}
+	return *this;
+}
+
 Variant & Variant::operator ++()
 {
 	switch (m_type)
@@ -141,7 +167,10 @@ Variant & Variant::operator += (const Variant & right)
 		m_integer += right.GetInteger();
 		break;
 	case ValueType::String:
-		m_string += right.GetString();
+		if (right.m_type == ValueType::String)
+			m_string += right.m_string;
+		else
+			m_string += right.GetString();
 		break;
 	default:
 		break;
@@ -402,6 +431,50 @@ void Variant::Destroy()
 	m_type = ValueType::Null;
 }
 
+void Variant::MoveFrom(Variant & other)
+{
+	// Take ownership of the other variant's value, leaving it null
+	m_type = other.m_type;
+	switch (m_type)
+	{
+	case ValueType::Null:
+		break;
+	case ValueType::Number:
+		m_number = other.m_number;
+		break;
+	case ValueType::Integer:
+		m_integer = other.m_integer;
+		break;
+	case ValueType::Boolean:
+		m_boolean = other.m_boolean;
+		break;
+	case ValueType::String:
+		new(&m_string) String(std::move(other.m_string));
+		break;
+	case ValueType::Collection:
+		new(&m_collection) CollectionPtr(std::move(other.m_collection));
+		break;
+	case ValueType::CollectionItr:
+		new(&m_collectionItrPair) CollectionItrPair(std::move(other.m_collectionItrPair));
+		break;
+	case ValueType::UserObject:
+		new(&m_userObject) UserObjectPtr(std::move(other.m_userObject));
+		break;
+	case ValueType::Buffer:
+		new(&m_buffer) BufferPtr(std::move(other.m_buffer));
+		break;
+	case ValueType::Guid:
+		m_guid = other.m_guid;
+		break;
+	case ValueType::ValType:
+		m_valType = other.m_valType;
+		break;
+	default:
+		assert(!"Unknown variant type!");
+	};
+	other.Destroy();
+}
+
 bool Variant::GetBoolean() const
 {
 	if (IsBoolean())
@@ -541,6 +614,18 @@ void Variant::SetBuffer(const BufferPtr & value)
 	m_buffer = value;
 }
 
+void Variant::SetBuffer(BufferPtr && value)
+{
+	Destroy();
+	if (!value)
+	{
+		m_type = ValueType::Null;
+		m_integer = 0;
+	}
+	m_type = ValueType::Buffer;
+	new(&m_buffer) BufferPtr(std::move(value));
+}
+
 void Variant::SetBoolean(bool value)
 {
 	Destroy();
@@ -561,6 +646,18 @@ void Variant::SetCollection(const CollectionPtr & value)
 	m_collection = value;
 }
 
+void Variant::SetCollection(CollectionPtr && value)
+{
+	Destroy();
+	if (!value)
+	{
+		m_type = ValueType::Null;
+		m_integer = 0;
+	}
+	m_type = ValueType::Collection;
+	new(&m_collection) CollectionPtr(std::move(value));
+}
+
 void Variant::SetCollectionItr(const CollectionItrPair & value)
 {
 	assert(value.second);
@@ -570,6 +667,14 @@ void Variant::SetCollectionItr(const CollectionItrPair & value)
 	m_collectionItrPair = value;
 }
 
+void Variant::SetCollectionItr(CollectionItrPair && value)
+{
+	assert(value.second);
+	Destroy();
+	m_type = ValueType::CollectionItr;
+	new(&m_collectionItrPair) CollectionItrPair(std::move(value));
+}
+
 void Variant::SetGuid(const Guid & value)
 {
 	Destroy();
@@ -605,12 +710,36 @@ void Variant::SetUserObject(const UserObjectPtr & value)
 	m_userObject = value;
 }
 
+void Variant::SetUserObject(UserObjectPtr && value)
+{
+	Destroy();
+	m_type = ValueType::UserObject;
+	new(&m_userObject) UserObjectPtr(std::move(value));
+}
+
 void Variant::SetString(const String & value)
 {
+	// Reuse existing string storage if possible
+	if (m_type == ValueType::String)
+	{
+		m_string = value;
+		return;
+	}
+	Destroy();
+	m_type = ValueType::String;
+	new(&m_string) String(value);
+}
+
+void Variant::SetString(String && value)
+{
+	if (m_type == ValueType::String)
+	{
+		m_string = std::move(value);
+		return;
+	}
 	Destroy();
 	m_type = ValueType::String;
-	new(&m_string) String();
-	m_string = value;
+	new(&m_string) String(std::move(value));
 }
 
 void Variant::SetString(const StringU16 & value)
@@ -728,8 +857,8 @@ Variant Jinx::operator + (const Variant & left, const Variant & right)
 {
 	if (left.GetType() == ValueType::String)
 	{
-		Variant result;
-		result.SetString(left.GetString() + right.GetString());
+		Variant result(left);
+		result += right;
 		return result;
 	}
 	if (left.GetType() != ValueType::Number && left.GetType() != ValueType::Integer)
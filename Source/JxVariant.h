@@ -17,6 +17,7 @@ namespace Jinx
 
 	class BinaryReader;
 	class BinaryWriter;
+	class Script;
 
 	/// Interface for user objects in scripts
 	class IUserObject
@@ -60,6 +61,7 @@ namespace Jinx
 			m_type(ValueType::Null)
 		{}
 		Variant(const Variant & copy);
+		Variant(Variant && other) noexcept;
 		Variant(std::nullptr_t) : m_type(ValueType::Null) { SetNull(); }
 		Variant(bool value) : m_type(ValueType::Null) { SetBoolean(value); }
 		Variant(int32_t value) : m_type(ValueType::Null) { SetInteger(value); }
@@ -69,10 +71,13 @@ namespace Jinx
 		Variant(const char16_t * value) : m_type(ValueType::Null) { SetString(value); }
 		Variant(const wchar_t * value) : m_type(ValueType::Null) { SetString(value); }
 		Variant(const String & value) : m_type(ValueType::Null) { SetString(value); }
+		Variant(String && value) : m_type(ValueType::Null) { SetString(std::move(value)); }
 		Variant(const StringU16 & value) : m_type(ValueType::Null) { SetString(value); }
 		Variant(const WString & value) : m_type(ValueType::Null) { SetString(value); }
 		Variant(const CollectionPtr & value) : m_type(ValueType::Null) { SetCollection(value); }
+		Variant(CollectionPtr && value) : m_type(ValueType::Null) { SetCollection(std::move(value)); }
 		Variant(const CollectionItrPair & value) : m_type(ValueType::Null) { SetCollectionItr(value); }
+		Variant(CollectionItrPair && value) : m_type(ValueType::Null) { SetCollectionItr(std::move(value)); }
 		Variant(const UserObjectPtr & value) : m_type(ValueType::Null) { SetUserObject(value); }
 		Variant(const BufferPtr & value) : m_type(ValueType::Null) { SetBuffer(value); }
 		Variant(const Guid & value) : m_type(ValueType::Null) { SetGuid(value); }
@@ -83,6 +88,7 @@ namespace Jinx
 
 		// Assignment operator overloads
 		Variant & operator= (const Variant & copy);
+		Variant & operator= (Variant && other) noexcept;
 
 		// Increment operators
 		Variant & operator++();
@@ -142,12 +148,17 @@ namespace Jinx
 		void SetInteger(int64_t value);
 		void SetNumber(double value);
 		void SetString(const String & value);
+		void SetString(String && value);
 		void SetString(const StringU16 & value);
 		void SetString(const WString & value);
 		void SetCollection(const CollectionPtr & value);
+		void SetCollection(CollectionPtr && value);
 		void SetCollectionItr(const CollectionItrPair & value);
+		void SetCollectionItr(CollectionItrPair && value);
 		void SetUserObject(const UserObjectPtr & value);
+		void SetUserObject(UserObjectPtr && value);
 		void SetBuffer(const BufferPtr & value);
+		void SetBuffer(BufferPtr && value);
 		void SetGuid(const Guid & value);
 		void SetValType(ValueType type);
 
@@ -164,6 +175,10 @@ namespace Jinx
 	private:
 
 		void Destroy();
+		void MoveFrom(Variant & other);
+
+		// The interpreter operates directly on values in its type-specialized instructions
+		friend class Script;
 
 		friend bool operator == (const Variant & left, const Variant & right);
 		friend bool operator < (const Variant & left, const Variant & right);